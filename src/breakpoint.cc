@@ -752,8 +752,9 @@ Breakpoint_action SharedLibraryBreakpoint::hit_active(PStream &os) {
     const char *event = "unknown" ;
     switch (state) {
     case r_debug::RT_CONSISTENT: {             // library is consistent
-        LinkMap *lm = proc->get_new_link_map() ;        
-        if (lm != NULL) {
+        proc->unload_link_maps() ;
+        LinkMap *lm ;
+        while ((lm = proc->get_new_link_map()) != NULL) {
             std::string name = lm->get_name() ;
             if (name != "") {
                 Address base = lm->get_base() ;
@@ -768,6 +769,7 @@ Breakpoint_action SharedLibraryBreakpoint::hit_active(PStream &os) {
         event = "library is being added" ;
         break ;
     case r_debug::RT_DELETE:                 // library is being removed
+        proc->delete_link_maps() ;
         event = "library is being removed" ;
         break ;
     default: ;
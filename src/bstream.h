@@ -53,6 +53,9 @@ public:
    unsigned long length() const {
       return len;
    }
+   const byte* get_data() const {
+      return data;
+   }
 
 private:
    const byte* data;
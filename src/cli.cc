@@ -69,6 +69,14 @@ void CommandCompletor::set_matches(std::vector<std::string> &m) {
     std::sort (matches.begin(), matches.end()) ;
     end = std::unique (matches.begin(), matches.end()) ;
     matches.erase (end, matches.end()) ;
+
+    // each symbol table offers up to max-completions names; offer no more
+    // than that in all
+    long limit = cli->get_int_opt (PRM_MAX_COMPL) ;
+    truncated = limit > 0 && (long)matches.size() >= limit ;
+    if (truncated) {
+        matches.resize (limit) ;
+    }
 }
 
 void CommandCompletor::list_matches_bare() {
@@ -116,6 +124,9 @@ void CommandCompletor::list_matches () {
             x += maxlen ;
         }
         os.print ("\n") ;
+        if (truncated) {
+            os.print ("*** List may be truncated, max-completions reached. ***\n") ;
+        }
     } catch (QuitOutput q) {    
         os.print ("Quit\n") ;
     }
@@ -129,6 +140,7 @@ uint CommandCompletor::num_matches () {
 
 void CommandCompletor::reset() {
     matches.clear() ;
+    truncated = false ;
 }
 
 Command::Command (CommandInterpreter *cli, ProcessController *p, const char **commands) :cli(cli), os(cli->os),  pcm(p), commands(commands) {
@@ -645,6 +657,99 @@ void Command::get_address_arg (std::string tail, std::vector<Address> &result, b
 DebuggerCommand::DebuggerCommand(CommandInterpreter *cli, ProcessController *pcm) : Command (cli, pcm, cmds) {
 }
 
+static bool more_threads (const std::vector<int> &a, const std::vector<int> &b) {
+    return a.size() > b.size() ;
+}
+
+// thread apply all backtrace [unique] [count]
+//
+// The stacks of all the threads are unwound in one pass without switching
+// to each thread, so the frames of the other threads show the names of
+// the arguments but not their values; the current thread's show their
+// values as in a backtrace.  With 'unique'
+// the threads with the same stack are shown together, most threads first.
+void DebuggerCommand::thread_apply (std::vector<std::string> &args) {
+    if (args.size() < 3 || args[1] != "all" ||
+        (args[2] != "backtrace" && args[2] != "bt" && args[2] != "where")) {
+        throw Exception ("Usage: thread apply all backtrace [unique] [count]") ;
+    }
+    bool unique = false ;
+    int n = -1 ;
+    for (uint i = 3 ; i < args.size() ; i++) {
+        if (args[i] == "unique") {
+            unique = true ;
+        } else if (args[i].find_first_not_of ("0123456789") == std::string::npos) {
+            n = get_number (pcm, args[i], -1) ;
+        } else {
+            throw Exception ("Usage: thread apply all backtrace [unique] [count]") ;
+        }
+    }
+    int current = pcm->get_current_thread() ;
+
+    std::vector<std::vector<Address> > stacks ;
+    pcm->get_thread_stacks (n, stacks) ;
+
+    // the threads with each stack
+    typedef std::map<std::vector<Address>, int> StackMap ;
+    StackMap index ;
+    std::vector<std::vector<int> > groups ;
+    for (uint t = 0 ; t < stacks.size() ; t++) {
+        if (!unique) {
+            groups.push_back (std::vector<int> (1, t)) ;
+            continue ;
+        }
+        std::pair<StackMap::iterator, bool> r = index.insert (std::make_pair (stacks[t], (int)groups.size())) ;
+        if (r.second) {
+            groups.push_back (std::vector<int>()) ;
+        }
+        groups[r.first->second].push_back (t) ;
+    }
+    if (unique) {
+        std::stable_sort (groups.begin(), groups.end(), more_threads) ;
+    }
+
+    std::map<Address, Location> locs ;          // each address is looked up once
+    for (uint g = 0 ; g < groups.size() ; g++) {
+        std::vector<int> &threads = groups[g] ;
+        os.print ("\n") ;
+        if (unique) {
+            os.print ("%d thread%s: ", (int)threads.size(), threads.size() == 1 ? "" : "s") ;
+            for (uint i = 0 ; i < threads.size() ; ) {
+                uint j = i ;
+                while (j + 1 < threads.size() && threads[j+1] == threads[j] + 1) {
+                    j++ ;
+                }
+                os.print ("%s%d", i == 0 ? "" : ", ", threads[i]) ;
+                if (j > i) {
+                    os.print ("-%d", threads[j]) ;
+                }
+                i = j + 1 ;
+            }
+            os.print ("\n") ;
+        } else {
+            os.print ("Thread %d (LWP %d):\n", threads[0], pcm->get_thread_pid (threads[0])) ;
+        }
+        std::vector<Address> &pcs = stacks[threads[0]] ;
+        bool paras = threads.size() == 1 && threads[0] == current ;
+        int cfid = pcm->get_frame() ;
+        for (uint i = 0 ; i < pcs.size() ; i++) {
+            std::map<Address, Location>::iterator l = locs.find (pcs[i]) ;
+            if (l == locs.end()) {
+                l = locs.insert (std::make_pair (pcs[i], pcm->lookup_address (pcs[i]))).first ;
+            }
+            os.print ("#%d\t", i) ;
+            if (paras) {
+                pcm->set_frame (i) ;            // the values are read from the frame's registers
+            }
+            print_loc (l->second, true, i, paras) ;
+            os.print ("\n") ;
+        }
+        if (paras) {
+            pcm->set_frame (cfid) ;
+        }
+    }
+}
+
 const char *DebuggerCommand::cmds[] = {
     "directory", "file", "attach", "detach", "process", "processes", "kill", "handle", "thread",
     "history", "source", "alias", "unalias", "define", "document", "cd", "pwd", "env", "setenv",
@@ -767,10 +872,15 @@ void DebuggerCommand::execute (std::string root, std::string tail) {
 //         int ch = 0 ;
 //         extract_number (tail, ch) ;
     } else if (root == "thread") {
-        int ch = 0 ;
-        int n = extract_number (tail, ch) ;
-        pcm->switch_thread (n) ;
-        cli->rerun_push(root, tail) ;
+        std::vector<std::string> args = split (tail) ;
+        if (args.size() > 0 && args[0] == "apply") {
+            thread_apply (args) ;
+        } else {
+            int ch = 0 ;
+            int n = extract_number (tail, ch) ;
+            pcm->switch_thread (n) ;
+            cli->rerun_push(root, tail) ;
+        }
     } else if (root == "history") {
         cli->show_history() ;
     } else if (root == "complete") {
@@ -1621,9 +1731,6 @@ void StackCommand::stacktrace(int n)
 	if (n > 0) {
 		first = pcm->get_frame();
 		last = first + n;
-		if (last > pcm->get_frame_size()) {
-			last = pcm->get_frame_size();
-		}
 	}
 	else {
 		first = 0;
@@ -1633,7 +1740,7 @@ void StackCommand::stacktrace(int n)
 	int pid = pcm->get_current_process();
 	int tid = pcm->get_current_thread();
 	int cfid = pcm->get_frame();
-	for (int i = first ; i < last; i++) {
+	for (int i = first ; i < last && pcm->has_frame (i); i++) {
 		os.print ("#%d\t", i);
 		pcm->set_frame (i);
  		print_loc(pcm->lookup_address (pcm->get_frame_pc(pid, tid, i)), true, i);
@@ -1645,16 +1752,15 @@ void StackCommand::stacktrace(int n)
 void StackCommand::up(int n)
 {
 	int fid = pcm->get_frame();
-	int size = pcm->get_frame_size();
 
 	if (n > 1) {
-		if (fid + n >= size) {
-			n = size - fid - 1 ;
+		while (n > 0 && !pcm->has_frame (fid + n)) {
+			n-- ;
 		}
 		pcm->set_frame (n);
 	}
 	else {
-		if (fid == size - 1) {
+		if (!pcm->has_frame (fid + 1)) {
 			os.print ("Initial frame selected; you cannot go up.\n") ;
 		}
 		else {
@@ -4193,7 +4299,7 @@ std::string CommandInterpreter::readline (const char *prompt, bool recordhist) {
 }
 
 void
-Command::print_loc(const Location& loc, bool print_address, int fid)
+Command::print_loc(const Location& loc, bool print_address, int fid, bool paras)
 {
 	bool first_line = loc.get_funcloc() == NULL ? false : loc.get_funcloc()->at_first_line (loc.get_addr()) ;
 	std::string funcname = loc.get_symname();
@@ -4229,7 +4335,11 @@ Command::print_loc(const Location& loc, bool print_address, int fid)
 		}
 		//if (loc.get_funcloc() != NULL && fid > 0) {
 		if (loc.get_funcloc() != NULL) {
-			pcm->print_function_paras (fid, loc.get_funcloc()->symbol->die) ;
+			if (paras) {
+				pcm->print_function_paras (fid, loc.get_funcloc()->symbol->get_die()) ;
+			} else {
+				print_paras_names (loc.get_funcloc()->symbol->get_die()) ;
+			}
 		}
 
 		os.print (" at %s", loc.get_file()->name.c_str());
@@ -4239,6 +4349,23 @@ Command::print_loc(const Location& loc, bool print_address, int fid)
 	}
 }
 
+// the names of a function's parameters, for a frame whose values can't be read
+void
+Command::print_paras_names (DIE *die)
+{
+	die->check_loaded() ;
+	Subprogram *subprogram = dynamic_cast<Subprogram*>(die) ;
+	std::vector<DIE*> paras ;
+	if (subprogram != NULL) {
+		subprogram->get_formal_parameters (paras) ;
+	}
+	os.print ("(") ;
+	for (uint i = 0 ; i < paras.size() ; i++) {
+		os.print ("%s%s", i == 0 ? "" : ", ", paras[i]->get_name().c_str()) ;
+	}
+	os.print (")") ;
+}
+
 void
 Command::show_line (const Location& loc, bool emacs_mode)
 {
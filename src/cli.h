@@ -63,7 +63,7 @@ typedef std::vector<Match> CommandVec ;
 
 class CommandCompletor : public Completor {
 public:
-    CommandCompletor (CommandInterpreter *cli, PStream &os) : cli(cli), os(os) {}
+    CommandCompletor (CommandInterpreter *cli, PStream &os) : cli(cli), os(os), truncated(false) {}
     virtual ~CommandCompletor() { }
 	
     std::string complete (std::string text, int ch) ;
@@ -78,6 +78,7 @@ private:
     PStream &os ;
     std::string leadin;
     std::vector<std::string> matches ;
+    bool truncated ;                    // max-completions reached; there may be more
 } ;
 
 class Command {
@@ -91,7 +92,8 @@ public:
 
     virtual void execute (std::string root, std::string tail) = 0 ;          // parse the command
     virtual bool is_dangerous (std::string cmd) { return false ; }
-    void print_loc (const Location& loc, bool print_address, int fid);
+    void print_loc (const Location& loc, bool print_address, int fid, bool paras = true);
+    void print_paras_names (DIE *die);
     void show_line (const Location& loc, bool emacs_mode);
     void exec_stop_show (Address fp, bool show_asm);
     Location get_current_location ();
@@ -144,6 +146,7 @@ public:
     void  complete (std::string root, std::string tail, int ch, std::vector<std::string> &result) ;
 private:
     static const char *cmds[] ;
+    void thread_apply (std::vector<std::string> &args) ;
 } ;
 
 
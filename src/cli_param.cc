@@ -185,6 +185,27 @@ CliParamEntry param_list[] = {
    {PRM_USE_HW,    PARAM_BOOL,   TRUE, "can-use-hw-watchpoints",
       "Support for hardware watchpoints"
    },
+   {PRM_PAR_SYM,   PARAM_BOOL,   TRUE, "parallel-symbols",
+      "Reading debug information on all processors"
+   },
+   {PRM_BG_SYM,    PARAM_BOOL,   TRUE, "background-symbols",
+      "Reading shared library debug information in the background"
+   },
+   {PRM_SYM_CACHE, PARAM_BOOL,   TRUE, "symbol-cache",
+      "Caching symbol tables in ~/.cache/pathdb"
+   },
+   {PRM_MAX_COMPL, PARAM_INT,    200,   "max-completions",
+      "Limit on the names offered for completion"
+   },
+   {PRM_DEFER_SOL, PARAM_BOOL,   TRUE, "defer-solib-symbols",
+      "Reading shared library debug information when it is first needed"
+   },
+   {PRM_DEBUG_DIR, PARAM_STR,    P("/usr/lib/debug"), "debug-file-directory",
+      "The directory where separate debug symbols are searched for"
+   },
+   {PRM_SECT_CACHE, PARAM_INT,   256,   "section-cache-size",
+      "Megabytes of decompressed debug sections kept in memory"
+   },
    {PRM_NIL, PARAM_BOOL, 0, NULL, NULL}
 };
 
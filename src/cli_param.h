@@ -95,7 +95,9 @@ enum CliParamId {
    PRM_LANGUAGE,   PRM_ENDIAN,     PRM_STOP_SL,
    PRM_USE_HW,     PRM_ANNOTE,     PRM_VERBOSE,
    PRM_HSTFILE,    PRM_HSTSIZE,    PRM_HSTFSIZE,
-   PRM_HSTSAVE,    PRM_NIL
+   PRM_HSTSAVE,    PRM_PAR_SYM,    PRM_BG_SYM,     PRM_SYM_CACHE,
+   PRM_MAX_COMPL,  PRM_DEFER_SOL,  PRM_DEBUG_DIR,  PRM_SECT_CACHE,
+   PRM_NIL
 };
 
 
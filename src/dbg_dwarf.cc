@@ -51,6 +51,7 @@ author: David Allison <dallison@pathscale.com>
 
 #include <ctype.h>
 #include <sys/stat.h>
+#include <algorithm>
 
 Value AttributeValue::toValue(DIE* type) {
     if (type->is_integral()) {
@@ -65,95 +66,225 @@ Value AttributeValue::toValue(DIE* type) {
 
 
 
-LocationList::LocationList() {
+LocationList::LocationList()
+    : has_default(false), overlapping(false) {
 }
 
 LocationList::~LocationList() {
 }
 
 void LocationList::push_back (LocationListEntry& entry) {
-    list.push_back(entry) ;
+    entries.push_back(entry) ;
 }
 
-void LocationList::clear (void) {
-    list.clear() ;
+void LocationList::set_default (BVector expr) {
+    default_expr = expr ;
+    has_default = true ;
 }
 
-BVector LocationList::getexpr (DwCUnit* cu, Address pc) {
-    std::list<LocationListEntry>::iterator i;
+void LocationList::clear (void) {
+    entries.clear() ;
+    has_default = false ;
+    overlapping = false ;
+}
 
-    pc = pc - cu->get_base_pc();
+void LocationList::sort (void) {
+    std::stable_sort (entries.begin(), entries.end()) ;
+    overlapping = false ;
+    for (unsigned int i = 1 ; i < entries.size() ; i++) {
+        if (entries[i].low < entries[i-1].high) {
+            overlapping = true ;
+        }
+    }
+}
 
-    for (i = list.begin(); i != list.end(); i++) {
-       if (pc >= i->low && pc < i->high)
-          return i->expr ;
+BVector LocationList::getexpr (DwCUnit* cu, Address pc) {
+    pc -= cu->get_base() ;
+
+    // the first range starting after pc
+    int low = 0 ;
+    int high = entries.size() ;
+    while (low < high) {
+        int mid = (low + high) / 2 ;
+        if (pc < entries[mid].low) {
+            high = mid ;
+        } else {
+            low = mid + 1 ;
+        }
+    }
+    for (int i = low - 1 ; i >= 0 ; i--) {
+        if (pc < entries[i].high) {
+            return entries[i].expr ;
+        }
+        if (!overlapping) {
+            break ;
+        }
+    }
+    if (has_default) {
+        return default_expr ;
     }
 
     throw Exception("Unable to get value of variable");
 }
 
-LocationListTable::LocationListTable (DwCUnit* cu, BVector vec) {
-    BStream stream (vec, cu->do_swap());
+LocationListTable::LocationListTable (BVector loc, BVector loclists)
+    : loc(loc), loclists(loclists) {
+}
+
+LocationListTable::~LocationListTable () {
+    for (ListMap::iterator i = loc_lists.begin() ; i != loc_lists.end() ; i++) {
+        delete i->second ;
+    }
+    for (ListMap::iterator i = loclists_lists.begin() ; i != loclists_lists.end() ; i++) {
+        delete i->second ;
+    }
+}
 
-    while (!stream.eof()) {
-        Offset offset;
-        Address base_addr;
-        LocationList list;
-        LocationListEntry entry;       
+// A .debug_loc list: pairs of offsets from the base address, which is the
+// unit's low pc until a base address selector changes it
+void LocationListTable::read_loc (DwCUnit* cu, Offset offset, LocationList& list) {
+    BStream stream (loc, cu->do_swap()) ;
+    stream.seek (offset) ;
+    Address base_addr = cu->get_base_pc() ;
+    Address selector = cu->getAddrSize() == 4 ? 0xffffffff : (Address)-1 ;
 
-        base_addr = 0 ;
-        offset = stream.offset() ;
+    while (!stream.eof()) {
+        LocationListEntry entry ;
+        entry.low = cu->read_address(stream) ;
+        entry.high = cu->read_address(stream) ;
+        if (entry.low == 0 && entry.high == 0) {
+            break ;  /* end of list marker */
+        } else if (entry.low == selector) {
+            base_addr = entry.high ;
+            continue ; /* base address selector */
+        }
 
-        for (;;) {
-           int32_t entry_len;
+        int entry_len = stream.read2u() ;
+        entry.expr = BVector(stream.address(), entry_len) ;
+        stream.seek(entry_len, BSTREAM_CUR) ;
 
-           entry.low = cu->read_address(stream) ;
-           entry.high = cu->read_address(stream) ;
-           if (entry.low == 0 && entry.high == 0) {
-              break ;  /* end of list marker */
-           }
-           else if (entry.low == -1) {
-              base_addr = entry.high ;
-              continue ; /* base address selector */
-           }
+        entry.low += base_addr ;
+        entry.high += base_addr ;
+        list.push_back(entry) ;
+    }
+}
 
-           entry_len = stream.read2u();
-           const byte* addr = stream.address();
-           entry.expr = BVector(addr, entry_len);
-           stream.seek(entry_len, BSTREAM_CUR); 
+// A DWARF 5 list is a sequence of entries of different kinds.  Those that
+// index the .debug_addr table can't be read as it isn't.
+void LocationListTable::read_loclists (DwCUnit* cu, Offset offset, LocationList& list) {
+    BStream stream (loclists, cu->do_swap()) ;
+    stream.seek (offset) ;
+    Address base_addr = cu->get_base_pc() ;
 
-           entry.low += base_addr ;
-           entry.high += base_addr ;
-           list.push_back(entry) ;
+    while (!stream.eof()) {
+        LocationListEntry entry ;
+        int kind = stream.read1u() ;
+        switch (kind) {
+        case DW_LLE_end_of_list:
+            return ;
+        case DW_LLE_base_address:
+            base_addr = cu->read_address(stream) ;
+            continue ;
+        case DW_LLE_offset_pair:
+            entry.low = base_addr + stream.read_uleb() ;
+            entry.high = base_addr + stream.read_uleb() ;
+            break ;
+        case DW_LLE_start_end:
+            entry.low = cu->read_address(stream) ;
+            entry.high = cu->read_address(stream) ;
+            break ;
+        case DW_LLE_start_length:
+            entry.low = cu->read_address(stream) ;
+            entry.high = entry.low + stream.read_uleb() ;
+            break ;
+        case DW_LLE_default_location:
+            break ;
+        default:
+            throw Exception("Unsupported location list entry %d", kind) ;
         }
 
-        table[offset] = list;
-        list.clear();
-    } 
+        int entry_len = stream.read_uleb() ;
+        entry.expr = BVector(stream.address(), entry_len) ;
+        stream.seek(entry_len, BSTREAM_CUR) ;
+
+        if (kind == DW_LLE_default_location) {
+            list.set_default (entry.expr) ;
+        } else {
+            list.push_back(entry) ;
+        }
+    }
 }
 
-LocationListTable::~LocationListTable () {
+// A GNU split DWARF list in .debug_loc.dwo: entries of different kinds
+// whose addresses are indexes into .debug_addr
+void LocationListTable::read_split_loc (DwCUnit* cu, Offset offset, LocationList& list) {
+    BStream stream (loc, cu->do_swap()) ;
+    stream.seek (offset) ;
 
-}
+    while (!stream.eof()) {
+        LocationListEntry entry ;
+        int kind = stream.read1u() ;
+        switch (kind) {
+        case DW_LLE_GNU_end_of_list_entry:
+            return ;
+        case DW_LLE_GNU_base_address_selection_entry:
+            stream.read_uleb() ;                // only used by offset pairs, which GCC doesn't emit
+            continue ;
+        case DW_LLE_GNU_start_end_entry:
+            entry.low = cu->get_indexed_address (stream.read_uleb()) ;
+            entry.high = cu->get_indexed_address (stream.read_uleb()) ;
+            break ;
+        case DW_LLE_GNU_start_length_entry:
+            entry.low = cu->get_indexed_address (stream.read_uleb()) ;
+            entry.high = entry.low + (uint32_t)stream.read4u() ;
+            break ;
+        default:
+            throw Exception("Unsupported location list entry %d", kind) ;
+        }
 
-LocationList& LocationListTable::getlist (Offset offset) {
-    std::map<int,LocationList>::iterator i;
+        int entry_len = stream.read2u() ;
+        entry.expr = BVector(stream.address(), entry_len) ;
+        stream.seek(entry_len, BSTREAM_CUR) ;
+        list.push_back(entry) ;
+    }
+}
 
-    i = table.find(offset);
-    if (i != table.end()) {
-       return i->second;
+LocationList& LocationListTable::getlist (DwCUnit* cu, Offset offset) {
+    bool dwarf5 = cu->get_dwf_ver() >= 5 ;
+    ListMap &lists = dwarf5 ? loclists_lists : loc_lists ;
+    ListMap::iterator i = lists.find(offset) ;
+    if (i != lists.end()) {
+       return *i->second ;
     }
 
-    throw Exception ("Unable to get value of variable");
+    if (offset < 0 || offset >= (Offset)(dwarf5 ? loclists : loc).length()) {
+        throw Exception ("Unable to get value of variable") ;
+    }
+    LocationList *list = new LocationList() ;
+    try {
+        if (dwarf5) {
+            read_loclists (cu, offset, *list) ;
+        } else if (cu->is_split()) {
+            read_split_loc (cu, offset, *list) ;
+        } else {
+            read_loc (cu, offset, *list) ;
+        }
+    } catch (...) {
+        delete list ;
+        throw ;
+    }
+    list->sort() ;
+    lists[offset] = list ;
+    return *list ;
 }
 
 BVector LocationListTable::getexpr (DwCUnit* cu, Offset offset, Address pc) {
-    LocationList& loclist = getlist(offset);
+    LocationList& loclist = getlist(cu, offset);
     return loclist.getexpr(cu, pc);
 }
 
 AttributeAbbreviation::AttributeAbbreviation (int tag, int form)
-    : tag(tag), form(form) { }
+    : tag(tag), form(form), offset(-1), addresses(0) { }
 
 AttributeAbbreviation::~AttributeAbbreviation() {
 }
@@ -170,14 +301,82 @@ int AttributeAbbreviation::getForm() {
        return form ;
 }
 
+bool AttributeAbbreviation::is_reference() {
+       switch (form) {
+       case DW_FORM_ref1:
+       case DW_FORM_ref2:
+       case DW_FORM_ref4:
+       case DW_FORM_ref8:
+       case DW_FORM_ref_udata:
+           return true ;
+       }
+       return false ;
+}
+
+// the size of a value of this form is the result plus addrs addresses.  -1 if
+// it varies
+int AttributeAbbreviation::get_size (int &addrs) {
+        addrs = 0 ;
+        switch (form) {
+        case DW_FORM_addr:
+        case DW_FORM_ref_addr:
+            addrs = 1 ;
+            return 0 ;
+        case DW_FORM_data1:
+        case DW_FORM_flag:
+        case DW_FORM_ref1:
+            return 1 ;
+        case DW_FORM_data2:
+        case DW_FORM_ref2:
+            return 2 ;
+        case DW_FORM_data4:
+        case DW_FORM_strp:
+        case DW_FORM_ref4:
+        case DW_FORM_sec_offset:
+            return 4 ;
+        case DW_FORM_data8:
+        case DW_FORM_ref8:
+        case DW_FORM_ref_sig8:
+            return 8 ;
+        case DW_FORM_flag_present:
+            return 0 ;
+        }
+        return -1 ;
+}
+
+// a DWARF 4 DW_AT_high_pc of one of these forms is the size of the code
+bool AttributeAbbreviation::is_constant() {
+       switch (form) {
+       case DW_FORM_data1:
+       case DW_FORM_data2:
+       case DW_FORM_data4:
+       case DW_FORM_data8:
+       case DW_FORM_sdata:
+       case DW_FORM_udata:
+           return true ;
+       }
+       return false ;
+}
+
 static BVector readblock (int len, BStream &stream) {
     const byte* addr = stream.address();
     stream.seek(len, BSTREAM_CUR);
     return BVector(addr, len); 
 }
 
+static const char *readstring (BStream &stream) {
+    const char *s = (const char *)stream.address() ;
+    const char *end = (const char *)memchr (s, 0, stream.remaining()) ;
+    if (end == NULL) {
+        stream.seek (0, BSTREAM_END) ;
+        return "" ;
+    }
+    stream.seek (end - s + 1, BSTREAM_CUR) ;
+    return s ;
+}
+
 
-AttributeValue AttributeAbbreviation::read(DwCUnit *cu, Attribute * attr, BStream & stream) {
+AttributeValue AttributeAbbreviation::read(DwCUnit *cu, BStream & stream) {
         switch (form) {
         case DW_FORM_addr:
             return cu->read_address (stream) ;
@@ -210,18 +409,8 @@ AttributeValue AttributeAbbreviation::read(DwCUnit *cu, Attribute * attr, BStrea
         case DW_FORM_data8:
             return stream.read8u() ;
             break ;
-        case DW_FORM_string: {
-            std::string s = "" ;
-            while (!stream.eof()) {
-                char ch = stream.read1u() ;
-                if (ch == 0) {
-                    break ;
-                }
-                s += (char)(ch) ;
-            }
-            return s ;
-            break ;
-            }
+        case DW_FORM_string:
+            return readstring (stream) ;
         case DW_FORM_blockv: {
             int len = stream.read_uleb() ;
             return readblock (len, stream) ;
@@ -235,37 +424,53 @@ AttributeValue AttributeAbbreviation::read(DwCUnit *cu, Attribute * attr, BStrea
         case DW_FORM_strp: {
             int index = stream.read4u() ;
             //println ("index = " + index)
-            std::string s = cu->get_string_table()->getString (index) ;
-            return s ;
+            return cu->get_string_table()->getString (index) ;
             break ;
             }
         case DW_FORM_udata:
             return stream.read_uleb() ;
             break ;
         case DW_FORM_ref_addr:
-	    std::cerr << "FORM DW_FORM_ref_addr ignored";
+	    cu->warn ("FORM DW_FORM_ref_addr ignored") ;        // may be on a worker thread
 	    return cu->read_address (stream) ;
 	    //throw Exception ("FORM Not yet implemented") ;
 	    break ;
         case DW_FORM_ref1: {
             Offset offset = stream.read1u() ;
-            return cu->get_die_reference (attr, offset) ;
+            return offset ;
             }
         case DW_FORM_ref2: {
             int offset = stream.read2u() ;
-            return cu->get_die_reference(attr, offset) ;
+            return offset ;
             }
         case DW_FORM_ref4: {
             int offset = stream.read4u() ;
-            return cu->get_die_reference (attr, offset) ;
+            return offset ;
             }
         case DW_FORM_ref8: {
             int64_t offset = stream.read8u() ;
-            return cu->get_die_reference (attr, offset) ;
+            return offset ;
             }
-        case DW_FORM_ref_udata:
-            throw Exception ("FORM Not yet implemented") ;
-            break ;
+        case DW_FORM_ref_udata: {
+            int64_t offset = stream.read_uleb() ;
+            return offset ;
+            }
+        case DW_FORM_sec_offset: {
+            int64_t offset = (uint32_t)stream.read4u() ;
+            return offset ;
+            }
+        case DW_FORM_exprloc: {
+            int len = stream.read_uleb() ;
+            return readblock (len, stream) ;
+            }
+        case DW_FORM_flag_present:
+            return 1 ;
+        case DW_FORM_ref_sig8:
+            return stream.read8u() ;            // type units are not read
+        case DW_FORM_GNU_addr_index:
+            return cu->get_indexed_address (stream.read_uleb()) ;
+        case DW_FORM_GNU_str_index:
+            return cu->get_indexed_string (stream.read_uleb()) ;
         case DW_FORM_indirect:
             throw Exception ("FORM Not yet implemented") ;
             break ;
@@ -273,11 +478,53 @@ AttributeValue AttributeAbbreviation::read(DwCUnit *cu, Attribute * attr, BStrea
 	throw Exception("not reached");
 }
 
+// move the stream past a value without decoding it
+void AttributeAbbreviation::skip (DwCUnit *cu, BStream & stream) {
+        int addrs ;
+        int size = get_size (addrs) ;
+        if (size >= 0) {
+            stream.seek (size + addrs * cu->getAddrSize(), BSTREAM_CUR) ;
+            return ;
+        }
+        switch (form) {
+        case DW_FORM_block1:
+            stream.seek (stream.read1u(), BSTREAM_CUR) ;
+            break ;
+        case DW_FORM_block2:
+            stream.seek (stream.read2u(), BSTREAM_CUR) ;
+            break ;
+        case DW_FORM_block4:
+            stream.seek (stream.read4u(), BSTREAM_CUR) ;
+            break ;
+        case DW_FORM_blockv:
+        case DW_FORM_exprloc:
+            stream.seek (stream.read_uleb(), BSTREAM_CUR) ;
+            break ;
+        case DW_FORM_string:
+            readstring (stream) ;
+            break ;
+        case DW_FORM_sdata:
+            stream.read_sleb() ;
+            break ;
+        case DW_FORM_udata:
+        case DW_FORM_ref_udata:
+        case DW_FORM_GNU_addr_index:
+        case DW_FORM_GNU_str_index:
+            stream.read_uleb() ;
+            break ;
+        default:
+            throw Exception ("FORM Not yet implemented") ;
+        }
+}
+
 
 Abbreviation::Abbreviation (int num, int tag, bool haschildren)
     : num(num),
     tag(tag),
-    haschildren(haschildren) {
+    haschildren(haschildren),
+    size(0),
+    size_addresses(0),
+    links(false) {
 }
 
 Abbreviation::~Abbreviation() {
@@ -302,7 +549,20 @@ void Abbreviation::read(BStream & bstream) {
            if (tag == 0 && form == 0) {
                break ;
            }
-           attributes.push_back (new AttributeAbbreviation (tag, form)) ;
+           AttributeAbbreviation *attr = new AttributeAbbreviation (tag, form) ;
+           attributes.push_back (attr) ;
+
+           // work out where the value is for as long as the sizes are fixed
+           attr->set_position (size, size_addresses) ;
+           if (size >= 0) {
+               int addrs ;
+               int n = attr->get_size (addrs) ;
+               size = n < 0 ? -1 : size + n ;
+               size_addresses += addrs ;
+           }
+           if (tag == DW_AT_sibling || tag == DW_AT_specification || tag == DW_AT_abstract_origin) {
+               links = true ;
+           }
        }
 }
 
@@ -346,21 +606,20 @@ AttributeAbbreviation *Abbreviation::getAttribute(int i) {
        return attributes[i] ;
 }
 
-Attribute::Attribute (int form)
-    : form(form) {
-}
-
-Attribute::~Attribute() {
-}
-
-
-void Attribute::fixup(DIE *die) {
-    value = die ;
+AttributeAbbreviation *Abbreviation::findAttribute(int tag) {
+       for (uint i = 0 ; i < attributes.size() ; i++) {
+           if (attributes[i]->getTag() == tag) {
+               return attributes[i] ;
+           }
+       }
+       return NULL ;
 }
 
-void FixupAttribute::fixup(DIE *die) {
-    value = die ;
-    die->set_more_info (parent) ;
+int Abbreviation::get_size (int addrsize) {
+       if (size < 0) {
+           return -1 ;
+       }
+       return size + size_addresses * addrsize ;
 }
 
 
@@ -401,7 +660,7 @@ void Formal_parameter::print(EvalContext &ctx, int indent, int level) {
 }
 
 Value Formal_parameter::evaluate(EvalContext &context) {
-        AttributeValue &loc = getAttribute (DW_AT_location) ;
+        AttributeValue loc = getAttribute (DW_AT_location) ;
         if (loc.type == AV_NONE) {
            throw Exception ("Unable to get value of formal parameter %s"
               " - perhaps it is optimized out", get_name().c_str()) ;
@@ -1869,6 +2128,9 @@ Address Subprogram::get_address(EvalContext &context, Address stack_top) {
 
     // probably member of a class, try linkage name
     v = getAttribute (DW_AT_MIPS_linkage_name) ;
+    if (v.type == AV_NONE) {
+        v = getAttribute (DW_AT_linkage_name) ;
+    }
     if (v.type != AV_NONE) {
         Address addr = context.process->lookup_symbol(v.str) ;
         if (addr != 0) {
@@ -2011,25 +2273,3 @@ bool Variable::is_local_var() {
     return false ;
 }
 
-
-
-
-LineInfo::LineInfo (DwCUnit *cu, Address address, int file, int lineno, int column, bool is_stmt, bool basic_block)
-    : cu(cu),
-    address(address),
-    file(file),
-    lineno(lineno),
-    column(column),
-    is_stmt(is_stmt),
-    basic_block(basic_block) {
-}
-
-LineInfo::~LineInfo() {
-}
-
-void LineInfo::print() {
-   FileTable & files = cu->get_file_table() ;
-   printf ("0x%-20llx %-30s %-6d %-6d %d %d\n", (unsigned long long) address,
-	   files[file]->name.c_str(), lineno, column, is_stmt, basic_block) ;
-}
-
@@ -33,7 +33,6 @@ author: David Allison <dallison@pathscale.com>
 
 class DIE ;
 class Abbreviation ;
-class LineInfo ;
 class File ;
 class DwCUnit ;
 class DwInfo ;
@@ -65,17 +64,6 @@ typedef std::vector<FDE*> FDEVec ;              // sorted on start address
 //typedef int DwTagId;
 //typedef int DwVirtId;
 
-// a DIE that has not been loaded yet
-// This is used when a pointer to another die that hasn't been loaded yet
-// needs to be resolved.  If the offset is within the range of the
-// start..end then the die's children are loaded
-
-struct LazyDIE {
-    LazyDIE (DIE *d, Offset s, Offset e) :die(d), start(s), end(e) {}
-    DIE *die ;
-    Offset start ;              // offset of first child
-    Offset end ;                // offset of sibling
-} ;
 
 
 // classes
@@ -85,32 +73,55 @@ class Attribute ;
 
 class LocationListEntry {
 public:
-    Address low ;
+    Address low ;                       // not relocated
     Address high ;
     BVector expr ;
+    bool operator < (const LocationListEntry &e) const { return low < e.low ; }
 } ;
 
+// The ranges of a location list sorted on their start, so that the
+// expression for a pc is found by a binary search.  The ranges of a list
+// rarely overlap; if they do the ranges before the one found are looked
+// at too.  A DWARF 5 list may have a default location for the pcs that
+// are in none of its ranges.
 class LocationList {
 public:
    LocationList () ;
    ~LocationList () ;
    void clear (void) ;
    void push_back (LocationListEntry& entry) ;
+   void set_default (BVector expr) ;
+   void sort (void) ;
    BVector getexpr (DwCUnit* cu, Address pc) ;
 protected:
 private:
-   std::list<LocationListEntry> list;
+   std::vector<LocationListEntry> entries ;
+   BVector default_expr ;
+   bool has_default ;
+   bool overlapping ;
 } ;
 
+// The location lists of an object, from .debug_loc, or .debug_loclists
+// for DWARF 5 units.  A split unit has a table of its own, of its part of
+// .debug_loc.dwo.  Each list is parsed the first time a variable
+// needs it, with the address size and base address of the unit it is
+// used from.
 class LocationListTable {
 public:
-   LocationListTable(DwCUnit* cu, BVector data) ;
+   LocationListTable(BVector loc, BVector loclists) ;
    ~LocationListTable() ;
-   LocationList& getlist (Offset offset) ;
+   LocationList& getlist (DwCUnit* cu, Offset offset) ;
    BVector getexpr (DwCUnit* cu, Offset offset, Address pc) ;
 protected:
 private:
-   std::map<int,LocationList> table ;
+   typedef std::map<Offset,LocationList*> ListMap ;
+   void read_loc (DwCUnit* cu, Offset offset, LocationList& list) ;
+   void read_loclists (DwCUnit* cu, Offset offset, LocationList& list) ;
+   void read_split_loc (DwCUnit* cu, Offset offset, LocationList& list) ;
+   BVector loc ;
+   BVector loclists ;
+   ListMap loc_lists ;                  // vs offset in .debug_loc
+   ListMap loclists_lists ;             // vs offset in .debug_loclists
 } ;
 
 
@@ -357,19 +368,4 @@ protected:
 } ;
 
 
-class LineInfo {
-public:
-    LineInfo(DwCUnit *cu, Address address, int file, int lineno, int column, bool is_stmt, bool basic_block) ;
-    ~LineInfo() ;
-    void print () ;
-    DwCUnit * cu ;
-    Address address ;
-    int file ;
-    int lineno ;
-    int column ;
-    bool is_stmt ;
-    bool basic_block ;
-} ;
-
-
 #endif
@@ -34,9 +34,21 @@ author: David Allison <dallison@pathscale.com>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <zlib.h>
+#include <ctype.h>
+#include <strings.h>
+#include <algorithm>
 #include "utils.h"
+#include "sect_cache.h"
 #include "target.h"
 
+#ifndef SHF_COMPRESSED
+#define SHF_COMPRESSED (1 << 11)
+#endif
+#ifndef ELFCOMPRESS_ZLIB
+#define ELFCOMPRESS_ZLIB 1
+#endif
+
 ProgramSegment::ProgramSegment (ELF *elf, Address baseaddr)
    : elf(elf), type(0), flags(0), offset(0), 
      vaddr(0), paddr(0), filesz(0), memsz(0), align(0), baseaddr(baseaddr)
@@ -128,6 +140,7 @@ BVector ProgramSegment::get_contents(std::istream & stream) {
 
 Section::Section (ELF *elf, int index)
     : elf(elf), index(index),
+    compression(SC_NONE),
     type(0),
     flags(0),
     addr(0),
@@ -140,6 +153,9 @@ Section::Section (ELF *elf, int index)
 }
 
 Section::~Section() {
+    if (compression != SC_NONE) {
+        section_cache.remove (this) ;
+    }
 }
 
 std::string Section::get_name() {
@@ -165,6 +181,9 @@ int Section::read(std::istream & stream) {
         info = elf->read_word4 (stream) ;
         addralign = elf->read_xword (stream) ;
         entsize = elf->read_xword (stream) ;
+        if (flags & SHF_COMPRESSED) {
+            compression = SC_ELF ;
+        }
         return 0 ;
 }
 
@@ -190,8 +209,13 @@ int Section::get_size() {
         return size ;
 }
 
+// a .zdebug_ section is known by the name of the section it compresses
 void Section::set_name(std::istream & stream, Section *nametable) {
         name = nametable->read_string (stream, nameindex) ;
+        if (compression == SC_NONE && name.compare (0, 8, ".zdebug_") == 0) {
+            compression = SC_ZDEBUG ;
+            name = ".debug_" + name.substr (8) ;
+        }
 }
 
 std::string Section::read_string(std::istream & stream, int stroffset) {
@@ -215,6 +239,9 @@ int32_t Section::read_word4(std::istream & stream, int stroffset) {
 }
 
 BVector Section::get_contents(std::istream& stream) {
+    if (compression != SC_NONE) {
+        return section_cache.get (this, stream) ;
+    }
     stream.seekg (elf->mainoffset + offset, std::ios_base::beg);
 
     /* XXX: why does this exist? same as ProgramSegment. */
@@ -224,70 +251,70 @@ BVector Section::get_contents(std::istream& stream) {
     return BVector(addr, size);
 }
 
-ELFSymbol::ELFSymbol (ELF *elf) : elf (elf)
- {
-}
-
-ELFSymbol::~ELFSymbol() {
-}
-
-std::string ELFSymbol::get_name() {
-        return name ;
-}
-
-Address ELFSymbol::get_value() {
-        return value ;
-}
-
-Section* ELFSymbol::get_section() {
-        return section ;
-}
-
-int ELFSymbol::read(std::istream & stream, Address baseaddr) {
-        nameindex = elf->read_word4 (stream) ;
-        if (elf->fileclass == ELFCLASS64) {
-            info = elf->read_byte (stream) ;
-            other = elf->read_byte (stream) ;
-            shndx = elf->read_word2 (stream) ;
-            value = elf->read_address (stream) ;
-            size = elf->read_xword (stream) ;
-        } else {
-            value = elf->read_address (stream) ;
-            size = elf->read_word4 (stream) ;
-            info = elf->read_byte (stream) ;
-            other = elf->read_byte (stream) ;
-            shndx = elf->read_word2 (stream) ;
-        }
-        value += baseaddr ;
-        section = elf->find_section_by_index (shndx) ;
-        return 0 ;
-}
-
-void ELFSymbol::set_name(std::istream & stream, Section *nametable) {
-        name = nametable->read_string (stream, nameindex) ;
-        std::string::size_type postfix = name.find ("@@") ;
-        if (postfix != std::string::npos) {
-            name = name.substr (0, postfix) ;
+// read the size from the compression header
+uint64_t Section::get_uncompressed_size(std::istream & stream) {
+    stream.seekg (elf->mainoffset + offset, std::ios_base::beg) ;
+    if (compression == SC_ZDEBUG) {
+        char magic[4] ;
+        stream.read (magic, 4) ;
+        if (size < 12 || memcmp (magic, "ZLIB", 4) != 0) {
+            throw Exception ("Invalid compressed section %s", name.c_str()) ;
         }
+        uint64_t usize = 0 ;
+        for (int i = 0 ; i < 8 ; i++) {                  // always big endian
+            usize = (usize << 8) | (stream.get() & 0xff) ;
+        }
+        return usize ;
+    }
+    if (size < (elf->is_elf64() ? 24 : 12)) {
+        throw Exception ("Invalid compressed section %s", name.c_str()) ;
+    }
+    int32_t chtype = elf->read_word4 (stream) ;
+    if (elf->is_elf64()) {
+        elf->read_word4 (stream) ;                      // ch_reserved
+    }
+    uint64_t usize = elf->read_xword (stream) ;
+    if (chtype != ELFCOMPRESS_ZLIB) {
+        throw Exception ("Unsupported compression type %d in section %s", chtype, name.c_str()) ;
+    }
+    return usize ;
 }
 
-int ELFSymbol::get_size() {
-        return elf->fileclass == ELFCLASS64 ? 24 : 16 ;
-}
+// inflate the section into destsize bytes at dest; the compressed data is
+// read a piece at a time
+void Section::decompress(std::istream & stream, byte *dest, uint64_t destsize) {
+    int header = compression == SC_ELF && elf->is_elf64() ? 24 : 12 ;
+    if (get_uncompressed_size (stream) != destsize) {
+        throw Exception ("Invalid compressed section %s", name.c_str()) ;
+    }
+    stream.seekg (elf->mainoffset + offset + header, std::ios_base::beg) ;
 
-void ELFSymbol::print() {
-        std::cout << "name = "  <<  name << '\n' ;
-        std::cout << "nameindex = "  <<  nameindex << '\n' ;
-        std::cout << "value = "  <<  value << '\n' ;
-        std::cout << "size = "  <<  size << '\n' ;
-        std::cout << "info = "  <<  info << '\n' ;
-        std::cout << "other = "  <<  other << '\n' ;
-        std::cout << "shndx = "  <<  shndx << '\n' ;
-        if (section == NULL) {
-            std::cout << "no section found" << '\n' ;
-        } else {
-            std::cout << "section: "  <<  section->get_name() << '\n' ;
+    z_stream z ;
+    memset (&z, 0, sizeof(z)) ;
+    if (inflateInit (&z) != Z_OK) {
+        throw Exception ("Unable to decompress section %s", name.c_str()) ;
+    }
+    z.next_out = dest ;
+    z.avail_out = destsize ;
+    byte buffer[65536] ;
+    int64_t left = size - header ;
+    int r = Z_OK ;
+    while (r == Z_OK && left > 0) {
+        int n = left < (int64_t)sizeof(buffer) ? left : sizeof(buffer) ;
+        stream.read ((char*)buffer, n) ;
+        if (!stream.good()) {
+            break ;
         }
+        left -= n ;
+        z.next_in = buffer ;
+        z.avail_in = n ;
+        r = inflate (&z, Z_NO_FLUSH) ;
+    }
+    uint64_t out = z.total_out ;
+    inflateEnd (&z) ;
+    if (r != Z_STREAM_END || out != destsize) {
+        throw Exception ("Unable to decompress section %s", name.c_str()) ;
+    }
 }
 
 ELF::ELF (std::string name, Offset mainoffset)
@@ -322,9 +349,8 @@ ELF::~ELF() {
         delete sections[i] ;
     }
 
-    Map_Range<Address,ELFSymbol*>::iterator i;
-    for (i=symmap.begin(); i!=symmap.end(); ++i) {
-        delete i->val;
+    for (unsigned int i = 0 ; i < strtabs.size(); i++) {
+        free (strtabs[i]) ;
     }
 }
 
@@ -563,6 +589,50 @@ Section *ELF::find_section(std::string name) {
     return NULL;
 }
 
+// the GNU build-id note, as written by ld --build-id
+std::string ELF::get_build_id(std::istream & stream) {
+    std::string id ;
+    Section *note = find_section (".note.gnu.build-id") ;
+    if (note == NULL || note->get_size() <= 16) {
+        return id ;
+    }
+    BVector data = note->get_contents (stream) ;
+    BStream bs (data, !is_little_endian()) ;
+    int namesz = bs.read4u() ;
+    int descsz = bs.read4u() ;
+    int type = bs.read4u() ;
+    int desc = 12 + ((namesz + 3) & ~3) ;
+    if (type == NT_GNU_BUILD_ID && namesz == 4 && memcmp (&data[12], "GNU", 4) == 0 &&
+        descsz > 0 && desc + descsz <= note->get_size()) {
+        char buf[4] ;
+        for (int i = 0 ; i < descsz ; i++) {
+            snprintf (buf, sizeof(buf), "%02x", data[desc + i]) ;
+            id += buf ;
+        }
+    }
+    return id ;
+}
+
+// the .gnu_debuglink section holds the name of the debug file, padded to
+// 4 bytes, and the CRC32 of its contents
+std::string ELF::get_debuglink(std::istream & stream, uint32_t &crc) {
+    Section *link = find_section (".gnu_debuglink") ;
+    if (link == NULL || link->get_size() < 8) {
+        return "" ;
+    }
+    BVector data = link->get_contents (stream) ;
+    const char *name = (const char *)&data[0] ;
+    int len = strnlen (name, data.length()) ;
+    int crcoffset = (len + 4) & ~3 ;
+    if (len == 0 || crcoffset + 4 > (int)data.length()) {
+        return "" ;
+    }
+    BStream bs (data, !is_little_endian()) ;
+    bs.seek (crcoffset) ;
+    crc = bs.read4u() ;
+    return std::string (name, len) ;
+}
+
 Section *ELF::find_section_by_index(int index) {
     if (index < 0 || index >= (int)sections.size()) {
         return NULL ;
@@ -570,47 +640,144 @@ Section *ELF::find_section_by_index(int index) {
     return sections[index] ;
 }
 
+// FNV-1a, of the name or of the name in upper case
+static uint32_t hash_name (const char *name, bool caseblind) {
+    uint32_t h = 2166136261u ;
+    for (const unsigned char *p = (const unsigned char *)name ; *p != 0 ; p++) {
+        h = (h ^ (caseblind ? toupper (*p) : *p)) * 16777619u ;
+    }
+    return h ;
+}
+
 class Compare_symbols {
 public:
-    bool operator() (ELFSymbol *s1, ELFSymbol *s2) {
-        return *s1 < *s2 ;
+    Compare_symbols (std::vector<ELFSymbol> &syms) : syms(syms) {}
+    bool operator() (uint32_t s1, uint32_t s2) {
+        return syms[s1].get_value() < syms[s2].get_value() ;
     }
+private:
+    std::vector<ELFSymbol> &syms ;
 } ;
 
-void ELF::read_symtab (std::istream &stream, Section *symtab, Address baseaddr, Section *strtab) {
-    int symtabsize = symtab->get_size() ;
+// a copy of a string table, kept for the names of the symbols
+char *ELF::read_strings (std::istream &stream, Section *strtab) {
+    int64_t size = strtab->get_size() ;
+    char *strings = (char *)malloc (size + 1) ;
+    stream.seekg (mainoffset + strtab->get_offset(), std::ios_base::beg) ;
+    stream.read (strings, size) ;
+    if (!stream.good()) {
+        free (strings) ;
+        throw Exception ("Unable to read section %s", strtab->get_name().c_str()) ;
+    }
+    strings[size] = 0 ;
+    strtabs.push_back (strings) ;
+    return strings ;
+}
+
+// read the symbols of a symbol table in one pass over a copy of it
+void ELF::read_symtab (std::istream &stream, Section *symtab, Address baseaddr, Section *strtab,
+                       std::vector<ELFSymbol> &syms) {
+    char *strings = read_strings (stream, strtab) ;
+    int64_t strsize = strtab->get_size() ;
+    int64_t size = symtab->get_size() ;
+    std::vector<byte> data (size + 1) ;
     stream.seekg (mainoffset + symtab->get_offset(), std::ios_base::beg) ;
+    stream.read ((char *)&data[0], size) ;
+    if (!stream.good()) {
+        throw Exception ("Unable to read section %s", symtab->get_name().c_str()) ;
+    }
 
-    while (symtabsize > 0) {
-        ELFSymbol *sym = new ELFSymbol(this) ;
-        sym->read (stream, baseaddr) ;
-        symtabsize -= sym->get_size() ;
-        // only insert into symbol table if the symbol is not hidden and it has a valid section index
-        if (ELF32_ST_VISIBILITY (sym->get_other()) != STV_HIDDEN && sym->get_section_index() != 0) {
-            int type = ELF32_ST_TYPE(sym->get_info()) ;
-            if (type == STT_OBJECT || type == STT_FUNC || type == STT_NOTYPE) {
-                symmap.raw(sym->value, sym->value + sym->get_size() -1, sym);
-
-                std::ios::pos_type pos = stream.tellg();
-                stream.seekg(symtabsize, std::ios_base::cur);
-                sym->set_name(stream, strtab);
-                symbols[sym->get_name()] = sym;
-                stream.seekg(pos, std::ios_base::beg);
-            } else {
-                delete sym ;
-            }
+    BStream str (BVector (&data[0], size), !is_little_endian()) ;
+    int entsize = fileclass == ELFCLASS64 ? 24 : 16 ;
+    while (str.remaining() >= entsize) {
+        ELFSymbol sym ;
+        uint32_t nameindex = str.read4u() ;
+        uint16_t shndx ;
+        if (fileclass == ELFCLASS64) {
+            sym.info = str.read1u() ;
+            sym.other = str.read1u() ;
+            shndx = str.read2u() ;
+            sym.value = str.read8u() ;
+            sym.size = str.read8u() ;
         } else {
-            delete sym ;
+            sym.value = (uint32_t)str.read4u() ;
+            sym.size = (uint32_t)str.read4u() ;
+            sym.info = str.read1u() ;
+            sym.other = str.read1u() ;
+            shndx = str.read2u() ;
         }
+        // only keep the symbol if it is not hidden and it has a valid section index
+        if (ELF32_ST_VISIBILITY (sym.other) == STV_HIDDEN || shndx == 0 || nameindex >= strsize) {
+            continue ;
+        }
+        int type = ELF32_ST_TYPE (sym.info) ;
+        if (type != STT_OBJECT && type != STT_FUNC && type != STT_NOTYPE) {
+            continue ;
+        }
+        sym.value += baseaddr ;
+        sym.section = find_section_by_index ((int16_t)shndx) ;
+        sym.name = strings + nameindex ;
+        char *version = strstr (strings + nameindex, "@@") ;
+        if (version != NULL) {
+            *version = 0 ;              // the copy is ours
+        }
+        syms.push_back (sym) ;
     }
 }
 
+// Sort the symbols on address and hash their names.  Where names are the
+// same the symbol read last is found.
+void ELF::index_symbols (std::vector<ELFSymbol> &syms) {
+    uint32_t n = syms.size() ;
+    std::vector<uint32_t> order (n) ;
+    for (uint32_t i = 0 ; i < n ; i++) {
+        order[i] = i ;
+    }
+    std::stable_sort (order.begin(), order.end(), Compare_symbols (syms)) ;
+    std::vector<uint32_t> position (n) ;
+    symbols.resize (n) ;
+    for (uint32_t i = 0 ; i < n ; i++) {
+        symbols[i] = syms[order[i]] ;
+        position[order[i]] = i ;
+    }
+
+    uint32_t nslots = 16 ;
+    while (nslots < n * 2) {
+        nslots *= 2 ;
+    }
+    names.assign (nslots, 0) ;
+    same_names.assign (n, 0) ;
+    for (uint32_t i = 0 ; i < n ; i++) {
+        const char *name = syms[i].name ;
+        uint32_t slot = hash_name (name, false) & (nslots - 1) ;
+        while (names[slot] != 0 && strcmp (symbols[names[slot]-1].name, name) != 0) {
+            slot = (slot + 1) & (nslots - 1) ;
+        }
+        same_names[position[i]] = names[slot] ;
+        names[slot] = position[i] + 1 ;
+    }
+}
+
+// where names differ only in case keep the greatest, whatever order the
+// hash table is in
 void ELF::make_cb_symbol_table() {
     if (caseblind_ok) {
         return ;
     }
-    for (ELFSymbolMap::iterator i = symbols.begin() ; i != symbols.end() ; i++) {
-        cbsymbols[Utils::toUpper(i->first)] = i->second ;
+    uint32_t nslots = names.size() ;
+    cbnames.assign (nslots, 0) ;
+    for (uint32_t i = 0 ; i < nslots ; i++) {
+        if (names[i] == 0) {
+            continue ;
+        }
+        const char *name = symbols[names[i]-1].name ;
+        uint32_t slot = hash_name (name, true) & (nslots - 1) ;
+        while (cbnames[slot] != 0 && strcasecmp (symbols[cbnames[slot]-1].name, name) != 0) {
+            slot = (slot + 1) & (nslots - 1) ;
+        }
+        if (cbnames[slot] == 0 || strcmp (symbols[cbnames[slot]-1].name, name) < 0) {
+            cbnames[slot] = names[i] ;
+        }
     }
     caseblind_ok = true ;
 }
@@ -618,70 +785,145 @@ void ELF::make_cb_symbol_table() {
 void ELF::read_symbol_table(std::istream & stream, Address baseaddr) {
     Section *symtab = NULL ;
     Section *strtab = NULL ;
+    std::vector<ELFSymbol> syms ;
 
     symtab = find_section (".symtab") ;// Section object
     strtab = find_section (".strtab") ;// section object
     if (symtab != NULL && strtab != NULL) {
-       read_symtab (stream, symtab, baseaddr, strtab) ;
+       read_symtab (stream, symtab, baseaddr, strtab, syms) ;
     }
 
     symtab = find_section (".dynsym") ;// Section object
     strtab = find_section (".dynstr") ;// section object
     if (symtab != NULL && strtab != NULL) {
-       read_symtab (stream, symtab, baseaddr, strtab) ;
+       read_symtab (stream, symtab, baseaddr, strtab, syms) ;
     }
+
+    // index now, the caseblind table too, so that later lookups don't
+    // modify the tables; the symbol table may be reading them on a
+    // background thread
+    index_symbols (syms) ;
+    make_cb_symbol_table() ;
 }
 
-Address ELF::find_symbol(std::string name, bool caseblind) {
-    if (caseblind) {
-        if (!caseblind_ok) {
-            make_cb_symbol_table() ;
-        }
-        ELFSymbolMap::iterator symi = cbsymbols.find (Utils::toUpper(name)) ;
-        if (symi == cbsymbols.end()) {
-            return 0 ;
+ELFSymbol *ELF::lookup_symbol(std::string name, bool caseblind) {
+    if (caseblind && !caseblind_ok) {
+        make_cb_symbol_table() ;
+    }
+    std::vector<uint32_t> &table = caseblind ? cbnames : names ;
+    uint32_t nslots = table.size() ;
+    if (nslots == 0) {
+        return NULL ;
+    }
+    uint32_t slot = hash_name (name.c_str(), caseblind) & (nslots - 1) ;
+    while (table[slot] != 0) {
+        ELFSymbol *sym = &symbols[table[slot]-1] ;
+        if ((caseblind ? strcasecmp (sym->name, name.c_str()) : strcmp (sym->name, name.c_str())) == 0) {
+            return sym ;
         }
-        return symi->second->get_value() ;
-    } else {
-        ELFSymbolMap::iterator symi = symbols.find (name) ;
-        if (symi == symbols.end()) {
-            return 0 ;
+        slot = (slot + 1) & (nslots - 1) ;
+    }
+    return NULL ;
+}
+
+Address ELF::find_symbol(std::string name, bool caseblind) {
+    ELFSymbol *sym = lookup_symbol (name, caseblind) ;
+    return sym == NULL ? 0 : sym->get_value() ;
+}
+
+// the symbol found by name, then the others with the same name
+void ELF::find_symbols(std::string name, std::vector<ELFSymbol *> &syms) {
+    ELFSymbol *sym = lookup_symbol (name, false) ;
+    if (sym == NULL) {
+        return ;
+    }
+    uint32_t i = sym - &symbols[0] ;
+    for (;;) {
+        syms.push_back (&symbols[i]) ;
+        if (same_names[i] == 0) {
+            break ;
         }
-        return symi->second->get_value() ;
+        i = same_names[i] - 1 ;
     }
 }
 
 Section *ELF::find_symbol_section(std::string name, bool caseblind) {
-    if (caseblind) {
-        if (!caseblind_ok) {
-            make_cb_symbol_table() ;
-        }
-        ELFSymbolMap::iterator symi = cbsymbols.find (Utils::toUpper(name)) ;
-        if (symi == cbsymbols.end()) {
-            return NULL ;
-        }
-        return symi->second->get_section() ;
-    } else {
-        ELFSymbolMap::iterator symi = symbols.find (name) ;
-        if (symi == symbols.end()) {
-            return NULL ;
-        }
-        return symi->second->get_section() ;
+    ELFSymbol *sym = lookup_symbol (name, caseblind) ;
+    return sym == NULL ? NULL : sym->get_section() ;
+}
+
+// of two symbols that an address is in, is sym the better name for it?
+static bool better_symbol (ELFSymbol *sym, ELFSymbol *best) {
+    bool global = ELF64_ST_BIND (sym->get_info()) == STB_GLOBAL ;
+    bool bestglobal = ELF64_ST_BIND (best->get_info()) == STB_GLOBAL ;
+    if (global != bestglobal) {
+        return global ;
     }
+    return sym->get_size() > best->get_size() ;
 }
 
+// The symbol an address is in.  Of the symbols at the nearest address at
+// or before it, one whose size covers the address is taken, a global one
+// first and then the largest.  Symbols with no size (assembler labels,
+// _start, PLT stubs) are taken to run to the next symbol, but a local one
+// gives way to a function that starts before it and covers the address.
 void ELF::find_symbol_at_address(Address addr, std::string &name, int &offset) {
-   ELFSymbol* sym;
-
-   /* lookup of the address */
-   if ( symmap.get(addr, &sym) ) {
-      name = "";
-      offset = 0;
-      return;
-   }
+    name = "" ;
+    offset = 0 ;
+
+    // the first symbol after addr
+    uint32_t low = 0 ;
+    uint32_t high = symbols.size() ;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2 ;
+        if (addr < symbols[mid].value) {
+            high = mid ;
+        } else {
+            low = mid + 1 ;
+        }
+    }
+    if (low == 0) {
+        return ;
+    }
+    Address value = symbols[low-1].value ;
+    ELFSymbol *best = NULL ;            // covers addr
+    ELFSymbol *label = NULL ;           // has no size
+    uint32_t i = low ;
+    for ( ; i > 0 && symbols[i-1].value == value ; i--) {
+        ELFSymbol *sym = &symbols[i-1] ;
+        if (sym->size == 0) {
+            if (label == NULL || (ELF64_ST_BIND (sym->info) == STB_GLOBAL && ELF64_ST_BIND (label->info) != STB_GLOBAL)) {
+                label = sym ;
+            }
+        } else if (addr - value < (Address)sym->size && (best == NULL || better_symbol (sym, best))) {
+            best = sym ;
+        }
+    }
 
-   name = sym->get_name();
-   offset = addr - sym->value;
+    // past the end of the sized symbols there, or at a local label: look
+    // back to the nearest sized symbol for a function the address is in
+    if (best == NULL && (label == NULL || ELF64_ST_BIND (label->info) != STB_GLOBAL)) {
+        while (i > 0 && symbols[i-1].size == 0) {
+            i-- ;
+        }
+        if (i > 0) {
+            Address start = symbols[i-1].value ;
+            for ( ; i > 0 && symbols[i-1].value == start ; i--) {
+                ELFSymbol *sym = &symbols[i-1] ;
+                if (sym->size != 0 && addr - start < (Address)sym->size && (best == NULL || better_symbol (sym, best))) {
+                    best = sym ;
+                }
+            }
+        }
+    }
+    if (best == NULL) {
+        best = label ;
+    }
+    if (best == NULL) {
+        return ;
+    }
+    name = best->name ;
+    offset = addr - best->value ;
 }
 
 Section *ELF::find_section_at_addr(Address addr) {
@@ -696,9 +938,8 @@ Section *ELF::find_section_at_addr(Address addr) {
 }
 
 void ELF::list_symbols(PStream &os) {
-    Map_Range<Address,ELFSymbol*>::iterator i;
-    for (i=symmap.begin(); i!=symmap.end(); ++i) {
-       ELFSymbol* sym = i->val;
+    for (unsigned int i = 0 ; i < symbols.size() ; i++) {
+       ELFSymbol* sym = &symbols[i] ;
        std::string name = sym->get_name() ;
        Address value = sym->get_value() ;
        os.print ("\t%-30s 0x%llx\n", name.c_str(), value) ;
@@ -707,9 +948,8 @@ void ELF::list_symbols(PStream &os) {
 
 
 void ELF::list_functions(PStream &os) {
-    Map_Range<Address,ELFSymbol*>::iterator i;
-    for (i=symmap.begin(); i!=symmap.end(); ++i) {
-       ELFSymbol* sym = i->val;
+    for (unsigned int i = 0 ; i < symbols.size() ; i++) {
+       ELFSymbol* sym = &symbols[i] ;
        if (ELF64_ST_TYPE(sym->get_info()) == STT_FUNC) {
            std::string name = sym->get_name() ;
            Address value = sym->get_value() ;
@@ -719,9 +959,8 @@ void ELF::list_functions(PStream &os) {
 }
 
 void ELF::list_variables(PStream &os) {
-    Map_Range<Address,ELFSymbol*>::iterator i;
-    for (i=symmap.begin(); i!=symmap.end(); ++i) {
-       ELFSymbol *sym = i->val;
+    for (unsigned int i = 0 ; i < symbols.size() ; i++) {
+       ELFSymbol *sym = &symbols[i] ;
        if (ELF64_ST_TYPE(sym->get_info()) == STT_OBJECT) {
            std::string name = sym->get_name() ;
            Address value = sym->get_value() ;
@@ -36,7 +36,6 @@ author: David Allison <dallison@pathscale.com>
 
 #include "bstream.h"
 #include "pstream.h"
-#include "map_range.h"
 #include "arch.h"
 #include "os.h"
 
@@ -69,10 +68,6 @@ private:
     Address baseaddr ;
 } ;
 
-class ELFSymbol ;
-
-typedef std::map<std::string, ELFSymbol *> ELFSymbolMap ;
-
 class Section {
 public:
     Section(ELF *elf, int index) ;
@@ -88,11 +83,21 @@ public:
     std::string read_string (std::istream & stream, int stroffset) ;
     int32_t read_word4(std::istream & stream, int stroffset);
     BVector get_contents (std::istream & stream) ;
+    ELF *get_elf () { return elf ; }
+    bool is_compressed () { return compression != SC_NONE ; }
+    uint64_t get_uncompressed_size (std::istream & stream) ;
+    void decompress (std::istream & stream, byte *dest, uint64_t destsize) ;
 protected:
 private:
+    enum Compression {
+        SC_NONE,
+        SC_ELF,                         // SHF_COMPRESSED, after an ELF compression header
+        SC_ZDEBUG                       // a .zdebug_ section, after "ZLIB" and the size
+    } ;
     ELF *elf ;
     int index ; 
     std::string name ; 
+    Compression compression ; 
     int32_t nameindex ; 
     int32_t type ; 
     int64_t flags ; 
@@ -105,37 +110,31 @@ private:
     int64_t entsize ; 
 } ;
 
+// A symbol from .symtab or .dynsym.  The ELF file keeps its symbols in
+// one array sorted on address, and finds them by name through an open
+// addressed hash table of indexes into the array.  The names point into
+// the ELF file's copy of the string table.
+
 class ELFSymbol {
 public:
-    ELFSymbol(ELF *elf) ;
-    ~ELFSymbol() ; 
-    std::string get_name () ;
-    const char *get_c_name () { return name.c_str() ; }
-    Address get_value () ;
-    Section* get_section () ;
-    int read (std::istream & stream, Address baseaddr) ;
-    void set_name (std::istream & stream, Section * nametable) ;
-    int get_size () ;
-    void print () ;
-    Address value ; 
-    bool operator < (ELFSymbol &sym) { return value < sym.value ; }
+    std::string get_name () { return name ; }
+    const char *get_c_name () { return name ; }
+    Address get_value () { return value ; }
+    Section* get_section () { return section ; }
+    int64_t get_size () { return size ; }
     byte get_info() { return info ; }
     byte get_other() { return other ; }
-    int get_section_index() { return shndx ; }
-protected:
 private:
-    ELF *elf ;
-    std::string name ; 
-    int32_t nameindex ; 
+    friend class ELF ;
+    const char *name ;
+    Address value ; 
     int64_t size ; 
+    Section* section ; 
     byte info ; 
     byte other ; 
-    int16_t shndx ; 
-    Section* section ; 
 } ;
 
 class ELF {
-    friend class ELFSymbol ;
     friend class Section ;
     friend class ProgramSegment ;
 
@@ -148,8 +147,11 @@ public:
     BVector get_section (std::istream & stream, std::string name) ;
     Section *find_section (std::string name) ;
     Section *find_section_by_index (int index) ;
+    std::string get_build_id (std::istream & stream) ;                 // in hex, or ""
+    std::string get_debuglink (std::istream & stream, uint32_t &crc) ;  // "" if none
     void read_symbol_table (std::istream & stream, Address baseaddr) ;
     Address find_symbol (std::string name, bool caseblind = false) ;
+    void find_symbols (std::string name, std::vector<ELFSymbol *> &syms) ;     // all with the name
     Section *find_symbol_section (std::string name, bool caseblind = false) ;
     void find_symbol_at_address (Address addr, std::string &name, int &offset) ;
     Section *find_section_at_addr (Address addr) ;
@@ -160,10 +162,8 @@ public:
     ProgramSegment *get_segment (int i) { return segments[i]; }
     Address get_base() { return base ; }                        // base address
 
-
-    Map_Range<Address,ELFSymbol*>& get_symbols() {
-       return symmap;
-    }
+    int get_num_symbols() { return symbols.size() ; }
+    ELFSymbol &get_symbol (int i) { return symbols[i] ; }       // in address order
 
     ProgramSegment *find_segment (Address addr) ;
     std::string get_name() { return name ; }
@@ -172,7 +172,12 @@ public:
     void prstatus_to_pname(BStream *stream, int size, std::string &pname);
 protected:
 private:
-    void read_symtab (std::istream &stream, Section *symtab, Address baseaddr, Section *strtab) ;
+    void read_symtab (std::istream &stream, Section *symtab, Address baseaddr, Section *strtab,
+                      std::vector<ELFSymbol> &syms) ;
+    char *read_strings (std::istream &stream, Section *strtab) ;
+    void index_symbols (std::vector<ELFSymbol> &syms) ;
+    ELFSymbol *lookup_symbol (std::string name, bool caseblind) ;
+    void make_cb_symbol_table() ;
     byte read_byte (std::istream & stream) ;
     int64_t read_word8 (std::istream & stream) ;
     int32_t read_word4 (std::istream & stream) ;
@@ -206,12 +211,12 @@ private:
     std::vector<Section *> sections ; 
     std::vector<ProgramSegment *> segments ; 
 
-    Map_Range<Address,ELFSymbol*> symmap;
-
-    ELFSymbolMap symbols ; // map of name vs ELFSymbol
-    ELFSymbolMap cbsymbols ; // map of name vs ELFSymbol (case blind)
+    std::vector<ELFSymbol> symbols ;    // sorted on address
+    std::vector<uint32_t> names ;       // hash of names, 1 + index in symbols or 0
+    std::vector<uint32_t> same_names ;  // 1 + index of the next symbol with the same name, or 0
+    std::vector<uint32_t> cbnames ;     // the same ignoring case, made when needed
     bool caseblind_ok ;
-    void make_cb_symbol_table() ;
+    std::vector<char *> strtabs ;       // the string tables the names are in
     Address base ;
 } ;
 
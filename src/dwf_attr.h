@@ -49,13 +49,16 @@ enum AVType {
     AV_ADDRESS
 } ;
 
+// The value of an attribute, decoded from .debug_info when it is asked for.
+// Strings point into .debug_str or .debug_info and are not copied.
+
 struct AttributeValue {
-    AttributeValue (DIE *die) : type (AV_DIE), die(die) { }
-    AttributeValue (BVector block) : type (AV_BLOCK), block(block) {}
-    AttributeValue (std::string s) : type (AV_STRING), str(s) { }
-    AttributeValue (int64_t i):type (AV_INTEGER), integer(i) {}
-    AttributeValue (int i):type (AV_INTEGER), integer(i) {}
-    AttributeValue(): type(AV_NONE), integer(0) {}
+    AttributeValue (DIE *die) : type (AV_DIE), die(die), str("") { }
+    AttributeValue (BVector block) : type (AV_BLOCK), integer(0), block(block), str("") {}
+    AttributeValue (const char *s) : type (AV_STRING), integer(0), str(s) { }
+    AttributeValue (int64_t i):type (AV_INTEGER), integer(i), str("") {}
+    AttributeValue (int i):type (AV_INTEGER), integer(i), str("") {}
+    AttributeValue(): type(AV_NONE), integer(0), str("") {}
 
     Value toValue (DIE* die);
 
@@ -87,22 +90,7 @@ struct AttributeValue {
         Address addr ;
     } ;
     BVector block ;
-    std::string str ;           // can't be in union
-} ;
-
-class Attribute {
-public:
-    Attribute(int form) ;
-    virtual ~Attribute() ;
-    int form ;
-    AttributeValue value ;
-
-    void set_value (DIE *die) { value.type = AV_DIE ; value.die = die ; }
-    void set_value (BVector block) { value.type = AV_BLOCK ; value.block = block ; }
-    void set_value (AVType type, int64_t integer) { value.type = type ; value.integer = integer ; }
-    void set_value (std::string &s) { value.type = AV_STRING ; value.str = s ; }
-
-    virtual void fixup (DIE *die) ;
+    const char *str ;           // "" unless a string
 } ;
 
 class AttributeAbbreviation {
@@ -112,11 +100,24 @@ public:
     void print() ;
     int getTag () ;
     int getForm () ;
-    AttributeValue read (DwCUnit *cu, Attribute *attr, BStream & stream) ;
+    AttributeValue read (DwCUnit *cu, BStream & stream) ;      // references are unit offsets
+    void skip (DwCUnit *cu, BStream & stream) ;
+    bool is_reference () ;                                      // to a DIE in the same unit
+    bool is_constant () ;                                       // data of a fixed or variable size
+
+    // where the value is, relative to the DIE's first attribute: offset
+    // bytes plus the size of addresses addresses.  offset is -1 if a
+    // value of varying size comes first
+    void set_position (int off, int addrs) { offset = off ; addresses = addrs ; }
+    int get_offset () { return offset ; }
+    int get_addresses () { return addresses ; }
+    int get_size (int &addrs) ;                                 // ditto for the value itself
 protected:
 private:
     int tag ;
     int form ;
+    int offset ;
+    int addresses ;
 } ;
 
 class Abbreviation {
@@ -132,6 +133,9 @@ public:
     int getTag () ;
     int getNumAttributes () ;
     AttributeAbbreviation *getAttribute (int i) ;
+    AttributeAbbreviation *findAttribute (int tag) ;
+    int get_size (int addrsize) ;                       // of the attribute values, -1 if it varies
+    bool has_links () { return links ; }                // sibling, specification or abstract origin
 protected:
 private:
     int num ;
@@ -139,6 +143,9 @@ private:
     bool haschildren ;
     std::vector<AttributeAbbreviation *> attributes ;
     AbbreviationMap table ; // map of abbreviation code vs Abbreviation
+    int size ;
+    int size_addresses ;
+    bool links ;
 } ;
 
 
@@ -147,14 +154,4 @@ std::ostream &operator << (std::ostream &os, AttributeValue &v) ;
 
 
 
-class FixupAttribute : public Attribute {
-public:
-    FixupAttribute (int form, DIE *parent) : Attribute (form),parent(parent) {}
-    ~FixupAttribute() {}
-    void fixup (DIE *die) ;
-private:
-    DIE *parent ;
-} ;
-
-
 #endif
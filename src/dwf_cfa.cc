@@ -216,7 +216,8 @@ CIE::print()
 
 // Frame Description Entry
 FDE::FDE(DwInfo * dwarf)
-:  CFAEntry(dwarf), cie(NULL), start_address(0), end_address(0)
+:  CFAEntry(dwarf), cie(NULL), start_address(0), end_address(0),
+   entry_offset(0), eh(false)
 {
 }
 
@@ -266,6 +267,8 @@ void
 FDE::read(Section * section, BStream& stream,
 	  int id, Offset offset, int length, bool is_eh)
 {
+   entry_offset = offset - 4;
+   eh = is_eh;
    if (is_eh) {
       /* for an eh_frame, the CIE address is the difference
        * between the address of the id and the FDE address */
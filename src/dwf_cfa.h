@@ -82,12 +82,16 @@ public:
     Address get_end_address() { return end_address ; }
     void print () ;
     CIE* get_cie () ;
+    Offset get_offset() { return entry_offset ; }
+    bool is_eh() { return eh ; }
 protected:
 private:
     Address read_value (Section *section, CIE *cie, BStream & stream, int mask) ;
     CIE *cie ;
     Address start_address ;
     Address end_address ;
+    Offset entry_offset ;               // offset of the entry in its section
+    bool eh ;                           // in .eh_frame
     BVector instructions ;
 } ;
 
@@ -40,8 +40,14 @@ author: David Allison <dallison@pathscale.com>
 #include "type_qual.h"
 
 #include <ios>
-
-DwCUnit::DwCUnit (DwInfo *dwarf) : dwarf(dwarf), mainstream(BVector(),0), abbrev(NULL)
+#include <iostream>
+#include <algorithm>
+
+DwCUnit::DwCUnit (DwInfo *dwarf) : dwarf(dwarf), mainstream(BVector(),0), abbrev(NULL), cu_die(NULL), deferred(false),
+    skeleton(false), split(false), skeleton_die(NULL), split_abbrev(NULL), addr_base(0),
+    split_locations(NULL),
+    expanded(true), language(0), children_offset(0), lines_read(true), line_program(0), line_end(0),
+    min_instruction_length(1), default_is_stmt(0), line_base(0), line_range(1), opcode_base(1)
  {
 }
 
@@ -56,26 +62,152 @@ DwCUnit::~DwCUnit() {
         delete file_table[i] ;
     }
 
+    delete skeleton_die ;
+    delete split_locations ;
+
     // delete the abbreviation
     delete abbrev ;
 
-    // delete the line matrix
-    for (uint i = 0 ; i < line_matrix.size() ; i++) {
-        delete line_matrix[i] ;
+    for (LocProgramMap::iterator i = loc_programs.begin() ; i != loc_programs.end() ; i++) {
+        delete i->second ;
     }
 }
 
 void DwCUnit::register_symbol (std::string name, DIE *die) {
+    if (deferred) {
+        registrations.push_back (Registration (REG_SYMBOL, name, die)) ;
+        return ;
+    }
     dwarf->register_symbol (name, die) ;
 }
 
 void DwCUnit::register_subprogram (std::string name, DIE *die) {
     int has_pc = die->getAttribute (DW_AT_low_pc, false) ;
     if (has_pc) {
+        if (deferred) {
+            registrations.push_back (Registration (REG_SUBPROGRAM, name, die)) ;
+            return ;
+        }
         dwarf->register_subprogram (name, die) ;
     }
 }
 
+void DwCUnit::register_struct (std::string name, DIE *die) {
+    if (deferred) {
+        registrations.push_back (Registration (REG_STRUCT, name, die)) ;
+        return ;
+    }
+    dwarf->register_struct (name, die) ;
+}
+
+void DwCUnit::warn (const char *message) {
+    if (deferred) {
+        warnings += message ;
+        return ;
+    }
+    std::cerr << message ;
+}
+
+void DwCUnit::flush_registrations() {
+    deferred = false ;
+    if (warnings != "") {
+        std::cerr << warnings ;
+        warnings.clear() ;
+    }
+    for (uint i = 0 ; i < registrations.size() ; i++) {
+        Registration &r = registrations[i] ;
+        switch (r.kind) {
+        case REG_SUBPROGRAM:
+            dwarf->register_subprogram (r.name, r.die) ;
+            break ;
+        case REG_SYMBOL:
+            dwarf->register_symbol (r.name, r.die) ;
+            break ;
+        case REG_STRUCT:
+            dwarf->register_struct (r.name, r.die) ;
+            break ;
+        }
+    }
+    registrations.clear() ;
+}
+
+void DwCUnit::restore (Offset offset, int length, int lang, std::string cuname, std::string cdir) {
+    start_offset = offset ;
+    stream_offset = offset ;
+    debug_info_length = length ;
+    language = lang ;
+    name = cuname ;
+    comp_dir = cdir ;
+    expanded = false ;
+}
+
+void DwCUnit::restore_directory (std::string dirname) {
+    directory_table.push_back (dirname) ;
+}
+
+void DwCUnit::restore_file (const char *filename, int dir, int mtime, int size) {
+    if (filename == NULL) {
+        file_table.push_back (NULL) ;
+    } else {
+        file_table.push_back (new File (directory_table, comp_dir, filename, dir, mtime, size)) ;
+    }
+}
+
+// read the DIEs of a unit that has not been fully read.  If only the root DIE
+// was read, the symbols are registered as the children are read and the line
+// program is run.  A unit restored from the symbol cache has no DIEs at all;
+// the symbol table already has its symbols, so the registrations are dropped.
+void DwCUnit::expand() {
+    if (expanded) {
+        return ;
+    }
+    expanded = true ;
+    if (cu_die != NULL) {
+        // reading a DIE may load a lazy DIE, which moves mainstream
+        BStream stream = mainstream ;
+        stream.seek (children_offset) ;
+        cu_die->read_children (this, stream) ;
+        read_lines() ;
+        dwarf->unit_expanded() ;
+        return ;
+    }
+    // the unit must still be where the cache said it was
+    BVector info = dwarf->get_debug_info() ;
+    BStream stream (info, do_swap()) ;
+    if (start_offset < 0 || start_offset + debug_info_length + 4 > (Offset)info.length()) {
+        throw Exception ("The symbol cache does not match the debug information") ;
+    }
+    stream.seek (start_offset) ;
+    if (stream.read4u() != debug_info_length) {
+        throw Exception ("The symbol cache does not match the debug information") ;
+    }
+    stream.seek (start_offset) ;
+    deferred = true ;
+    read (stream) ;
+    deferred = false ;
+    registrations.clear() ;
+    if (warnings != "") {
+        std::cerr << warnings ;
+        warnings.clear() ;
+    }
+}
+
+std::string DwCUnit::get_name() {
+    if (cu_die == NULL) {
+        return name ;
+    }
+    return cu_die->get_name() ;
+}
+
+DIE *DwCUnit::find_die (Offset offset) {
+    expand() ;
+    OffsetMap::iterator die = dies.find (offset) ;
+    if (die == dies.end()) {
+        return NULL ;
+    }
+    return die->second ;
+}
+
 bool DwCUnit::is_64bit() {
   return dwarf->is_elf64();
 }
@@ -116,7 +248,7 @@ void DwCUnit::add_die(Offset offset, DIE * die) {
             case DW_TAG_structure_type:
             case DW_TAG_class_type:
             case DW_TAG_union_type:
-                dwarf->register_struct (die->get_name(), die) ;
+                register_struct (die->get_name(), die) ;
                 break ;
             }
         }
@@ -143,43 +275,53 @@ int DwCUnit::getAddrSize() {
     return addr_size ;
 }
 
+// the first abbreviation of a unit's table holds the rest.  It is not
+// necessarily the one for the compile_unit DIE (newer GCCs order the
+// abbreviations by how often they are used)
 Abbreviation * DwCUnit::getAbbreviation(int num) {
+       Abbreviation *abbrev = split_abbrev != NULL ? split_abbrev : this->abbrev ;
+       if (num == abbrev->getNum()) {
+           return abbrev ;
+       }
        return abbrev->getAbbreviation (num) ;
 }
 
-DIE * DwCUnit::get_die(Attribute * attr, Offset off) {
+DIE * DwCUnit::lookup_die(Offset off) {
     OffsetMap::iterator die = dies.find (off) ;
     if (die == dies.end()) {
-       addFixup (attr, off) ;
        return NULL ;
     } else {
        return die->second ;
     }
 }
 
-void DwCUnit::addFixup(Attribute * attr, Offset offset) {
-       FixupMap::iterator entry = fixups.find(offset) ;
-       if (entry == fixups.end()) {
-           AttrVec v ;
-           v.push_back (attr) ;
-           fixups[offset] = v ;
-       } else {
-           entry->second.push_back (attr) ;
-       }
+// compare fixups and lazy DIEs with an offset for the binary searches
+class Compare_offset {
+public:
+    bool operator() (const LazyDIE &ld, Offset offset) { return ld.start < offset ; }
+    bool operator() (Offset offset, const LazyDIE &ld) { return offset < ld.start ; }
+    template <class F> bool operator() (const F &f, Offset offset) { return f.offset < offset ; }
+    template <class F> bool operator() (Offset offset, const F &f) { return offset < f.offset ; }
+} ;
+
+void DwCUnit::add_fixup(Offset offset, DIE * die) {
+    FixupVec::iterator i = std::upper_bound (fixups.begin(), fixups.end(), offset, Compare_offset()) ;
+    fixups.insert (i, Fixup (offset, die)) ;
 }
 
+// the DIE at offset has been read.  It provides more information for the
+// DIEs that refer to it with a DW_AT_specification or DW_AT_abstract_origin
 void DwCUnit::dofixup(Offset offset, DIE * die) {
-    FixupMap::iterator entry = fixups.find (offset) ;
-    if (entry != fixups.end()) {
-       if (entry->second.size() == 0) {
-           throw Exception ("empty fixup list") ;
-       }
-       for (uint i = 0 ; i < entry->second.size(); i++) {
-           Attribute *fixup = entry->second[i];
-           fixup->fixup (die) ;
-       }
-       fixups.erase(entry) ; 
+    if (fixups.empty()) {
+        return ;
     }
+    FixupVec::iterator start = std::lower_bound (fixups.begin(), fixups.end(), offset, Compare_offset()) ;
+    FixupVec::iterator end = start ;
+    while (end != fixups.end() && end->offset == offset) {
+        die->set_more_info (end->die) ;
+        end++ ;
+    }
+    fixups.erase (start, end) ;
 }
 
 Address DwCUnit::get_base() {
@@ -197,7 +339,7 @@ Compiled with DWARF 2 debugging format.
 Does not include preprocessor macro info.
 */
 void DwCUnit::info (PStream &os) {
-    std::string name = cu_die->getAttribute (DW_AT_name) ;
+    std::string name = get_cu_die()->getAttribute (DW_AT_name) ;
     os.print ("Current source file is %s\n", name.c_str()) ;
     if (comp_dir != "") {
         os.print ("Compilation directory is %s\n", comp_dir.c_str()) ;
@@ -262,8 +404,11 @@ DIE *DwCUnit::find_struct (std::string name) {
 }
 
 
-void DwCUnit::read(BStream &stream) {
+// read the unit.  If rootonly is set only the root DIE is read and the rest
+// is left for expand()
+void DwCUnit::read(BStream &stream, bool rootonly) {
        start_offset = stream.offset() ;
+       stream_offset = start_offset ;
        mainstream = stream ;
        debug_info_length = stream.read4u() ;
        if (debug_info_length == 0) {
@@ -278,11 +423,17 @@ void DwCUnit::read(BStream &stream) {
            throw Exception ("Can't find compilation unit abbreviation at this offset ") ;
        }
        int num = stream.read_uleb() ;                      // abbreviation number
-       (void) num;
        Offset offset = stream.offset() ;
-       cu_die = make_die (this, NULL, abbrev) ;
+       cu_die = make_die (this, NULL, getAbbreviation (num)) ;
        add_die (offset - start_offset, cu_die) ;
-       cu_die->read (this, stream) ;
+       if (rootonly) {
+           Offset sibling ;
+           cu_die->read_attributes (this, stream, sibling) ;
+           children_offset = stream.offset() ;
+           expanded = false ;
+       } else {
+           cu_die->read (this, stream) ;
+       }
        AttributeValue cdir = cu_die->getAttribute (DW_AT_comp_dir) ;
        if (cdir.type != AV_NONE) {
            comp_dir = cdir.str ;
@@ -291,11 +442,96 @@ void DwCUnit::read(BStream &stream) {
                comp_dir = comp_dir.substr (colon+1) ;
            }
        }
+       if (cu_die->getAttribute (DW_AT_GNU_dwo_name, false).type != AV_NONE) {
+           skeleton = true ;
+           AttributeValue base = cu_die->getAttribute (DW_AT_GNU_addr_base, false) ;
+           addr_base = base.type == AV_NONE ? 0 : base.integer ;
+           if (!rootonly) {
+               read_split_root() ;
+               if (split) {
+                   BStream children = mainstream ;
+                   children.seek (children_offset) ;
+                   cu_die->read_children (this, children) ;
+               }
+           }
+       }
        stream.seek (start_offset + debug_info_length + 4) ;             // seek to the correct address
        //cu_die->dump(0) ;
 }
 
+// replace the root DIE of a skeleton unit with the root of its split unit.
+// The attributes of the skeleton, such as the code addresses and the line
+// table, are copied to the new root.  If the split unit can't be found the
+// skeleton is kept, so the unit has no DIEs but its lines can be used
+void DwCUnit::read_split_root() {
+    if (!skeleton) {
+        return ;
+    }
+    skeleton = false ;
+    std::string dwoname = cu_die->getAttribute (DW_AT_GNU_dwo_name, false).str ;
+    AttributeValue id = cu_die->getAttribute (DW_AT_GNU_dwo_id, false) ;
+    SplitUnit unit ;
+    if (id.type == AV_NONE || !dwarf->find_split_unit (this, dwoname, id.integer, unit)) {
+        warn (("Can't find the split DWARF unit " + dwoname + "\n").c_str()) ;
+        return ;
+    }
+    split_abbrev = unit.abbrev ;
+    str_offsets = unit.str_offsets ;
+    split_strings = unit.strings ;
+    split_locations = new LocationListTable (unit.loc, BVector()) ;
+
+    BStream stream (unit.info, do_swap()) ;
+    stream.seek (unit.offset + 11) ;                    // past the unit header
+    int num = stream.read_uleb() ;                      // abbreviation number
+    Offset offset = stream.offset() ;
+    DIE *root = make_die (this, NULL, getAbbreviation (num)) ;
+    root->copy_attributes (cu_die) ;                    // while the skeleton's stream is still the unit's
+    mainstream = stream ;
+    stream_offset = unit.offset ;
+    Offset sibling ;
+    root->read_attributes (this, stream, sibling) ;
+    children_offset = stream.offset() ;
+
+    for (OffsetMap::iterator i = dies.begin() ; i != dies.end() ; i++) {
+        if (i->second == cu_die) {
+            dies.erase (i) ;
+            break ;
+        }
+    }
+    skeleton_die = cu_die ;
+    cu_die = root ;
+    add_die (offset - stream_offset, root) ;
+    split = true ;
+}
+
+// the address at an index into the unit's part of .debug_addr
+Address DwCUnit::get_indexed_address (int64_t index) {
+    BVector addrs = dwarf->get_debug_addr() ;
+    Offset offset = addr_base + index * addr_size ;
+    if (index < 0 || offset + addr_size > (Offset)addrs.length()) {
+        throw Exception ("Invalid address index %lld", (long long)index) ;
+    }
+    BStream stream (addrs, do_swap()) ;
+    stream.seek (offset) ;
+    return read_address (stream) ;
+}
+
+// the string at an index into the split unit's string offsets
+const char *DwCUnit::get_indexed_string (int64_t index) {
+    if (index < 0 || (index + 1) * 4 > (int64_t)str_offsets.length()) {
+        throw Exception ("Invalid string index %lld", (long long)index) ;
+    }
+    BStream stream (str_offsets, do_swap()) ;
+    stream.seek (index * 4) ;
+    uint32_t offset = stream.read4u() ;
+    if (offset >= split_strings.length()) {
+        throw Exception ("Invalid string index %lld", (long long)index) ;
+    }
+    return (const char *)split_strings.get_data() + offset ;
+}
+
 void DwCUnit::dump() {
+    expand() ;
     for (OffsetMap::iterator i = dies.begin() ; i != dies.end() ; i++) {
         DIE *die = i->second ;
         if (die->get_parent() == NULL) {
@@ -305,16 +541,39 @@ void DwCUnit::dump() {
 
 }
 
+// the later standards of a language are treated as the first
+static int base_language (int lang) {
+    switch (lang) {
+    case DW_LANG_C99:
+    case DW_LANG_C11:
+        return DW_LANG_C89 ;
+    case DW_LANG_C_plus_plus_03:
+    case DW_LANG_C_plus_plus_11:
+    case DW_LANG_C_plus_plus_14:
+        return DW_LANG_C_plus_plus ;
+    case DW_LANG_Fortran03:
+    case DW_LANG_Fortran08:
+        return DW_LANG_Fortran95 ;
+    }
+    return lang ;
+}
+
 int DwCUnit::get_language() {
-     AttributeValue &lang = cu_die->getAttribute (DW_AT_language) ;
+     if (cu_die == NULL) {
+         if (language == 0) {
+             throw Exception ("No language specifed in the compilation unit") ;
+         }
+         return language ;
+     }
+     AttributeValue lang = cu_die->getAttribute (DW_AT_language) ;
      if (lang.type == AV_NONE) {
          throw Exception ("No language specifed in the compilation unit") ;
      }
-     return (int)lang ;
+     return base_language ((int)lang) ;
 }
 
 void DwCUnit::show_symbols() {
-       int lang = cu_die->getAttribute (DW_AT_language) ;
+       int lang = get_cu_die()->getAttribute (DW_AT_language) ;
        (void) lang;
        for (DIEMap::iterator i = symbols.begin() ; i != symbols.end() ; i++) {
            // DIE *symbol = i->second ;
@@ -334,7 +593,10 @@ static std::string readstring (BStream &stream) {
   return s ;
 }
 
-void DwCUnit::build_line_matrix(BVector data) {
+// read the header of the unit's line table, which has the directory and file
+// tables.  The rows are added to the line table by read_lines() when they
+// are needed
+void DwCUnit::read_line_header(BVector data) {
       if (cu_die == NULL) {
           return ;
       }
@@ -343,8 +605,6 @@ void DwCUnit::build_line_matrix(BVector data) {
           return ;
       }
 
-      bool debug = false;                      // make true to print debug info
-
       Offset offset = av.integer ;
       BStream stream (data, do_swap());
       stream.seek (offset) ;
@@ -352,14 +612,16 @@ void DwCUnit::build_line_matrix(BVector data) {
       // prolog variables
       int total_length = stream.read4u() ;
       int version = stream.read2u() ;
-      (void) version;
       int prolog_length = stream.read4u() ;
       int end_prolog = stream.offset() ;// offset at end of prolog
-      int min_instruction_length = stream.read1u() ;
-      int default_is_stmt = stream.read1u() ;
-      int line_base = stream.read1s() ;
-      int line_range = stream.read1u() ;
-      int opcode_base = stream.read1u() ;
+      min_instruction_length = stream.read1u() ;
+      if (version >= 4) {
+          stream.read1u() ;                     // maximum operations per instruction
+      }
+      default_is_stmt = stream.read1u() ;
+      line_base = stream.read1s() ;
+      line_range = stream.read1u() ;
+      opcode_base = stream.read1u() ;
 
       //std::cout << "line_base = " << line_base << "\n" ;
       // read opcode lengths
@@ -391,6 +653,29 @@ void DwCUnit::build_line_matrix(BVector data) {
           file_table.push_back (new File (directory_table, comp_dir, filename, dir, mtime, size)) ;
       }
 
+      // we may need to skip to the start of the program
+      line_data = data ;
+      line_program = end_prolog + prolog_length ;
+      line_end = offset + total_length + 4 ;// according to spec, the total length doesn't include the field
+      lines_read = false ;
+}
+
+void DwCUnit::read_lines() {
+      if (lines_read) {
+          return ;
+      }
+      lines_read = true ;
+      LineTable &table = dwarf->get_line_table() ;
+      uint32_t first = table.size() ;
+      run_line_program (table) ;
+      table.add_unit (this, first) ;
+}
+
+void DwCUnit::run_line_program(LineTable &table) {
+      bool debug = false;                      // make true to print debug info
+
+      BStream stream (line_data, do_swap());
+
       // state variables
       Address address = get_base() ;
       int file = 1 ;
@@ -408,11 +693,8 @@ void DwCUnit::build_line_matrix(BVector data) {
           basic_block = false ; \
       }
 
-      // we may need to skip to the start of the program
-      int program_start = end_prolog + prolog_length ;
-      stream.seek (program_start) ;
-
-      Offset endoffset = offset + total_length + 4 ;// according to spec, the total length doesn't include the field
+      stream.seek (line_program) ;
+      Offset endoffset = line_end ;
 
       int specop255 = (255 - opcode_base) / line_range ;
 
@@ -431,8 +713,7 @@ void DwCUnit::build_line_matrix(BVector data) {
 
               switch (opcode) {
               case DW_LNE_end_sequence:
-                  line_matrix.push_back (new LineInfo (this, address, file, line,
-                      column, is_stmt, basic_block))  ;
+                  table.add_row (address, file, line, column, is_stmt, basic_block, true) ;
                   resetvars() ;
                   break ;
               case DW_LNE_set_address: {
@@ -467,8 +748,7 @@ void DwCUnit::build_line_matrix(BVector data) {
 
               switch (opcode) {
               case DW_LNS_copy:
-                  line_matrix.push_back (new LineInfo (this, address, file,
-                      line, column, is_stmt, basic_block))  ;
+                  table.add_row (address, file, line, column, is_stmt, basic_block, false) ;
                   basic_block = false ;
                   break ;
               case DW_LNS_advance_pc: {
@@ -540,16 +820,19 @@ void DwCUnit::build_line_matrix(BVector data) {
                 std::cout << std::dec << " and increment line by " << lineinc;
                 std::cout << " to " << line << "\n" ;
              }
-             line_matrix.push_back (new LineInfo (this, address, file,
-                line, column, is_stmt, basic_block))  ;
+             table.add_row (address, file, line, column, is_stmt, basic_block, false) ;
              basic_block = false ;
           }
       }
 }
 
 void DwCUnit::show_line_matrix() {
-      for (uint line = 0 ; line < line_matrix.size(); line++) {
-          line_matrix[line]->print () ;
+      read_lines() ;
+      LineTable &table = dwarf->get_line_table() ;
+      for (uint32_t row = 0 ; row < table.size() ; row++) {
+          if (table.get_unit (row) == this) {
+              table.print (row) ;
+          }
       }
 }
 
@@ -577,6 +860,11 @@ Address DwCUnit::read_address (BStream &bs) {
 
 DwLocExpr DwCUnit::evaluate_location (DwCUnit* cu,
  Address frame_base, AttributeValue& attr, Process* process, Address top_addr) {
+    if (attr.type == AV_INTEGER) {              // DWARF 4 constant member offset
+        DwLocExpr offset ;
+        offset.add (LOC_ADDR, top_addr + attr.integer, 0) ;
+        return offset ;
+    }
     DwLocEval eval(cu,process,frame_base,attr);
     eval.push(top_addr);
     return eval.execute();
@@ -588,20 +876,82 @@ DwLocExpr DwCUnit::evaluate_location (DwCUnit* cu,
     return eval.execute();
 }
 
+// The bytes of an expression are in the object's debug sections, so an
+// expression is at the same place whenever it is evaluated
+DwLocProgram *DwCUnit::get_loc_program (BVector expr) {
+    const byte *data = expr.get_data() ;
+    LocProgramMap::iterator i = loc_programs.find (data) ;
+    if (i != loc_programs.end()) {
+        return i->second ;
+    }
+    DwLocProgram *prog = new DwLocProgram (this, expr) ;
+    loc_programs[data] = prog ;
+    return prog ;
+}
+
 void DwCUnit::disassemble_location(DwCUnit *cu, BVector location) {
     dwarf->disassemble_location(cu, location) ;
 }
 
 DIEMap &DwCUnit::get_symbols() {
+       expand() ;
        return symbols ;
 }
 
 DIEMap & DwCUnit::get_subprograms() {
+       expand() ;
        return subprograms ;
 }
 
-LineMatrix & DwCUnit::get_line_matrix() {
-       return line_matrix ;
+
+bool DwCUnit::has_file (std::string basename) {
+    for (uint i = 1 ; i < file_table.size() ; i++) {
+        if (file_table[i] != NULL && file_table[i]->basename == basename) {
+            return true ;
+        }
+    }
+    return false ;
+}
+
+// the addresses of the code in the unit, from the DW_AT_low_pc and
+// DW_AT_high_pc or the DW_AT_ranges of the root DIE
+void DwCUnit::get_address_ranges (std::vector<AddressRange> &ranges) {
+    if (cu_die == NULL) {
+        return ;
+    }
+    AttributeValue low = cu_die->getAttribute (DW_AT_low_pc, false) ;
+    AttributeValue high = cu_die->getAttribute (DW_AT_high_pc, false) ;
+    AttributeValue list = cu_die->getAttribute (DW_AT_ranges, false) ;
+    Address base = low.type == AV_NONE ? 0 : (Address)low ;
+    AddressRange range ;
+
+    if (list.type != AV_NONE) {
+        BVector data = dwarf->get_debug_ranges() ;
+        if (list.integer < 0 || list.integer >= (int64_t)data.length()) {
+            return ;
+        }
+        BStream stream (data, do_swap()) ;
+        stream.seek (list.integer) ;
+        Address selector = addr_size == 4 ? 0xffffffffLL : -1 ;
+        while (stream.remaining() >= 2 * addr_size) {
+            Address start = read_address (stream) ;
+            Address end = read_address (stream) ;
+            if (start == 0 && end == 0) {
+                break ;
+            }
+            if (start == selector) {            // new base address
+                base = end ;
+            } else if (start < end) {
+                range.low = base + start ;
+                range.high = base + end ;
+                ranges.push_back (range) ;
+            }
+        }
+    } else if (low.type != AV_NONE && high.type != AV_NONE && (Address)high > base) {
+        range.low = base ;
+        range.high = high ;
+        ranges.push_back (range) ;
+    }
 }
 
 DirectoryTable & DwCUnit::get_directory_table() {
@@ -736,18 +1086,27 @@ void DwCUnit::keep_temp_die(DIE *die) {
     }
 }
 
-// insert at start of list so that newer ones (nested) are found first
+// the DIEs are read in order, so this is usually an append
 void DwCUnit::add_lazy_die (DIE *die, Offset start, Offset end) {
-    lazy_dies.push_front (new LazyDIE (die, start, end)) ;
+    LazyDIEVec::iterator i = std::upper_bound (lazy_dies.begin(), lazy_dies.end(), start, Compare_offset()) ;
+    lazy_dies.insert (i, LazyDIE (die, start, end)) ;
+}
+
+void DwCUnit::remove_lazy_die (Offset start) {
+    LazyDIEVec::iterator i = std::lower_bound (lazy_dies.begin(), lazy_dies.end(), start, Compare_offset()) ;
+    if (i != lazy_dies.end() && i->start == start) {
+        lazy_dies.erase (i) ;
+    }
 }
 
-// XXX: make this non-linear
 DIE *DwCUnit::find_lazy_die (Offset offset) {
-    for (std::list<LazyDIE*>::iterator i = lazy_dies.begin() ; i != lazy_dies.end() ; i++) {
-        LazyDIE *ld = *i ;
-        if (offset >= ld->start && offset < ld->end) {
-            return ld->die ;
-        }
+    LazyDIEVec::iterator i = std::upper_bound (lazy_dies.begin(), lazy_dies.end(), offset, Compare_offset()) ;
+    if (i == lazy_dies.begin()) {
+        return NULL ;
+    }
+    i-- ;
+    if (offset < i->end) {
+        return i->die ;
     }
     return NULL ;
 }
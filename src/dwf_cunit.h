@@ -38,14 +38,30 @@ author: David Allison <dallison@pathscale.com>
 #include "type_base.h"
 #include "file_info.h"
 
-struct LazyDIE;
 class Process;
-class LineInfo;
 class DwInfo;
+class LineTable;
+class LocationListTable;
 
 #include <vector>
+#include <map>
+
+// a DIE that has not been loaded yet
+// This is used when a pointer to another die that hasn't been loaded yet
+// needs to be resolved.  If the offset is within the range of the
+// start..end then the die's children are loaded
+
+struct LazyDIE {
+    LazyDIE (DIE *d, Offset s, Offset e) :die(d), start(s), end(e) {}
+    DIE *die ;
+    Offset start ;              // offset of first child
+    Offset end ;                // offset of sibling
+} ;
 
-typedef std::vector<LineInfo *> LineMatrix;
+struct AddressRange {
+    Address low ;
+    Address high ;                      // first address after the range
+} ;
 
 class DwCUnit {
 public:
@@ -92,17 +108,20 @@ public:
     Address get_base_pc();
     int getAddrSize () ;
     Abbreviation * getAbbreviation (int num) ;
-    DIE * get_die (Attribute * attr, Offset off) ;
-    void read (BStream &stream) ;
+    DIE * lookup_die (Offset off) ;                     // DIE at a unit relative offset if it has been read
+    void add_fixup (Offset offset, DIE * die) ;         // die has a specification or origin at offset
+    void read (BStream &stream, bool rootonly = false) ;
     void dump () ;
     int get_language () ;
     void show_symbols () ;
-    void build_line_matrix (BVector data) ;
+    void read_line_header (BVector data) ;
+    void read_lines () ;                                // add the rows to the line table if only the header was read
+    bool has_file (std::string basename) ;              // is the file in the file table?
+    void get_address_ranges (std::vector<AddressRange> &ranges) ;       // from the root DIE, unrelocated
     void show_line_matrix () ;
     void info (PStream &os) ;
     DIEMap & get_symbols () ;
     DIEMap & get_subprograms () ;
-    LineMatrix &get_line_matrix () ;
     DirectoryTable & get_directory_table () ;
     FileTable & get_file_table () ;
     DIE * new_scalar_type (std::string name, int encoding, int size = 0) ;
@@ -124,6 +143,7 @@ public:
     Address get_base() ;
 
     Offset start_offset ;
+    Offset stream_offset ;              // of the unit in the stream its DIEs are read from
     Offset sec_length;
     Offset abb_offset;
 
@@ -136,21 +156,47 @@ public:
          AttributeValue& attr, Process* process);
     DwLocExpr evaluate_location (DwCUnit *cu, Address frame_base,
          AttributeValue& attr, Process* process, Address top_addr);
+    DwLocProgram *get_loc_program (BVector expr) ;     // compiled the first time it is evaluated
     BStream &get_stream() { return mainstream ; }
 
-    AttributeValue get_die_reference(Attribute*attr, Offset offset) {
-       DIE *die = get_die (attr, offset) ;
-       if (die == NULL) {
-          return offset ;
-       }
-       return die ;
-    }
-
     DwInfo* get_dwinfo() {return dwarf;}
 
+    // while the unit is read on a worker thread the symbol registrations
+    // and warnings are queued; flush_registrations replays them to the
+    // DwInfo and std::cerr in order
+    void set_deferred (bool d) { deferred = d ; }
+    void flush_registrations() ;
+    void warn (const char *message) ;
+
     void add_lazy_die (DIE *die, Offset s, Offset e) ;
+    void remove_lazy_die (Offset s) ;                   // its children have been read
     DIE *find_lazy_die (Offset offset) ;
-    DIE *get_cu_die() { return cu_die ; }
+    DIE *get_cu_die() { expand() ; return cu_die ; }
+
+    // a unit restored from the symbol cache has its file table and its rows
+    // in the line table but no DIEs, and a unit read with rootonly set has only its root DIE.
+    // The rest of the DIEs are read by expand() when something needs them
+    void restore (Offset offset, int length, int language, std::string name, std::string comp_dir) ;
+    void restore_directory (std::string dirname) ;
+    void restore_file (const char *filename, int dir, int mtime, int size) ;
+    void expand() ;
+    bool is_expanded() { return expanded ; }
+    int get_info_length() { return debug_info_length ; }      // after the length field
+    std::string get_name () ;
+    DIE *find_die (Offset offset) ;                     // DIE at a unit relative offset
+    OffsetMap &get_dies() { return dies ; }
+    std::string &get_comp_dir() { return comp_dir ; }
+
+    // the DIEs of a skeleton unit are in a split DWARF unit, in a .dwo file
+    // or a .dwp package of them.  Its root DIE is read once all the units
+    // have been, and takes the skeleton's place; the rest are read by
+    // expand().  Its addresses and strings are in tables indexed by the DIEs
+    void read_split_root () ;
+    bool is_split() { return split ; }
+    bool has_language() { return cu_die == NULL ? language != 0 : cu_die->getAttribute (DW_AT_language).type != AV_NONE ; }
+    Address get_indexed_address (int64_t index) ;
+    const char *get_indexed_string (int64_t index) ;
+    LocationListTable *get_split_locations() { return split_locations ; }
 
     bool is_64bit();
 protected:
@@ -177,26 +223,75 @@ private:
     DirectoryTable directory_table ; // vector of strings
     FileTable file_table ; // vector of Files
     std::vector<int> opcode_lengths ;
-    LineMatrix line_matrix ;
 
     OffsetMap dies ; // map of offset vs DIE
 
-    typedef std::vector<Attribute*> AttrVec ;
-    //typedef __gnu_cxx::hash_map<Offset, AttrVec> FixupMap ;           // problem on 32 bit
-    typedef std::map<Offset, AttrVec> FixupMap ;                
+    struct Fixup {
+        Fixup (Offset offset, DIE *die) : offset(offset), die(die) {}
+        Offset offset ;                         // of the DIE that hasn't been read
+        DIE *die ;                              // waiting for it
+    } ;
+    typedef std::vector<Fixup> FixupVec ;
 
-    FixupMap fixups ; // map of offset vs vector of Attribute
+    FixupVec fixups ; // sorted on offset, in the order they were added for each offset
 
-    void addFixup (Attribute * attr, Offset offset) ;
     void dofixup (Offset offset, DIE * die) ;
 
-    std::list<LazyDIE*> lazy_dies ;              // dies that haven't been loaded yet
+    // dies that haven't been loaded yet, sorted on start.  The ranges don't
+    // overlap as a lazy DIE's children are read in full when it is loaded
+    typedef std::vector<LazyDIE> LazyDIEVec ;
+    LazyDIEVec lazy_dies ;
 
     void register_subprogram (std::string name, DIE *die) ;
     void register_symbol (std::string name, DIE *die) ;
+    void register_struct (std::string name, DIE *die) ;
+
+    enum RegistrationKind {
+        REG_SUBPROGRAM, REG_SYMBOL, REG_STRUCT
+    } ;
+    struct Registration {
+        Registration (RegistrationKind kind, std::string name, DIE *die) : kind(kind), name(name), die(die) {}
+        RegistrationKind kind ;
+        std::string name ;
+        DIE *die ;
+    } ;
+    bool deferred ;
+    std::vector<Registration> registrations ;   // queued while deferred
+    std::string warnings ;                      // likewise
 
     std::string comp_dir ;                      // compilation directory
 
+    bool skeleton ;                             // split root not read yet
+    bool split ;                                // DIEs are in a split unit
+    DIE *skeleton_die ;                         // the root the split one replaced
+    Abbreviation *split_abbrev ;                // of the split unit
+    Offset addr_base ;                          // of the unit's addresses in .debug_addr
+    BVector str_offsets ;                       // of the split unit's strings
+    BVector split_strings ;                     // .debug_str.dwo
+    LocationListTable *split_locations ;        // of the split unit's lists
+
+    // location expressions vs where their bytes are.  A location list has
+    // an expression for each range of PCs, so this has each of them
+    typedef std::map<const byte*, DwLocProgram*> LocProgramMap ;
+    LocProgramMap loc_programs ;
+
+    bool expanded ;                             // DIEs have been read
+    int language ;                              // of a unit restored from the cache (0 if none)
+    std::string name ;                          // ditto
+    Offset children_offset ;                    // children of the root DIE if only it has been read
+
+    // the line program is run when the unit is expanded or its lines are needed
+    void run_line_program (LineTable &table) ;
+    BVector line_data ;                         // .debug_line
+    bool lines_read ;
+    Offset line_program ;                       // start of the program
+    Offset line_end ;                           // end of the program
+    int min_instruction_length ;
+    int default_is_stmt ;
+    int line_base ;
+    int line_range ;
+    int opcode_base ;
+
     DIE * add_temp_die (DIE *die) ;
     std::list<DIE*> temp_dies ;
 } ;
@@ -0,0 +1,255 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: dwf_index.cc
+
+*/
+
+#include "dwf_index.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+
+/* The section is little endian whatever the target.  It starts with
+ * the version and the offsets of the CU list, the type unit list, the
+ * address area, the symbol hash table and the constant pool.
+ */
+
+DwNameIndex::DwNameIndex(BVector _data)
+  : data(_data), names_read(false) {
+
+   if (data.length() < 24) {
+      throw Exception("name index is truncated");
+   }
+
+   /* versions 7 and 8 only differ in what gdb puts in them */
+   uint32_t version = get4(0);
+   if (version < 7 || version > 8) {
+      throw Exception("unsupported name index version %u", version);
+   }
+
+   uint32_t culist = get4(4);
+   uint32_t tulist = get4(8);
+   uint32_t addrs = get4(12);
+   symbols = get4(16);
+   pool = get4(20);
+   if (culist < 24 || tulist < culist || addrs < tulist
+      || symbols < addrs || pool < symbols || pool > data.length()
+      || (tulist - culist) % 16 != 0 || (symbols - addrs) % 20 != 0
+      || (pool - symbols) % 8 != 0) {
+      throw Exception("name index is corrupt");
+   }
+
+   nslots = (pool - symbols) / 8;
+   if ((nslots & (nslots - 1)) != 0) {
+      throw Exception("name index is corrupt");
+   }
+
+   for (uint32_t p = culist; p < tulist; p += 16) {
+      units.push_back(get8(p));
+   }
+}
+
+uint32_t
+DwNameIndex::get4(uint32_t offset) {
+   if (offset + 4 > data.length() || offset + 4 < offset) {
+      throw Exception("name index is corrupt");
+   }
+   return data[offset] | (data[offset+1] << 8) |
+      (data[offset+2] << 16) | ((uint32_t)data[offset+3] << 24);
+}
+
+uint64_t
+DwNameIndex::get8(uint32_t offset) {
+   uint64_t lo = get4(offset);
+   uint64_t hi = get4(offset + 4);
+   return lo | (hi << 32);
+}
+
+const char*
+DwNameIndex::get_string(uint32_t offset) {
+   if (offset >= data.length() - pool) {
+      throw Exception("name index is corrupt");
+   }
+   const char* s = (const char*)&data[pool + offset];
+   if (memchr(s, 0, data.length() - pool - offset) == NULL) {
+      throw Exception("name index is corrupt");
+   }
+   return s;
+}
+
+/* the hash of the symbol table; it ignores case from version 5 */
+uint32_t
+DwNameIndex::hash(const char* name) {
+   uint32_t r = 0;
+   for (const unsigned char* s = (const unsigned char*)name; *s != 0; s++) {
+      r = r * 67 + tolower(*s) - 113;
+   }
+   return r;
+}
+
+void
+DwNameIndex::add_units(uint32_t vecoffset, std::vector<int>& result) {
+   if (vecoffset >= data.length() - pool) {
+      throw Exception("name index is corrupt");
+   }
+   uint32_t p = pool + vecoffset;
+   uint32_t n = get4(p);
+   for (uint32_t i = 0; i < n; i++) {
+      /* the top byte says what kind of symbol it is */
+      int unit = get4(p + 4 + i * 4) & 0xffffff;
+      if (unit < (int)units.size()) {       // not a type unit
+         result.push_back(unit);
+      }
+   }
+}
+
+void
+DwNameIndex::lookup(const std::string& name, std::vector<int>& result) {
+   if (nslots == 0) {
+      return;
+   }
+   uint32_t mask = nslots - 1;
+   uint32_t h = hash(name.c_str());
+   uint32_t slot = h & mask;
+   uint32_t step = ((h * 17) & mask) | 1;
+
+   for (uint32_t probes = 0; probes < nslots; probes++) {
+      uint32_t nameoffset = get4(symbols + slot * 8);
+      uint32_t vecoffset = get4(symbols + slot * 8 + 4);
+      if (nameoffset == 0 && vecoffset == 0) {
+         return;
+      }
+      if (strcmp(get_string(nameoffset), name.c_str()) == 0) {
+         add_units(vecoffset, result);
+         return;
+      }
+      slot = (slot + step) & mask;
+   }
+}
+
+/* remove the parameter list from a C++ function name */
+static std::string
+strip_parameters(const std::string& name) {
+   std::string::size_type end = name.rfind(')');
+   if (end == std::string::npos) {
+      return name;
+   }
+   int depth = 0;
+   for (std::string::size_type i = end + 1; i-- > 0;) {
+      if (name[i] == ')') {
+         depth++;
+      } else if (name[i] == '(' && --depth == 0) {
+         return i == 0 ? name : name.substr(0, i);
+      }
+   }
+   return name;
+}
+
+/* the last component of a qualified name */
+static std::string
+get_basename(const std::string& name) {
+   std::string::size_type start = 0;
+   int depth = 0;
+   for (std::string::size_type i = 0; i < name.size(); i++) {
+      char ch = name[i];
+      if (ch == '<' || ch == '(') {
+         depth++;
+      } else if ((ch == '>' || ch == ')') && depth > 0) {
+         depth--;
+      } else if (ch == ':' && depth == 0 && i + 1 < name.size() && name[i+1] == ':') {
+         start = i + 2;
+         i++;
+      }
+   }
+   return name.substr(start);
+}
+
+/* The index holds the qualified names of C++ symbols but the symbol
+ * table may be asked for the unqualified name, so keep a map of the last
+ * components too.  The names are also kept sorted for completion.  Both
+ * are built the first time they are needed.
+ */
+void
+DwNameIndex::read_names() {
+   if (names_read) {
+      return;
+   }
+   names_read = true;
+   for (uint32_t slot = 0; slot < nslots; slot++) {
+      uint32_t nameoffset = get4(symbols + slot * 8);
+      uint32_t vecoffset = get4(symbols + slot * 8 + 4);
+      if (nameoffset == 0 && vecoffset == 0) {
+         continue;
+      }
+      std::string name = get_string(nameoffset);
+      std::string base = get_basename(name);
+      if (base != name) {
+         basenames.insert(BaseMap::value_type(base, vecoffset));
+      }
+      names.push_back(NameVec::value_type(name, vecoffset));
+   }
+   std::sort(names.begin(), names.end());
+}
+
+// find the units that define a name
+void
+DwNameIndex::find_name(std::string name, std::vector<int>& result) {
+   std::string stripped = strip_parameters(name);
+   if (stripped != name) {
+      lookup(name, result);
+      name = stripped;
+   }
+   lookup(name, result);
+   std::string base = get_basename(name);
+   if (base != name) {
+      lookup(base, result);
+   }
+
+   read_names();
+   std::pair<BaseMap::iterator,BaseMap::iterator> p = basenames.equal_range(base);
+   for (BaseMap::iterator i = p.first; i != p.second; i++) {
+      add_units(i->second, result);
+   }
+
+   std::sort(result.begin(), result.end());
+   result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+// find the units that define a name, or the last component of a
+// qualified name, starting with prefix
+void
+DwNameIndex::find_prefix(std::string prefix, std::vector<int>& result) {
+   read_names();
+   NameVec::iterator n = std::lower_bound(names.begin(), names.end(),
+                                          NameVec::value_type(prefix, 0));
+   for (; n != names.end() && n->first.compare(0, prefix.size(), prefix) == 0; n++) {
+      add_units(n->second, result);
+   }
+   for (BaseMap::iterator i = basenames.lower_bound(prefix);
+        i != basenames.end() && i->first.compare(0, prefix.size(), prefix) == 0; i++) {
+      add_units(i->second, result);
+   }
+
+   std::sort(result.begin(), result.end());
+   result.erase(std::unique(result.begin(), result.end()), result.end());
+}
@@ -0,0 +1,76 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: dwf_index.h
+
+*/
+
+#ifndef _DWF_INDEX_H_
+#define _DWF_INDEX_H_
+
+#include "dbg_types.h"
+#include "bstream.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+// The name index of an object, read from the .gdb_index section the
+// linker (gold --gdb-index, lld --gdb-index) or gdb-add-index wrote.
+// It maps global names to the compilation units that define them, so
+// only those units need to be read.  Units are numbered in the order of
+// the index's CU list.  The address area is not used; the units that
+// hold an address are found from .debug_aranges (see DwInfo).
+
+class DwNameIndex {
+public:
+   DwNameIndex(BVector data);           // throws Exception if not usable
+
+   int num_units() { return units.size(); }
+   Offset get_unit_offset(int unit) { return units[unit]; }
+
+   void find_name(std::string name, std::vector<int>& result);
+   void find_prefix(std::string prefix, std::vector<int>& result);
+
+private:
+   typedef std::multimap<std::string, uint32_t> BaseMap;
+   typedef std::vector<std::pair<std::string, uint32_t> > NameVec;
+
+   uint32_t get4(uint32_t offset);
+   uint64_t get8(uint32_t offset);
+   const char* get_string(uint32_t offset);
+   uint32_t hash(const char* name);
+   void lookup(const std::string& name, std::vector<int>& result);
+   void add_units(uint32_t vecoffset, std::vector<int>& result);
+   void read_names();
+
+   BVector data;
+   std::vector<Offset> units;           // .debug_info offsets of the units
+   uint32_t symbols;                    // offset of the hash table
+   uint32_t nslots;                     // power of 2
+   uint32_t pool;                       // offset of the constant pool
+
+   BaseMap basenames;                   // last component of qualified names vs CU vector
+   NameVec names;                       // all the names vs CU vector, sorted
+   bool names_read;
+};
+
+#endif
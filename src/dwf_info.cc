@@ -34,6 +34,7 @@ author: David Allison <dallison@pathscale.com>
 #include "dwf_cfa.h"
 #include "dwf_cunit.h"
 #include "dwf_names.h"
+#include "utils.h"
 
 #include "type_array.h"
 #include "type_class.h"
@@ -44,11 +45,18 @@ author: David Allison <dallison@pathscale.com>
 #include "type_qual.h"
 
 #include <ios>
+#include <string.h>
+#include <unistd.h>
 #include <algorithm>
 
 DwInfo::DwInfo(ELF * elffile, std::istream& _stream)
-:  elffile(elffile), stream(_stream), string_table(NULL), location_table(NULL)
+:  elffile(elffile), stream(_stream), debugfile(elffile), debugstream(&_stream),
+   string_table(NULL), location_table(NULL),
+   name_index(NULL), units_deferred(0), debug_ranges_read(false),
+   frames_read(false), frame_header_read(false), frame_table_addr(0),
+   split_units(false), units_total(0), units_read(0)
 {
+   frame_sections[0] = frame_sections[1] = NULL;
 
    // populate the opcode operand counts
    opcode_opcounts[DW_OP_addr] = 1;
@@ -66,6 +74,8 @@ DwInfo::DwInfo(ELF * elffile, std::istream& _stream)
    for (int i = DW_OP_piece; i != DW_OP_nop; i++) {
       opcode_opcounts[i] = 1;
    }
+   opcode_opcounts[DW_OP_GNU_addr_index] = 1;
+   opcode_opcounts[DW_OP_GNU_const_index] = 1;
 
    Section *got_section = elffile->find_section(".got");
    if (got_section != NULL) {
@@ -81,6 +91,7 @@ DwInfo::~DwInfo()
    for (uint i = 0; i < compilation_units.size(); i++) {
       delete compilation_units[i];
    }
+   delete name_index;
    // don't delete the ELF file as we don't own it
 
    // delete the FDEs and CIEs
@@ -91,6 +102,20 @@ DwInfo::~DwInfo()
       delete i->second;
    }
    delete string_table;
+
+   for (std::map < std::string, SplitFile * >::iterator i = split_files.begin();
+	i != split_files.end(); i++) {
+      SplitFile *file = i->second;
+      if (file != NULL) {
+	 for (AbbreviationMap::iterator a = file->abbreviations.begin();
+	      a != file->abbreviations.end(); a++) {
+	    delete a->second;
+	 }
+	 delete file->stream;
+	 delete file->elf;
+	 delete file;
+      }
+   }
 }
 
 Address
@@ -264,15 +289,17 @@ DwInfo::read_frames(std::string section_name)
    BVector debug_frame;
    Section *section = NULL;
 
-   section = elffile->find_section(section_name);
+   /* .eh_frame is loaded, so it is never in a separate debug file */
+   bool is_eh = section_name == ".eh_frame";
+   ELF *file = is_eh ? elffile : debugfile;
+   section = file->find_section(section_name);
    if (section != NULL) {
-      debug_frame = section->get_contents(stream);
+      debug_frame = section->get_contents(is_eh ? stream : *debugstream);
    } else {
       // std::cout << "No " << section_name << " frames present" << '\n' ;
       return;
    }
    BStream stream(debug_frame, do_swap());
-   bool is_eh = section_name == ".eh_frame";
    while (!stream.eof()) {
       try {
 	 read_frame_entry(section, stream, is_eh);
@@ -294,11 +321,21 @@ class Compare_fde {
       return f1->get_start_address() < f2->get_start_address();
 }};
 
+// The entries of .eh_frame are only read when they are found in the
+// table in .eh_frame_hdr, so all of .eh_frame is read only if there is no
+// table.  .debug_frame has no index and is always read.
+
 void
 DwInfo::read_frames()
 {
+   if (frames_read) {
+      return;
+   }
+   frames_read = true;
    try {
-      read_frames(".eh_frame");
+      if (!read_frame_header()) {
+	 read_frames(".eh_frame");
+      }
       read_frames(".debug_frame");
    } catch(Exception e) {
       std::cout << "exception in read_frames: ";
@@ -314,11 +351,198 @@ DwInfo::read_frames()
 }
 
 
-// find an FDE containing the given address using a binary search
+// read the FDE for an entry in the FDE index, and its CIE if that hasn't
+// been read yet
+
+FDE *
+DwInfo::read_fde(FDEIndexEntry & entry)
+{
+   int which = entry.is_eh ? 1 : 0;
+   if (frame_sections[which] == NULL) {
+      frame_sections[which] = entry.is_eh ? elffile->find_section(".eh_frame")
+	 : debugfile->find_section(".debug_frame");
+      if (frame_sections[which] == NULL) {
+	 return NULL;
+      }
+      frame_data[which] = frame_sections[which]->get_contents(entry.is_eh ? stream : *debugstream);
+   }
+   Section *section = frame_sections[which];
+   BStream str(frame_data[which], do_swap());
+   try {
+      str.seek(entry.offset);
+      int length = str.read4u();
+      Address id = is_dwf64() ? str.read8u() : str.read4u();
+      Offset idoffset = entry.offset + 4;
+      Offset cieoffset = entry.is_eh ? idoffset - id : id;
+      if (cies.find(cieoffset) == cies.end()) {
+	 Offset fdeoffset = str.offset();
+	 str.seek(cieoffset);
+	 read_frame_entry(section, str, entry.is_eh);
+	 str.seek(fdeoffset);
+      }
+      FDE *fde = new FDE(this);
+      fde->read(section, str, id, idoffset, length, entry.is_eh);
+      fdes[fde->get_start_address()] = fde;
+      entry.fde = fde;
+   } catch(...) {
+      return NULL;
+   }
+   return entry.fde;
+}
+
+// the size of a value in .eh_frame_hdr with the given encoding, or -1 if
+// it isn't one that can be skipped
+
+static int
+encoded_size(int encoding, bool is64)
+{
+   switch (encoding & 0x0f) {
+   case DW_EH_PE_absptr: return is64 ? 8 : 4;
+   case DW_EH_PE_udata2:
+   case DW_EH_PE_sdata2: return 2;
+   case DW_EH_PE_udata4:
+   case DW_EH_PE_sdata4: return 4;
+   case DW_EH_PE_udata8:
+   case DW_EH_PE_sdata8: return 8;
+   }
+   return -1;
+}
+
+// The linker sorts the table on start address, and writes both columns
+// as 4 byte offsets from the start of .eh_frame_hdr.  A header with a
+// table in any other form is not used.
+
+bool
+DwInfo::read_frame_header()
+{
+   if (frame_header_read) {
+      return frame_table.length() != 0;
+   }
+   frame_header_read = true;
+   Section *header = elffile->find_section(".eh_frame_hdr");
+   if (header == NULL || elffile->find_section(".eh_frame") == NULL) {
+      return false;
+   }
+   try {
+      BVector data = header->get_contents(stream);
+      BStream str(data, do_swap());
+      int version = str.read1u();
+      int ptr_enc = str.read1u();
+      int count_enc = str.read1u();
+      int table_enc = str.read1u();
+      if (version != 1 || ptr_enc == DW_EH_PE_omit || count_enc == DW_EH_PE_omit
+	  || table_enc != (DW_EH_PE_datarel | DW_EH_PE_sdata4)) {
+	 return false;
+      }
+      int ptr_size = encoded_size(ptr_enc, elffile->is_elf64());
+      if (ptr_size < 0) {
+	 return false;
+      }
+      str.seek(ptr_size, BSTREAM_CUR);   /* .eh_frame, which we know */
+      uint64_t count;
+      switch (count_enc) {
+      case DW_EH_PE_udata4: count = (uint32_t) str.read4u(); break;
+      case DW_EH_PE_udata8: count = str.read8u(); break;
+      case DW_EH_PE_absptr: count = read_address(str); break;
+      default: return false;
+      }
+      if (count == 0 || count > (uint64_t)str.remaining() / 8) {
+	 return false;
+      }
+      frame_table = BVector(str.address(), count * 8);
+      frame_table_addr = header->get_addr();
+   } catch(...) {
+      return false;
+   }
+   return true;
+}
+
+// The FDE found in the table is looked for among those already read,
+// and read if it isn't there.  The table gives where each FDE starts,
+// so addr may be past the end of the one before it.
+
+FDE *
+DwInfo::find_eh_fde(Address addr)
+{
+   int64_t rel = addr - get_base() - frame_table_addr;     // the table's entries are signed
+   int n = frame_table.length() / 8;
+   BStream str(frame_table, do_swap());
+   int start = 0;
+   int end = n - 1;
+   int found = -1;                      // the last entry starting at or before addr
+   while (start <= end) {
+      int mid = (end + start) / 2;
+      str.seek(mid * 8);
+      int64_t initial = str.read4s();
+      if (initial <= rel) {
+	 found = mid;
+	 start = mid + 1;
+      } else {
+	 end = mid - 1;
+      }
+   }
+   if (found < 0) {
+      return NULL;
+   }
+   str.seek(found * 8);
+   Address fdestart = get_base() + frame_table_addr + str.read4s();
+   Address fdeaddr = frame_table_addr + str.read4s();
+
+   FDE *fde;
+   FDEMap::iterator i = fdes.find(fdestart);
+   if (i != fdes.end()) {
+      fde = i->second;
+   } else {
+      Section *eh = elffile->find_section(".eh_frame");
+      FDEIndexEntry entry;
+      entry.start = fdestart;
+      entry.end = fdestart;
+      entry.offset = fdeaddr - eh->get_addr();
+      entry.is_eh = true;
+      entry.fde = NULL;
+      fde = read_fde(entry);
+   }
+   if (fde == NULL || addr < fde->get_start_address() || addr >= fde->get_end_address()) {
+      return NULL;
+   }
+   return fde;
+}
 
 FDE *
 DwInfo::find_fde(Address addr)
 {
+   wait();
+   return search_fde(addr);
+}
+
+// find an FDE containing the given address using a binary search
+
+FDE *
+DwInfo::search_fde(Address addr)
+{
+   if (read_frame_header()) {
+      FDE *fde = find_eh_fde(addr);
+      if (fde != NULL) {
+	 return fde;
+      }
+   }
+   if (!fde_index.empty()) {
+      int start = 0;
+      int end = fde_index.size() - 1;
+      while (start <= end) {
+	 int mid = (end + start) / 2;
+	 FDEIndexEntry & entry = fde_index[mid];
+	 if (addr >= entry.start && addr < entry.end) {
+	    return entry.fde != NULL ? entry.fde : read_fde(entry);
+	 }
+	 if (addr < entry.start) {
+	    end = mid - 1;
+	 } else {
+	    start = mid + 1;
+	 }
+      }
+      return NULL;
+   }
    int start = 0;
    int end = fdevec.size() - 1;
    if (end < 0) {
@@ -373,11 +597,17 @@ DwInfo::read_abbreviations()
    BVector abbrev;
 
    try {
-      abbrev = elffile->get_section(stream, ".debug_abbrev");
+      abbrev = debugfile->get_section(*debugstream, ".debug_abbrev");
    } catch(...) {
       return;
    }
+   read_abbreviation_tables(abbrev, compilationunit_abbreviations);
+}
 
+// the tables are kept as their first abbreviation, which holds the rest
+void
+DwInfo::read_abbreviation_tables(BVector abbrev, AbbreviationMap & tables)
+{
    BStream str(abbrev, do_swap());
    Abbreviation *cu = NULL;	// current compilation unit
    while (!str.eof()) {
@@ -389,7 +619,7 @@ DwInfo::read_abbreviations()
 	 Abbreviation *abb = new Abbreviation(num, tag, children);
 	 if (cu == NULL) {
 	    cu = abb;
-	    compilationunit_abbreviations[offset] = abb;
+	    tables[offset] = abb;
 	 } else {
 	    cu->addAbbreviation(num, abb);
 	 }
@@ -401,7 +631,7 @@ DwInfo::read_abbreviations()
 	 // printf ("NULL\n") ;
 	 Abbreviation *abb = new Abbreviation(0, 0, false);
 	 if (cu == NULL) {
-	    compilationunit_abbreviations[offset] = abb;
+	    tables[offset] = abb;
 	 } else {
 	    cu->addAbbreviation(0, abb);
 	 }
@@ -527,6 +757,7 @@ DwInfo::make_die(DwCUnit * cu, DIE * parent,
 void
 DwInfo::dump()
 {
+   wait();
    for (uint cu = 0; cu < compilation_units.size(); cu++) {
       compilation_units[cu]->dump();
    }
@@ -536,66 +767,786 @@ DwInfo::dump()
 void
 DwInfo::show_symbols()
 {
+   wait();
    for (uint cu = 0; cu < compilation_units.size(); cu++) {
       compilation_units[cu]->show_symbols();
    }
 }
 
+// state shared by the workers reading compilation units in parallel.  Each
+// job only writes to its own slot in the vectors.
+struct CUParseJobs {
+   CUParseJobs(DwInfo *dwarf, BVector info, BVector linedata)
+   :  dwarf(dwarf), info(info), linedata(linedata) {
+   }
+
+   DwInfo *dwarf;
+   BVector info;
+   BVector linedata;
+   std::vector<Offset> offsets;		// section offset of each unit header
+   std::vector<DwCUnit*> units;
+   std::vector<char> read_failed;
+   std::vector<char> line_failed;
+   std::vector<Exception> errors;
+};
+
+static void
+parse_cu_job(void *arg, int job)
+{
+   CUParseJobs *jobs = (CUParseJobs *) arg;
+   DwCUnit *cu = new DwCUnit(jobs->dwarf);
+   cu->set_deferred(true);
+   bool reading = true;
+   try {
+      BStream str(jobs->info, jobs->dwarf->do_swap());
+      str.seek(jobs->offsets[job]);
+      cu->read(str, true);
+      jobs->units[job] = cu;
+      reading = false;
+      cu->read_line_header(jobs->linedata);
+      jobs->dwarf->unit_read();
+      return;
+   } catch(Exception & e) {
+      jobs->errors[job] = e;
+   } catch(const char *s) {
+      jobs->errors[job] = Exception("%s", s);
+   } catch(std::string s) {
+      jobs->errors[job] = Exception("%s", s.c_str());
+   } catch(...) {
+      jobs->errors[job] = Exception("unable to read compilation unit");
+   }
+   if (reading) {
+      delete cu;
+      jobs->read_failed[job] = true;	// the unit is dropped, like the serial read
+   } else {
+      jobs->line_failed[job] = true;
+   }
+}
+
 void
-DwInfo::read_debug_info(PStream * os, bool reporterror)
+DwInfo::read_debug_info(PStream * os, bool reporterror, bool parallel)
 {
    BVector info;
 
    try {
-      info = elffile->get_section(stream, ".debug_info");
+      info = debugfile->get_section(*debugstream, ".debug_info");
    } catch(...) {
       if (reporterror) {
-	 if (os != NULL) {
-	    os->print("(no symbol information)...");
-	 } else {
-	    printf("(no symbol information)");
-	 }
+	 report_no_symbols(os);
       }
       return;
    }
-   BVector linedata = elffile->get_section(stream, ".debug_line");
+   debug_info = info;
+   read_name_index();
+   BVector linedata = debugfile->get_section(*debugstream, ".debug_line");
+
+   // find the unit boundaries by reading just the length of each header
+   CUParseJobs jobs(this, info, linedata);
    BStream str(info, do_swap());
    while (!str.eof()) {
-      DwCUnit *cu = new DwCUnit(this);
-      cu->read(str);
+      Offset offset = str.offset();
+      int length = str.read4u();
+      jobs.offsets.push_back(offset);
+      if (length != 0) {
+	 str.seek(offset + length + 4);
+      }
+   }
+   int n = jobs.offsets.size();
+   __sync_lock_test_and_set(&units_total, n);
+
+   if (!parallel) {
+      str.seek(0);
+      while (!str.eof()) {
+	 // the unit's symbols are registered once it has been read, so a
+	 // unit that fails can be deleted
+	 DwCUnit *cu = new DwCUnit(this);
+	 cu->set_deferred(true);
+	 try {
+	    cu->read(str, true);
+	 } catch(...) {
+	    delete cu;
+	    throw;
+	 }
+	 compilation_units.push_back(cu);
+	 cu->flush_registrations();
+	 cu->read_line_header(linedata);
+	 unit_read();
+      }
+      read_split_roots();
+      read_unit_ranges();
+      match_name_index();
+      return;
+   }
+
+   jobs.units.resize(n, (DwCUnit *) NULL);
+   jobs.read_failed.resize(n, false);
+   jobs.line_failed.resize(n, false);
+   jobs.errors.resize(n);
+   Utils::parallel_for(n, parse_cu_job, &jobs);
+
+   // merge in unit order so the symbol tables come out exactly as the
+   // serial read would have built them
+   for (int i = 0; i < n; i++) {
+      if (jobs.read_failed[i]) {
+	 for (int j = i + 1; j < n; j++) {
+	    delete jobs.units[j];
+	 }
+	 throw jobs.errors[i];
+      }
+      DwCUnit *cu = jobs.units[i];
       compilation_units.push_back(cu);
-      cu->build_line_matrix(linedata);
-      // cu->show_line_matrix () ;
+      cu->flush_registrations();
+      if (jobs.line_failed[i]) {
+	 for (int j = i + 1; j < n; j++) {
+	    delete jobs.units[j];
+	 }
+	 throw jobs.errors[i];
+      }
    }
+   read_split_roots();
+   read_unit_ranges();
+   match_name_index();
+}
 
+// the units are read with only their root DIEs, so find the code addresses
+// of each one.  .debug_aranges has them for the units the compiler put in
+// it; the root DIEs have them for the rest.  A unit whose addresses can't
+// be found is expanded when an address that isn't in any other unit is
+// looked up.
 
+bool
+DwInfo::compare_unit_ranges(const UnitRange & a, const UnitRange & b)
+{
+   return a.low < b.low;
 }
 
 void
-DwInfo::read_string_table()
+DwInfo::read_unit_ranges()
 {
-   BVector data;
+   std::map < Offset, DwCUnit * >units;
+   for (uint i = 0; i < compilation_units.size(); i++) {
+      DwCUnit *cu = compilation_units[i];
+      if (!cu->is_expanded()) {
+	 units[cu->get_sec_offset()] = cu;
+	 units_deferred++;
+      }
+   }
+
+   std::set < DwCUnit * >mapped;
+   read_aranges(units, mapped);
+
+   for (std::map < Offset, DwCUnit * >::iterator u = units.begin(); u != units.end(); u++) {
+      DwCUnit *cu = u->second;
+      if (mapped.count(cu) != 0) {
+	 continue;
+      }
+      std::vector < AddressRange > ranges;
+      cu->get_address_ranges(ranges);
+      if (ranges.empty()) {
+	 unmapped_units.push_back(cu);
+      }
+      for (uint i = 0; i < ranges.size(); i++) {
+	 UnitRange range;
+	 range.low = ranges[i].low;
+	 range.high = ranges[i].high;
+	 range.cu = cu;
+	 unit_ranges.push_back(range);
+      }
+   }
+   std::sort(unit_ranges.begin(), unit_ranges.end(), compare_unit_ranges);
+}
+
+// read the address ranges in .debug_aranges.  Each set of ranges has a
+// header giving the unit it belongs to; the ranges follow, aligned to twice
+// the size of an address
+
+void
+DwInfo::read_aranges(std::map < Offset, DwCUnit * >&units, std::set < DwCUnit * >&mapped)
+{
+   Section *section = debugfile->find_section(".debug_aranges");
+   if (section == NULL) {
+      return;
+   }
+   BVector data = section->get_contents(*debugstream);
+   BStream str(data, do_swap());
+   while (str.remaining() >= 16) {
+      Offset start = str.offset();
+      Offset length = str.read4u();
+      Offset end = start + length + 4;
+      if (length < 12 || end > (Offset) data.length()) {
+	 break;			// 64 bit DWARF or corrupt
+      }
+      str.read2u();		// version
+      Offset info = str.read4u();
+      int addrsize = str.read1u();
+      str.read1u();		// segment descriptor size
+      if (addrsize != 4 && addrsize != 8) {
+	 str.seek(end);
+	 continue;
+      }
+      int misalign = (str.offset() - start) % (2 * addrsize);
+      if (misalign != 0) {
+	 str.seek(2 * addrsize - misalign, BSTREAM_CUR);
+      }
+
+      std::map < Offset, DwCUnit * >::iterator u = units.find(info);
+      while (str.offset() + 2 * addrsize <= end) {
+	 Address addr = addrsize == 4 ? (Address) str.read4u() : (Address) str.read8u();
+	 Address len = addrsize == 4 ? (Address) str.read4u() : (Address) str.read8u();
+	 if (addr == 0 && len == 0) {
+	    break;
+	 }
+	 if (u != units.end() && len > 0) {
+	    UnitRange range;
+	    range.low = addr;
+	    range.high = addr + len;
+	    range.cu = u->second;
+	    unit_ranges.push_back(range);
+	 }
+      }
+      if (u != units.end()) {
+	 mapped.insert(u->second);
+      }
+      str.seek(end);
+   }
+}
+
+// the symbol tables are filled in as the units are expanded.  Once they all
+// have been, the subclass is told
+
+void
+DwInfo::unit_expanded()
+{
+   if (--units_deferred == 0) {
+      all_units_read();
+   }
+}
+
+void
+DwInfo::expand_all_units()
+{
+   for (uint i = 0; i < compilation_units.size() && units_deferred > 0; i++) {
+      compilation_units[i]->expand();
+   }
+}
+
+// only the root DIEs of the units that may define a name are expanded if
+// there is a .gdb_index
+
+void
+DwInfo::read_name_index()
+{
+   Section *section = debugfile->find_section(".gdb_index");
+   if (section == NULL) {
+      return;
+   }
    try {
-      data = elffile->get_section(stream, ".debug_str");
-   } catch(Exception e) {
+      name_index = new DwNameIndex(section->get_contents(*debugstream));
+   } catch(Exception & e) {
+      name_index = NULL;	// read all the units instead
+   }
+}
+
+// find the units the index refers to.  If they are not the units in
+// .debug_info the index is of no use, so it is dropped and all the units
+// are read
+
+void
+DwInfo::match_name_index()
+{
+   if (name_index == NULL) {
       return;
    }
-   catch(const char *s) {
+   std::map < Offset, DwCUnit * >units;
+   for (uint i = 0; i < compilation_units.size(); i++) {
+      units[compilation_units[i]->get_sec_offset()] = compilation_units[i];
+   }
+   bool matched = name_index->num_units() == (int) compilation_units.size();
+   for (int i = 0; matched && i < name_index->num_units(); i++) {
+      std::map < Offset, DwCUnit * >::iterator u = units.find(name_index->get_unit_offset(i));
+      if (u == units.end()) {
+	 matched = false;
+      } else {
+	 index_units.push_back(u->second);
+      }
+   }
+   if (!matched) {
+      drop_name_index();
+   }
+}
+
+void
+DwInfo::drop_name_index()
+{
+   delete name_index;
+   name_index = NULL;
+   index_units.clear();
+   for (uint i = 0; i < compilation_units.size(); i++) {
+      compilation_units[i]->expand();
+   }
+}
+
+// Without an index the units are found from the ELF symbols: those whose
+// code holds a function with the name.  Only a name whose symbols aren't
+// all in the units' code (a variable or a type, say) has all the units
+// read.  A prefix only expands the units of the functions it finds
+
+void
+DwInfo::find_symbol_addresses(std::string name, std::vector < Address > &addrs)
+{
+   std::vector < ELFSymbol * >syms;
+   elffile->find_symbols(name, syms);
+   for (uint i = 0; i < syms.size(); i++) {
+      addrs.push_back(syms[i]->get_value() - get_base());
+   }
+}
+
+void
+DwInfo::find_prefix_addresses(std::string prefix, std::vector < Address > &addrs)
+{
+   int n = elffile->get_num_symbols();
+   for (int i = 0; i < n; i++) {
+      ELFSymbol & sym = elffile->get_symbol(i);
+      if (strncmp(sym.get_c_name(), prefix.c_str(), prefix.size()) == 0) {
+	 addrs.push_back(sym.get_value() - get_base());
+      }
+   }
+}
+
+// expand the units holding the addresses.  False if one isn't in any
+
+bool
+DwInfo::expand_units_at(std::vector < Address > &addrs)
+{
+   std::vector < DwCUnit * >units;
+   for (uint i = 0; i < addrs.size(); i++) {
+      DwCUnit *cu = find_unit_at(addrs[i]);
+      if (cu == NULL) {
+	 return false;
+      }
+      units.push_back(cu);
+   }
+   for (uint i = 0; i < units.size(); i++) {
+      units[i]->expand();
+   }
+   return true;
+}
+
+void
+DwInfo::expand_units(std::string name)
+{
+   wait();
+   if (name_index == NULL) {
+      if (units_deferred == 0) {
+	 return;
+      }
+      std::vector < Address > addrs;
+      find_symbol_addresses(name, addrs);
+      if (addrs.empty() || !expand_units_at(addrs)) {
+	 expand_all_units();
+      }
       return;
    }
-   catch(std::string s) {
+   std::vector < int >units;
+   try {
+      name_index->find_name(name, units);
+   } catch(Exception & e) {
+      drop_name_index();	// corrupt
       return;
    }
+   for (uint i = 0; i < units.size(); i++) {
+      index_units[units[i]]->expand();
+   }
+}
 
-   string_table = new DwSTab(data);
+void
+DwInfo::expand_units_with_prefix(std::string prefix)
+{
+   wait();
+   if (name_index == NULL) {
+      if (units_deferred == 0) {
+	 return;
+      }
+      std::vector < Address > addrs;
+      find_prefix_addresses(prefix, addrs);
+      for (uint i = 0; i < addrs.size(); i++) {
+	 DwCUnit *cu = find_unit_at(addrs[i]);
+	 if (cu != NULL) {
+	    cu->expand();
+	 }
+      }
+      return;
+   }
+   std::vector < int >units;
+   try {
+      name_index->find_prefix(prefix, units);
+   } catch(Exception & e) {
+      drop_name_index();
+      return;
+   }
+   for (uint i = 0; i < units.size(); i++) {
+      index_units[units[i]]->expand();
+   }
 }
 
 void
-DwInfo::read_location_table(DwCUnit * cu)
+DwInfo::expand_unit_at(Address addr)
+{
+   wait();
+   if (units_deferred == 0) {
+      return;
+   }
+   DwCUnit *cu = find_unit_at(addr);
+   if (cu != NULL) {
+      cu->expand();
+      return;
+   }
+
+   // not in a unit we know about, so it may be in one we don't
+   for (uint i = 0; i < unmapped_units.size(); i++) {
+      unmapped_units[i]->expand();
+   }
+   unmapped_units.clear();
+}
+
+// the unit whose code holds an address, or NULL if it isn't known
+
+DwCUnit *
+DwInfo::find_unit_at(Address addr)
+{
+   // the last range starting at or before addr
+   int low = 0;
+   int high = unit_ranges.size() - 1;
+   int found = -1;
+   while (low <= high) {
+      int mid = (low + high) / 2;
+      if (unit_ranges[mid].low <= addr) {
+	 found = mid;
+	 low = mid + 1;
+      } else {
+	 high = mid - 1;
+      }
+   }
+   if (found != -1 && addr < unit_ranges[found].high) {
+      return unit_ranges[found].cu;
+   }
+   return NULL;
+}
+
+// read the line tables of the units that use a file.  Their DIEs are not
+// needed to look up a line
+
+void
+DwInfo::expand_file_lines(std::string basename)
+{
+   wait();
+   if (units_deferred == 0) {
+      return;
+   }
+   for (uint i = 0; i < compilation_units.size(); i++) {
+      DwCUnit *cu = compilation_units[i];
+      if (cu->has_file(basename)) {
+	 cu->read_lines();
+      }
+   }
+}
+
+void
+DwInfo::report_no_symbols(PStream * os)
+{
+   if (os != NULL) {
+      os->print("(no symbol information)...");
+   } else {
+      printf("(no symbol information)");
+   }
+}
+
+// the DIEs of a compilation unit restored from the symbol cache are read
+// from here when the unit is first needed
+BVector
+DwInfo::get_debug_info()
+{
+   if (debug_info.length() == 0) {
+      if (string_table == NULL) {
+	 read_string_table();
+      }
+      if (compilationunit_abbreviations.empty()) {
+	 read_abbreviations();
+      }
+      debug_info = debugfile->get_section(*debugstream, ".debug_info");
+   }
+   return debug_info;
+}
+
+BVector
+DwInfo::get_debug_ranges()
+{
+   if (!debug_ranges_read) {
+      debug_ranges_read = true;
+      Section *section = debugfile->find_section(".debug_ranges");
+      if (section != NULL) {
+	 debug_ranges = section->get_contents(*debugstream);
+      }
+   }
+   return debug_ranges;
+}
+
+// the split units are looked for once all the units have been read, as
+// their files are opened on this thread
+void
+DwInfo::read_split_roots()
+{
+   for (uint i = 0; i < compilation_units.size(); i++) {
+      compilation_units[i]->read_split_root();
+   }
+}
+
+bool
+DwInfo::find_split_unit(DwCUnit * cu, std::string dwoname, int64_t id, SplitUnit & unit)
+{
+   if (!split_units) {
+      split_units = true;
+      Section *section = debugfile->find_section(".debug_addr");
+      if (section != NULL) {
+	 debug_addr = section->get_contents(*debugstream);
+      }
+   }
+
+   // a damaged file is passed over
+   std::string object = elffile->get_name();
+   SplitFile *package = open_split_file(object + ".dwp");
+   try {
+      if (package != NULL && find_package_unit(package, id, unit)) {
+	 return true;
+      }
+   } catch(...) {
+   }
+
+   // the name is relative to the compilation directory, but the file may
+   // have been moved with the object
+   std::vector < std::string > paths;
+   if (dwoname == "") {
+      return false;
+   } else if (dwoname[0] == '/') {
+      paths.push_back(dwoname);
+   } else {
+      if (cu->get_comp_dir() != "") {
+	 paths.push_back(cu->get_comp_dir() + "/" + dwoname);
+      }
+      std::string::size_type slash = object.rfind('/');
+      std::string dir = slash == std::string::npos ? "." : object.substr(0, slash);
+      slash = dwoname.rfind('/');
+      paths.push_back(dir + "/" + (slash == std::string::npos ? dwoname : dwoname.substr(slash + 1)));
+   }
+   for (uint i = 0; i < paths.size(); i++) {
+      SplitFile *file = open_split_file(paths[i]);
+      try {
+	 if (file != NULL && file->cu_index.length() == 0 && find_dwo_unit(cu, file, id, unit)) {
+	    return true;
+	 }
+      } catch(...) {
+      }
+   }
+   return false;
+}
+
+DwInfo::SplitFile *
+DwInfo::open_split_file(std::string path)
+{
+   std::map < std::string, SplitFile * >::iterator i = split_files.find(path);
+   if (i != split_files.end()) {
+      return i->second;
+   }
+   SplitFile *file = NULL;
+   split_files[path] = NULL;
+   if (access(path.c_str(), R_OK) != 0) {
+      return NULL;
+   }
+   ELF *elf = new ELF(path);
+   std::istream *s = NULL;
+   try {
+      s = elf->open(elffile->get_base());
+      if (elf->find_section(".debug_info.dwo") != NULL) {
+	 file = new SplitFile;
+	 file->elf = elf;
+	 file->stream = s;
+	 file->info = elf->get_section(*s, ".debug_info.dwo");
+	 file->abbrev = elf->get_section(*s, ".debug_abbrev.dwo");
+	 Section *section = elf->find_section(".debug_loc.dwo");
+	 if (section != NULL) {
+	    file->loc = section->get_contents(*s);
+	 }
+	 section = elf->find_section(".debug_str_offsets.dwo");
+	 if (section != NULL) {
+	    file->str_offsets = section->get_contents(*s);
+	 }
+	 section = elf->find_section(".debug_str.dwo");
+	 if (section != NULL) {
+	    file->strings = section->get_contents(*s);
+	 }
+	 section = elf->find_section(".debug_cu_index");
+	 if (section != NULL) {
+	    file->cu_index = section->get_contents(*s);
+	 }
+	 read_abbreviation_tables(file->abbrev, file->abbreviations);
+	 split_files[path] = file;
+	 return file;
+      }
+   } catch(...) {
+      if (file != NULL) {
+	 for (AbbreviationMap::iterator a = file->abbreviations.begin();
+	      a != file->abbreviations.end(); a++) {
+	    delete a->second;
+	 }
+	 delete file;
+      }
+   }
+   delete s;
+   delete elf;
+   return NULL;
+}
+
+// a .dwo file has the units of one compilation, usually just one
+bool
+DwInfo::find_dwo_unit(DwCUnit * cu, SplitFile * file, int64_t id, SplitUnit & unit)
+{
+   BStream stream(file->info, do_swap());
+   while (stream.remaining() > 11) {
+      Offset offset = stream.offset();
+      Offset end = offset + (uint32_t) stream.read4u() + 4;
+      stream.read2u();			// version
+      Offset abbrev_offset = (uint32_t) stream.read4u();
+      stream.read1u();			// address size
+      AbbreviationMap::iterator table = file->abbreviations.find(abbrev_offset);
+      if (end > (Offset) file->info.length() || table == file->abbreviations.end()) {
+	 return false;
+      }
+      int num = stream.read_uleb();
+      Abbreviation *root = num == table->second->getNum()? table->second : table->second->getAbbreviation(num);
+      for (int i = 0; i < root->getNumAttributes(); i++) {
+	 AttributeAbbreviation *attr = root->getAttribute(i);
+	 if (attr->getTag() != DW_AT_GNU_dwo_id) {
+	    attr->skip(cu, stream);
+	 } else if (attr->read(cu, stream).integer == id) {
+	    unit.info = file->info;
+	    unit.offset = offset;
+	    unit.abbrev = table->second;
+	    unit.loc = file->loc;
+	    unit.str_offsets = file->str_offsets;
+	    unit.strings = file->strings;
+	    return true;
+	 } else {
+	    break;
+	 }
+      }
+      stream.seek(end);
+   }
+   return false;
+}
+
+// a .dwp package has the units of many compilations.  The sections are the
+// contributions of each one end to end, and .debug_cu_index is a hash
+// table of the dwo ids giving the contributions of a unit
+bool
+DwInfo::find_package_unit(SplitFile * file, int64_t id, SplitUnit & unit)
+{
+   BStream stream(file->cu_index, do_swap());
+   if (stream.remaining() < 16) {
+      return false;
+   }
+   uint32_t version = stream.read4u();
+   uint32_t ncolumns = stream.read4u();
+   uint32_t nunits = stream.read4u();
+   uint32_t nslots = stream.read4u();
+   Offset signatures = 16;
+   Offset rows = signatures + (Offset) nslots * 8;
+   Offset columns = rows + (Offset) nslots * 4;
+   Offset offsets = columns + (Offset) ncolumns * 4;
+   Offset sizes = offsets + (Offset) nunits * ncolumns * 4;
+   if (version != 2 || nslots == 0 || (nslots & (nslots - 1)) != 0
+       || sizes + (Offset) nunits * ncolumns * 4 > (Offset) file->cu_index.length()) {
+      return false;
+   }
+
+   uint64_t mask = nslots - 1;
+   uint64_t slot = id & mask;
+   uint64_t step = (((uint64_t) id >> 32) & mask) | 1;
+   uint32_t row = 0;
+   for (uint32_t probe = 0; probe < nslots && row == 0; probe++) {
+      stream.seek(rows + slot * 4);
+      uint32_t r = stream.read4u();
+      if (r == 0) {			// empty slot
+	 return false;
+      }
+      stream.seek(signatures + slot * 8);
+      if (stream.read8u() == id) {
+	 row = r;
+      }
+      slot = (slot + step) & mask;
+   }
+   if (row == 0 || row > nunits) {
+      return false;
+   }
+
+   Offset info = -1;
+   Offset abbrev = -1;
+   Offset loc = 0;
+   Offset loc_size = 0;
+   Offset str_offsets = 0;
+   Offset str_offsets_size = 0;
+   for (uint32_t c = 0; c < ncolumns; c++) {
+      stream.seek(columns + c * 4);
+      int sect = stream.read4u();
+      Offset cell = ((Offset) (row - 1) * ncolumns + c) * 4;
+      stream.seek(offsets + cell);
+      Offset contribution = (uint32_t) stream.read4u();
+      stream.seek(sizes + cell);
+      Offset size = (uint32_t) stream.read4u();
+      switch (sect) {
+      case DW_SECT_INFO:
+	 info = contribution;
+	 break;
+      case DW_SECT_ABBREV:
+	 abbrev = contribution;
+	 break;
+      case DW_SECT_LOC:
+	 loc = contribution;
+	 loc_size = size;
+	 break;
+      case DW_SECT_STR_OFFSETS:
+	 str_offsets = contribution;
+	 str_offsets_size = size;
+	 break;
+      }
+   }
+   if (info < 0 || abbrev < 0 || info + 11 > (Offset) file->info.length()
+       || loc + loc_size > (Offset) file->loc.length()
+       || str_offsets + str_offsets_size > (Offset) file->str_offsets.length()) {
+      return false;
+   }
+
+   // the abbreviation offset in the unit header is into its contribution
+   BStream header(file->info, do_swap());
+   header.seek(info + 6);
+   AbbreviationMap::iterator table = file->abbreviations.find(abbrev + (uint32_t) header.read4u());
+   if (table == file->abbreviations.end()) {
+      return false;
+   }
+   unit.info = file->info;
+   unit.offset = info;
+   unit.abbrev = table->second;
+   unit.loc = BVector(file->loc.get_data() + loc, loc_size);
+   unit.str_offsets = BVector(file->str_offsets.get_data() + str_offsets, str_offsets_size);
+   unit.strings = file->strings;
+   return true;
+}
+
+void
+DwInfo::read_string_table()
 {
    BVector data;
    try {
-      data = elffile->get_section(stream, ".debug_loc");
+      data = debugfile->get_section(*debugstream, ".debug_str");
    } catch(Exception e) {
       return;
    }
@@ -606,12 +1557,31 @@ DwInfo::read_location_table(DwCUnit * cu)
       return;
    }
 
-   location_table = new LocationListTable(cu, data);
+   string_table = new DwSTab(data);
+}
+
+// the lists are parsed as they are needed
+void
+DwInfo::read_location_table()
+{
+   BVector loc;
+   BVector loclists;
+   Section *section = debugfile->find_section(".debug_loc");
+   if (section != NULL) {
+      loc = section->get_contents(*debugstream);
+   }
+   section = debugfile->find_section(".debug_loclists");
+   if (section != NULL) {
+      loclists = section->get_contents(*debugstream);
+   }
+
+   location_table = new LocationListTable(loc, loclists);
 }
 
 
 CUVec & DwInfo::get_compilation_units()
 {
+   wait();
    return compilation_units;
 }
 
@@ -630,10 +1600,18 @@ DwInfo::register_subprogram(std::string name, DIE * die)
 {
 }
 
+void
+DwInfo::all_units_read()
+{
+}
+
 BVector
 DwInfo::get_loc_expr(DwCUnit* cu, Address offset, Address pc) {
+   if (cu->is_split()) {
+      return cu->get_split_locations()->getexpr(cu, offset, pc);
+   }
    if (location_table == NULL) {
-      read_location_table(cu);
+      read_location_table();
    }
 
    return location_table->getexpr(cu, offset, pc);
@@ -36,7 +36,33 @@ author: David Allison <dallison@pathscale.com>
 #include "dwf_abbrv.h"
 #include "dbg_dwarf.h"
 #include "dwf_cunit.h"
+#include "dwf_index.h"
+#include "dwf_lines.h"
 
+#include <map>
+#include <set>
+
+// an FDE known only by where it is; it is read when first looked up
+struct FDEIndexEntry {
+    Address start ;
+    Address end ;
+    Offset offset ;                     // offset of the entry in its section
+    bool is_eh ;                        // .eh_frame rather than .debug_frame
+    FDE *fde ;                          // once read
+} ;
+
+typedef std::vector<FDEIndexEntry> FDEIndex ;
+
+// where the DIEs of a skeleton unit are: the unit at offset in info, and
+// the tables its DIEs use.  The sections belong to a SplitFile of the DwInfo
+struct SplitUnit {
+    BVector info ;
+    Offset offset ;                     // of the unit header in info
+    Abbreviation *abbrev ;              // the unit's abbreviation table
+    BVector loc ;                       // the unit's part of .debug_loc.dwo
+    BVector str_offsets ;               // the unit's part of .debug_str_offsets.dwo
+    BVector strings ;                   // .debug_str.dwo
+} ;
 
 class DwInfo {
 public:
@@ -77,12 +103,14 @@ public:
     void read_abbreviations () ;
     void dump () ;
     void show_symbols () ;
-    void read_debug_info (PStream *os, bool reporterror) ;
+    void read_debug_info (PStream *os, bool reporterror, bool parallel = false) ;
+    BVector get_debug_info () ;                 // .debug_info, read on first use
+    void report_no_symbols (PStream *os) ;
     void read_string_table () ;
     void read_pub_names() ;
     void read_frames () ;
     void read_frames (std::string section_name) ;
-    void read_location_table (DwCUnit* cu) ;
+    void read_location_table () ;
     CUVec& get_compilation_units () ;
     bool is_little_endian() { return elffile->is_little_endian() ;}
     DwSTab *get_string_table() { return string_table ; }
@@ -90,41 +118,146 @@ public:
     Abbreviation *find_cu_abbreviation (Offset offset) ;
     FDEMap fdes ; // map of FDE start address vs FDE
     FDEVec fdevec ;     // vector of FDE* sorted on start address
+    FDEIndex fde_index ;        // used instead of fdevec when restored from the symbol cache
     Address GOT_address() { return got ; }
     Address get_base() { return elffile->get_base() ; }
-    FDE *find_fde (Address addr) ;              // binary search for FDE on address
+    bool has_debug_info() { return debugfile->find_section (".debug_info") != NULL ; }
+    virtual FDE *find_fde (Address addr) ;      // binary search for FDE on address
     virtual DIE *find_symbol (std::string name, bool search_alias = true) { return NULL; }
     virtual DIE *find_struct (std::string name) { return NULL; }
 
+    // only the root DIE and the line table header of each unit are read
+    // up front.  These read the rest of the units that may define a name
+    // (all of them if there is no name index) or contain an (unrelocated)
+    // address, and the line tables of the units that use a file
+    bool has_name_index() { return name_index != NULL ; }
+    void expand_units (std::string name) ;
+    void expand_units_with_prefix (std::string prefix) ;
+    void expand_unit_at (Address addr) ;
+    void expand_file_lines (std::string basename) ;
+    BVector get_debug_ranges () ;               // .debug_ranges, read on first use
+    LineTable &get_line_table () { return line_table ; }
+
     int get_ver() { return 3; }
 
+    // progress of read_debug_info, may be read from another thread
+    int get_units_total() { return __sync_fetch_and_add (&units_total, 0) ; }
+    int get_units_read() { return __sync_fetch_and_add (&units_read, 0) ; }
+    void unit_read() { __sync_fetch_and_add (&units_read, 1) ; }
+
     BVector get_loc_expr(DwCUnit*, Address offset, Address pc);
 
+    // the split unit of a skeleton unit with a DW_AT_GNU_dwo_id of id, in
+    // the .dwp package beside the object or in the .dwo file named by the
+    // skeleton.  The files are kept open for the life of the DwInfo
+    bool find_split_unit (DwCUnit *cu, std::string dwoname, int64_t id, SplitUnit &unit) ;
+    bool has_split_units() { return split_units ; }
+    BVector get_debug_addr() { return debug_addr ; }
+
 protected:
     ELF * elffile ;
     std::list<DwCUnit*> cu_list;
 
     CUVec compilation_units ;
     std::istream& stream;
+    ELF * debugfile ;                           // holds the DWARF; elffile unless it is separate
+    std::istream* debugstream ;
+    LineTable line_table ;                      // rows of the units whose lines have been read
 
     virtual void register_subprogram (std::string name, DIE *die) ;
     virtual void register_symbol (std::string name, DIE *die) ;
     virtual void register_struct (std::string name, DIE *die) ;
+    virtual void all_units_read () ;                    // the last unit read with only its root DIE has been expanded
+
+    // the tables are filled in by read_debug_info, which a SymbolTable runs
+    // on a background thread.  The lookups above wait for it to finish
+    virtual void wait () {}
+    FDE *search_fde (Address addr) ;
+
+    // the (unrelocated) addresses of the ELF symbols a name or a prefix
+    // may be made from, for finding the units to expand without an index
+    virtual void find_symbol_addresses (std::string name, std::vector<Address> &addrs) ;
+    virtual void find_prefix_addresses (std::string prefix, std::vector<Address> &addrs) ;
+
+    void expand_all_units () ;                  // all_units_read() is called once they are
 
 private:
     Address read_address (BStream& stream);
 
     void disassemble_location (DwCUnit *cu, BVector location) ;
     void read_frame_entry (Section *section, BStream & stream, bool is_eh) ;
+    FDE *read_fde (FDEIndexEntry &entry) ;
+    bool read_frame_header () ;                 // is there a table to search?
+    FDE *find_eh_fde (Address addr) ;           // search the .eh_frame_hdr table
+    void read_name_index () ;
+    void match_name_index () ;
+    void drop_name_index () ;
+    void read_unit_ranges () ;
+    void read_split_roots () ;
+    void read_aranges (std::map<Offset, DwCUnit*> &units, std::set<DwCUnit*> &mapped) ;
+    bool expand_units_at (std::vector<Address> &addrs) ;
+    DwCUnit *find_unit_at (Address addr) ;
+    void unit_expanded () ;
+
+    // the code addresses of the units that have not been expanded, sorted
+    // on the low address
+    struct UnitRange {
+        Address low ;
+        Address high ;                  // first address after the range
+        DwCUnit *cu ;
+    } ;
+    typedef std::vector<UnitRange> UnitRangeVec ;
+    static bool compare_unit_ranges (const UnitRange &a, const UnitRange &b) ;
+    BVector debug_info ;
+    Section *frame_sections[2] ;        // .debug_frame and .eh_frame for read_fde
+    BVector frame_data[2] ;
     DwSTab * string_table ; // the string table
     LocationListTable* location_table ; // the location table
+    DwNameIndex *name_index ;           // .gdb_index, if there is a usable one
+    CUVec index_units ;                 // compilation units in index order
+    UnitRangeVec unit_ranges ;
+    CUVec unmapped_units ;              // units whose code addresses are not known
+    int units_deferred ;                // units not expanded yet
+    BVector debug_ranges ;
+    bool debug_ranges_read ;
+    bool frames_read ;                  // read_frames has been called
+
+    // the binary search table in .eh_frame_hdr: the start address and the
+    // address of each FDE in .eh_frame, relative to frame_table_addr
+    bool frame_header_read ;
+    BVector frame_table ;
+    Address frame_table_addr ;          // of .eh_frame_hdr, unrelocated
 
     CIEMap cies ; // map of offset vs CIE
     typedef std::map<Offset, Abbreviation*> AbbreviationMap ;
     AbbreviationMap compilationunit_abbreviations ; // map of file offset vs Abbrevation
+    void read_abbreviation_tables (BVector abbrev, AbbreviationMap &tables) ;
+
+    // a .dwo file or a .dwp package of them, NULL in split_files if it
+    // can't be read
+    struct SplitFile {
+        ELF *elf ;
+        std::istream *stream ;
+        BVector info ;                  // .debug_info.dwo
+        BVector abbrev ;
+        BVector loc ;
+        BVector str_offsets ;
+        BVector strings ;
+        BVector cu_index ;              // .debug_cu_index of a package
+        AbbreviationMap abbreviations ;
+    } ;
+    std::map<std::string, SplitFile*> split_files ;
+    bool split_units ;                  // there are skeleton units
+    BVector debug_addr ;                // read when the first one is found
+    SplitFile *open_split_file (std::string path) ;
+    bool find_dwo_unit (DwCUnit *cu, SplitFile *file, int64_t id, SplitUnit &unit) ;
+    bool find_package_unit (SplitFile *file, int64_t id, SplitUnit &unit) ;
 
     DwAbbrvTab* abb_tab;
 
+    int units_total ;                   // number of compilation units in .debug_info
+    int units_read ;                    // number of those read so far
+
     int opcode_opcounts[256] ;
     Address got ;                       // address of the global offset table for data relative encodings in FDEs
 } ;
@@ -0,0 +1,266 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: dwf_lines.cc
+
+*/
+
+#include "dwf_lines.h"
+#include "dwf_cunit.h"
+#include "file_info.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+/* The end of one sequence may be at the same address as the start of
+ * the next, perhaps in another unit.  The end sorts first so that the
+ * row starting at the address is found whatever order the units were
+ * read in.
+ */
+class LineTable::CompareAddress {
+public:
+   CompareAddress(LineTable* table) : table(table) {}
+   bool operator()(uint32_t r1, uint32_t r2) {
+      Address a1 = table->addresses[r1];
+      Address a2 = table->addresses[r2];
+      if (a1 != a2) {
+         return a1 < a2;
+      }
+      return table->is_end_sequence(r1) && !table->is_end_sequence(r2);
+   }
+private:
+   LineTable* table;
+};
+
+class LineTable::CompareLine {
+public:
+   CompareLine(LineTable* table) : table(table) {}
+   bool operator()(uint32_t r1, uint32_t r2) {
+      return table->lines[r1] < table->lines[r2];
+   }
+private:
+   LineTable* table;
+};
+
+LineTable::LineTable() {
+}
+
+void
+LineTable::add_row(Address address, int file, int line, int column,
+                   bool is_stmt, bool basic_block, bool end_sequence) {
+   uint32_t f = file & LT_FILE;
+   if (is_stmt) {
+      f |= LT_STMT;
+   }
+   if (basic_block) {
+      f |= LT_BLOCK;
+   }
+   if (end_sequence) {
+      f |= LT_END;
+   }
+   addresses.push_back(address);
+   files.push_back(f);
+   lines.push_back(line);
+   columns.push_back(column < 0 || column > 0xffff ? 0xffff : column);
+}
+
+/* Number the unit's files now that its program has been run (it may
+ * define files of its own), and index its rows.  A row with a file the
+ * unit doesn't have gets file 0, which is never a real file.
+ */
+void
+LineTable::add_unit(DwCUnit* cu, uint32_t first) {
+   uint32_t base = unitfiles.size();
+   uint32_t nfiles = cu->get_file_table().size();
+   if (nfiles == 0) {
+      unitfiles.push_back(UnitFile(cu, 0));
+      nfiles = 1;
+   } else {
+      for (uint32_t i = 0; i < nfiles; i++) {
+         unitfiles.push_back(UnitFile(cu, i));
+      }
+   }
+   for (uint32_t row = first; row < size(); row++) {
+      uint32_t file = files[row] & LT_FILE;
+      if (file >= nfiles) {
+         file = 0;
+      }
+      files[row] = (files[row] & ~LT_FILE) | (base + file);
+   }
+   index_rows(first);
+}
+
+void
+LineTable::clear() {
+   addresses.clear();
+   files.clear();
+   lines.clear();
+   columns.clear();
+   unitfiles.clear();
+   by_address.clear();
+   by_file.clear();
+}
+
+File*
+LineTable::get_file(uint32_t row) {
+   UnitFile& uf = unitfiles[files[row] & LT_FILE];
+   FileTable& ft = uf.cu->get_file_table();
+   if (uf.file >= (int)ft.size()) {
+      return NULL;
+   }
+   return ft[uf.file];
+}
+
+void
+LineTable::print(uint32_t row) {
+   File* file = get_file(row);
+   printf("0x%-20llx %-30s %-6d %-6d %d %d\n", (unsigned long long)addresses[row],
+          file == NULL ? "" : file->name.c_str(), lines[row], columns[row],
+          is_stmt(row), is_basic_block(row));
+}
+
+/* The new rows are sorted and merged into the indexes.  The merges are
+ * stable, so rows that compare equal stay in the order they were added.
+ */
+void
+LineTable::index_rows(uint32_t first) {
+   uint32_t n = by_address.size();
+   for (uint32_t row = first; row < size(); row++) {
+      by_address.push_back(row);
+   }
+   std::stable_sort(by_address.begin() + n, by_address.end(), CompareAddress(this));
+   std::inplace_merge(by_address.begin(), by_address.begin() + n, by_address.end(),
+                      CompareAddress(this));
+
+   std::map<RowVec*, uint32_t> added;   // row vec vs its size before the unit
+   uint32_t lastfile = LT_FILE;
+   RowVec* lastrows = NULL;
+   for (uint32_t row = first; row < size(); row++) {
+      uint32_t file = files[row] & LT_FILE;
+      if (file != lastfile) {
+         lastfile = file;
+         File* f = get_file(row);
+         lastrows = f == NULL ? NULL : &by_file[f->basename];
+         if (lastrows != NULL && added.count(lastrows) == 0) {
+            added[lastrows] = lastrows->size();
+         }
+      }
+      if (lastrows != NULL) {
+         lastrows->push_back(row);
+      }
+   }
+   for (std::map<RowVec*, uint32_t>::iterator i = added.begin(); i != added.end(); i++) {
+      RowVec& rows = *i->first;
+      std::stable_sort(rows.begin() + i->second, rows.end(), CompareLine(this));
+      std::inplace_merge(rows.begin(), rows.begin() + i->second, rows.end(), CompareLine(this));
+   }
+}
+
+/* the index in by_address of a row at addr, or -1 - the index of the
+ * first row after it
+ */
+int
+LineTable::search_address(Address addr) {
+   int start = 0;
+   int end = by_address.size() - 1;
+   while (start <= end) {
+      int mid = (end + start) / 2;
+      Address a = addresses[by_address[mid]];
+      if (addr == a) {
+         return mid;
+      }
+      if (addr < a) {
+         end = mid - 1;
+      } else {
+         start = mid + 1;
+      }
+   }
+   return -1 - start;
+}
+
+// the row to use for the address at by_address[index]
+uint32_t
+LineTable::row_at(int index) {
+   int n = by_address.size();
+   uint32_t row = by_address[index];
+   while (is_end_sequence(row) && index + 1 < n
+          && addresses[by_address[index+1]] == addresses[row]) {
+      row = by_address[++index];
+   }
+   return row;
+}
+
+int
+LineTable::find_address(Address addr, bool& exact) {
+   exact = false;
+   if (by_address.empty()) {
+      return -1;
+   }
+   int index = search_address(addr);
+   if (index >= 0) {
+      exact = true;
+      return row_at(index);
+   }
+   index = -1 - index - 1;              // the last row before addr
+   if (index < 0) {
+      index = 0;
+   }
+   return by_address[index];
+}
+
+int
+LineTable::find_next_address(Address addr) {
+   int index = search_address(addr);
+   if (index < 0) {
+      return -1;
+   }
+   int n = by_address.size();
+   while (index < n && addresses[by_address[index]] == addr) {
+      index++;
+   }
+   if (index == n) {
+      return -1;
+   }
+   return by_address[index];
+}
+
+int
+LineTable::find_line(std::string basename, int line) {
+   FileIndex::iterator fi = by_file.find(basename);
+   if (fi == by_file.end()) {
+      return -1;
+   }
+   RowVec& rows = fi->second;
+   int start = 0;
+   int end = rows.size() - 1;
+   while (start <= end) {
+      int mid = (end + start) / 2;
+      if (line == lines[rows[mid]]) {
+         return rows[mid];
+      }
+      if (line < lines[rows[mid]]) {
+         end = mid - 1;
+      } else {
+         start = mid + 1;
+      }
+   }
+   return -1;
+}
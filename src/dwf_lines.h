@@ -0,0 +1,110 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: dwf_lines.h
+
+*/
+
+#ifndef _DWF_LINES_H_
+#define _DWF_LINES_H_
+
+#include "dbg_types.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+class DwCUnit;
+class File;
+
+// The line tables of all the compilation units of an object.  The rows
+// are kept in parallel arrays in the order the line programs produced
+// them, a unit at a time.  A row's file is a number for the unit and
+// the unit's file number together; the flags are in its top bits.  The
+// rows are indexed on address, and on line number for each file
+// basename, as each unit's line program is run.
+
+class LineTable {
+public:
+   LineTable();
+
+   // a row of the unit whose program is being run; file is the unit's
+   // file number
+   void add_row(Address address, int file, int line, int column,
+                bool is_stmt, bool basic_block, bool end_sequence);
+   void add_unit(DwCUnit* cu, uint32_t first);  // rows from first are the unit's
+   void clear();
+
+   uint32_t size() { return addresses.size(); }
+   Address get_address(uint32_t row) { return addresses[row]; }
+   int get_line(uint32_t row) { return lines[row]; }
+   int get_column(uint32_t row) { return columns[row]; }
+   bool is_stmt(uint32_t row) { return (files[row] & LT_STMT) != 0; }
+   bool is_basic_block(uint32_t row) { return (files[row] & LT_BLOCK) != 0; }
+   bool is_end_sequence(uint32_t row) { return (files[row] & LT_END) != 0; }
+   DwCUnit* get_unit(uint32_t row) { return unitfiles[files[row] & LT_FILE].cu; }
+   File* get_file(uint32_t row);
+   void print(uint32_t row);
+
+   // these return a row, or -1
+   int find_address(Address addr, bool& exact);  // the row at or before addr
+   int find_next_address(Address addr);         // the first row after those at addr
+   int find_line(std::string basename, int line);
+
+private:
+   friend class SymbolCache;
+
+   enum {
+      LT_STMT = 0x80000000,
+      LT_BLOCK = 0x40000000,
+      LT_END = 0x20000000,              // first address after a sequence
+      LT_FILE = 0x1fffffff
+   };
+
+   struct UnitFile {
+      UnitFile(DwCUnit* cu, int file) : cu(cu), file(file) {}
+      DwCUnit* cu;
+      int file;                         // number in the unit's file table
+   };
+
+   class CompareAddress;
+   class CompareLine;
+
+   void index_rows(uint32_t first);
+   int search_address(Address addr);
+   uint32_t row_at(int index);
+
+   std::vector<Address> addresses;
+   std::vector<uint32_t> files;         // UnitFile index and flags
+   std::vector<int> lines;
+   std::vector<uint16_t> columns;       // 0xffff if wider
+
+   std::vector<UnitFile> unitfiles;
+
+   typedef std::vector<uint32_t> RowVec;
+   typedef std::map<std::string, RowVec> FileIndex;
+
+   RowVec by_address;                   // sorted on address
+   FileIndex by_file;                   // basename vs rows sorted on line
+};
+
+#endif
@@ -35,6 +35,8 @@ author: James Strother <jims@pathscale.com>
 #include "dwf_spec.h"
 #include "process.h"
 
+#include <algorithm>
+
 Value DwLocExpr::getAddress() {
    if (data.size() != 1) {
       throw Exception("Address unavailable for this variable");
@@ -149,17 +151,31 @@ DwLocEval::execute()
       expr = (BVector) attr;
    }
 
-   BStream stream(expr, dwarf->do_swap());
-
-   int op = stream.read1u();
-   eval_op(stream, op);
+   DwLocProgram* prog = cu->get_loc_program(expr);
+
+   switch (prog->kind) {
+   case DwLocProgram::LOCP_REG:
+      result.add(LOC_REG, prog->value, 0);
+      return result;
+   case DwLocProgram::LOCP_FBREG:
+      result.add(LOC_ADDR, frame_base + prog->value, 0);
+      return result;
+   case DwLocProgram::LOCP_ADDR:
+      result.add(LOC_ADDR, prog->value, 0);
+      return result;
+   case DwLocProgram::LOCP_OPS:
+      break;
+   }
 
-   while (!stream.eof()) {
-      op = stream.read1u();
-      eval_op(stream, op);
+   needs_push = true;
+   unsigned int next = 0;
+   while (next < prog->ops.size()) {
+      const DwLocProgram::Op& op = prog->ops[next++];
+      eval_op(op, next);
    }
 
    if (needs_push) {
+      if (sp < 1) throw Exception("Unable to get value of variable");
       if (top_is_reg) {
          result.add(LOC_REG, stack[sp-1], 0);
       } else {
@@ -171,7 +187,7 @@ DwLocEval::execute()
 }
 
 int
-DwLocEval::get_lit_num (int op) {
+DwLocProgram::get_lit_num (int op) {
 #define DEF_CASE(NUM)           \
    case DW_OP_lit##NUM: return NUM;
 
@@ -215,7 +231,7 @@ DwLocEval::get_lit_num (int op) {
 }
 
 int
-DwLocEval::get_reg_num (int op) {
+DwLocProgram::get_reg_num (int op) {
 #define DEF_CASE(NUM)           \
    case DW_OP_reg##NUM: return NUM;
 
@@ -258,7 +274,7 @@ DwLocEval::get_reg_num (int op) {
 }
 
 int
-DwLocEval::get_breg_num(int op) {
+DwLocProgram::get_breg_num(int op) {
 #define DEF_CASE(NUM)           \
    case DW_OP_breg##NUM: return NUM;
 
@@ -300,73 +316,159 @@ DwLocEval::get_breg_num(int op) {
 #undef DEF_CASE
 }
 
-void
-DwLocEval::eval_op(BStream& stream, int op) {
-   int num;
+/* The operands are read here so that eval_op only has to run the
+ * ops.  Literals and constants become DW_OP_constu, and the
+ * numbered register operations DW_OP_regx and DW_OP_bregx.
+ */
+DwLocProgram::DwLocProgram(DwCUnit* cu, BVector expr)
+: kind(LOCP_OPS), value(0)
+{
+   BStream stream(expr, cu->get_dwinfo()->do_swap());
+   std::vector<int> starts;            /* offset of each op */
 
-   /* set default state */
-   needs_push = true;
+   while (!stream.eof()) {
+      starts.push_back(stream.offset());
+      int op = stream.read1u();
+      int num;
+
+      num = get_reg_num(op);
+      if (num != -1) {
+         ops.push_back(Op(DW_OP_regx, num));
+         continue;
+      }
 
-   /* special case register ops */
-   num = get_reg_num(op);
-   if (num != -1) {
-      stack[sp++] = num;
-      top_is_reg = true;
-      return;
-   }
+      num = get_lit_num(op);
+      if (num != -1) {
+         ops.push_back(Op(DW_OP_constu, num));
+         continue;
+      }
 
-   if (op == DW_OP_regx) { 
-      num = stream.read_uleb();
-      stack[sp++] = num;
-      top_is_reg = true;
-      return;
-   } 
+      num = get_breg_num(op);
+      if (num != -1) {
+         Address offset = stream.read_sleb();
+         ops.push_back(Op(DW_OP_bregx, num, offset));
+         continue;
+      }
 
-   /* special case literal operations */
-   num = get_lit_num(op);
-   if (num != -1) {
-      stack[sp++] = num;
-      return;
+      /* the split DWARF operands are indexes into .debug_addr */
+      if (op == DW_OP_GNU_addr_index) {
+         ops.push_back(Op(DW_OP_addr, cu->get_indexed_address(stream.read_uleb())));
+         continue;
+      }
+      if (op == DW_OP_GNU_const_index) {
+         ops.push_back(Op(DW_OP_constu, cu->get_indexed_address(stream.read_uleb())));
+         continue;
+      }
+
+      /* catch vender extensions */
+      if (op >= DW_OP_lo_user &&
+          op <= DW_OP_hi_user) {
+         throw Exception();
+      }
+
+      switch (op) {
+#define READ_OP(TAG,CMD)                              \
+      case DW_OP_##TAG:                               \
+         ops.push_back(Op(DW_OP_constu, stream.CMD())); \
+         break;
+
+      READ_OP(const1u, read1u)
+      READ_OP(const2u, read2u)
+      READ_OP(const4u, read4u)
+      READ_OP(const8u, read8u)
+
+      READ_OP(const1s, read1s)
+      READ_OP(const2s, read2s)
+      READ_OP(const4s, read4s)
+      READ_OP(const8s, read8s)
+
+      READ_OP(constu,  read_uleb)
+      READ_OP(consts,  read_sleb)
+#undef READ_OP
+
+      case DW_OP_regx:
+      case DW_OP_plus_uconst:
+      case DW_OP_piece:
+         ops.push_back(Op(op, stream.read_uleb()));
+         break;
+      case DW_OP_fbreg:
+         ops.push_back(Op(op, stream.read_sleb()));
+         break;
+      case DW_OP_pick:
+      case DW_OP_deref_size:
+      case DW_OP_xderef_size:
+         ops.push_back(Op(op, stream.read1u()));
+         break;
+      case DW_OP_addr:
+         ops.push_back(Op(op, cu->read_address(stream)));
+         break;
+      case DW_OP_bregx: {
+         int rnum = stream.read_uleb();
+         Address offset = stream.read_sleb();
+         ops.push_back(Op(op, rnum, offset));
+         break;
+      }
+      case DW_OP_bra:
+      case DW_OP_skip: {
+         /* the offset of the target for now */
+         int offset = stream.read2s();
+         ops.push_back(Op(op, stream.offset() + offset));
+         break;
+      }
+      default:
+         ops.push_back(Op(op));
+         break;
+      }
    }
 
-   /* special case breg operations */
-   num = get_breg_num(op);
-   if (num != -1) {
-      Address offset = stream.read_sleb();
-      Address rval = process->get_reg(num);
-      stack[sp++] = rval + offset;
-      return;
+   /* branch to the op at the target, or past the last one */
+   for (unsigned int i = 0; i < ops.size(); i++) {
+      if (ops[i].op != DW_OP_bra && ops[i].op != DW_OP_skip) {
+         continue;
+      }
+      Address target = ops[i].arg1;
+      if (target >= (Address)expr.length()) {
+         ops[i].arg1 = ops.size();
+         continue;
+      }
+      std::vector<int>::iterator s = std::lower_bound(starts.begin(), starts.end(), target);
+      if (target < 0 || s == starts.end() || *s != target) {
+         throw Exception("Invalid branch in location expression");
+      }
+      ops[i].arg1 = s - starts.begin();
    }
 
-   /* catch vender extensions */
-   if (op >= DW_OP_lo_user &&
-       op <= DW_OP_hi_user) {
-      throw Exception();
+   if (ops.size() == 1) {
+      switch (ops[0].op) {
+      case DW_OP_regx:  kind = LOCP_REG; break;
+      case DW_OP_fbreg: kind = LOCP_FBREG; break;
+      case DW_OP_addr:  kind = LOCP_ADDR; break;
+      }
+      if (kind != LOCP_OPS) {
+         value = ops[0].arg1;
+         ops.clear();
+      }
    }
+}
 
-   switch (op) {
+void
+DwLocEval::eval_op(const DwLocProgram::Op& o, unsigned int& next) {
+   /* set default state */
+   needs_push = true;
+
+   switch (o.op) {
 
-/*  Push values onto the stack from stream
+/*  Push values onto the stack
  **************************************************
  */
-#define READ_OP(TAG,CMD)              \
-   case DW_OP_##TAG:                  \
-      stack[sp++] = stream.CMD();     \
-      break;
-
-   READ_OP(const1u, read1u)
-   READ_OP(const2u, read2u)
-   READ_OP(const4u, read4u)
-   READ_OP(const8u, read8u)
-
-   READ_OP(const1s, read1s)
-   READ_OP(const2s, read2s)
-   READ_OP(const4s, read4s)
-   READ_OP(const8s, read8s)
+   case DW_OP_regx:
+      stack[sp++] = o.arg1;
+      top_is_reg = true;
+      return;
 
-   READ_OP(constu,  read_uleb)
-   READ_OP(consts,  read_sleb)
-#undef READ_OP 
+   case DW_OP_constu:
+      stack[sp++] = o.arg1;
+      break;
 
 
 /*  Modify top stack value with midfix op
@@ -466,7 +568,7 @@ DwLocEval::eval_op(BStream& stream, int op) {
       break;
    }
    case DW_OP_pick:{
-      int v = sp - stream.read1u() - 1;
+      int v = sp - o.arg1 - 1;
       if (v < 0) throw Exception();
       stack[sp] = stack[v];
       sp++;
@@ -478,13 +580,16 @@ DwLocEval::eval_op(BStream& stream, int op) {
  **************************************************
  */
    case DW_OP_addr:{
-      Address v = cu->read_address(stream);
-      stack[sp++] = v;
+      stack[sp++] = o.arg1;
       break;
    }
    case DW_OP_nop: {
       break;
    }
+   case DW_OP_call_frame_cfa: {
+      stack[sp++] = process->get_cfa();
+      break;
+   }
 
 
 /*  Special cases of arithmetic operations
@@ -508,7 +613,7 @@ DwLocEval::eval_op(BStream& stream, int op) {
    case DW_OP_plus_uconst:{
       if (sp < 1) throw Exception();
       Address v1 = stack[sp - 1];
-      Address v2 = stream.read_uleb();
+      Address v2 = o.arg1;
       stack[sp - 1] = v1 + v2;
       break;
    }
@@ -518,17 +623,15 @@ DwLocEval::eval_op(BStream& stream, int op) {
  */
    case DW_OP_bra:{
       if (sp < 1) throw Exception();
-      int offset = stream.read2s();
-      Address v = stack[sp];
+      Address v = stack[sp - 1];
       if (v != 0) {
-         stream.seek(offset, BSTREAM_CUR);
+         next = o.arg1;
       }
       sp--;
       break;
    }
    case DW_OP_skip:{
-      int offset = stream.read2s();
-      stream.seek(offset, BSTREAM_CUR);
+      next = o.arg1;
       break;
    }
 
@@ -537,15 +640,12 @@ DwLocEval::eval_op(BStream& stream, int op) {
  **************************************************
  */
    case DW_OP_fbreg:{
-      Address offset = stream.read_sleb();
-      stack[sp++] = frame_base + offset;
+      stack[sp++] = frame_base + o.arg1;
       break;
    }
    case DW_OP_bregx:{
-      int rnum = stream.read_uleb();
-      Address rval = process->get_reg(rnum);
-      Address offset = stream.read_sleb();
-      stack[sp++] = rval + offset;
+      Address rval = process->get_reg(o.arg1);
+      stack[sp++] = rval + o.arg2;
       break;
    }
 
@@ -564,7 +664,7 @@ DwLocEval::eval_op(BStream& stream, int op) {
    }
    case DW_OP_deref_size: {
       if (sp < 1) throw Exception();
-      int size = stream.read1u();
+      int size = o.arg1;
       Address addr = stack[sp - 1];
       if (addr != 0) {
          Address val = process->read(addr, size); 
@@ -587,7 +687,7 @@ DwLocEval::eval_op(BStream& stream, int op) {
    }
    case DW_OP_xderef_size: {
       if (sp < 2) throw Exception();
-      int size = stream.read1u();
+      int size = o.arg1;
       Address addr = stack[sp - 1];
       Address asi = stack[sp - 2];
       (void) asi; /* unused var */
@@ -602,7 +702,7 @@ DwLocEval::eval_op(BStream& stream, int op) {
   case DW_OP_piece: {
      if (sp < 1) throw Exception();
      Address v1 = stack[sp - 1];
-     Address v2 = stream.read_uleb();
+     Address v2 = o.arg1;
      DwLocType type;
 
      if (top_is_reg) {
@@ -616,10 +716,10 @@ DwLocEval::eval_op(BStream& stream, int op) {
      break;
   }
 
+  } /* end of switch */
+
 /*  If you got this far your're not a register
  **************************************************
  */
   top_is_reg = false;
-
-  } /* end of switch */
 }
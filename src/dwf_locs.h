@@ -32,6 +32,7 @@ author: David Allison <dallison@pathscale.com>
 #define _DWF_LOCS_H_
 
 #include <list>
+#include <vector>
 #include "dwf_attr.h"
 
 class DwInfo;
@@ -64,6 +65,44 @@ private:
 };
 
 
+
+// A location expression decoded once: the operations with their operands
+// read, the literal, constant and register operations reduced to a few
+// forms, and branch targets turned into operation numbers.  An expression
+// that is just DW_OP_regN, DW_OP_fbreg or DW_OP_addr is kept as a
+// descriptor of where the value is, and evaluating it needs no stack.
+
+class DwLocProgram {
+public:
+   DwLocProgram(DwCUnit* cu, BVector expr);     // throws Exception
+
+   enum Kind {
+      LOCP_REG,                         // in register value
+      LOCP_FBREG,                       // at frame base + value
+      LOCP_ADDR,                        // at address value
+      LOCP_OPS                          // run ops
+   };
+
+private:
+   friend class DwLocEval;
+
+   struct Op {
+      Op(int op, Address arg1 = 0, Address arg2 = 0) : op(op), arg1(arg1), arg2(arg2) {}
+      int op;
+      Address arg1;                     // for a branch, the op to go to
+      Address arg2;
+   };
+
+   static int get_lit_num(int op);
+   static int get_reg_num(int op);
+   static int get_breg_num(int op);
+
+   Kind kind;
+   Address value;
+   std::vector<Op> ops;
+};
+
+
 class DwLocEval {
 public:
 
@@ -74,11 +113,7 @@ public:
    void push(Address);
 
 private:
-   int get_lit_num(int op);
-   int get_reg_num(int op);
-   int get_breg_num(int op);
-
-   void eval_op(BStream&, int);
+   void eval_op(const DwLocProgram::Op&, unsigned int& next);
 
    LocationStack stack;
    DwLocExpr result;
@@ -148,6 +148,7 @@ enum DwAttrId {
    DW_AT_call_file                             = 0x58,
    DW_AT_call_line                             = 0x59,
    DW_AT_description                           = 0x60,
+   DW_AT_linkage_name                          = 0x6e,
    DW_AT_lo_user                               = 0x2000,
    DW_AT_MIPS_fde                              = 0x2001,
    DW_AT_MIPS_loop_begin                       = 0x2002,
@@ -172,6 +173,11 @@ enum DwAttrId {
    DW_AT_src_coords                            = 0x2104,
    DW_AT_body_begin                            = 0x2105,
    DW_AT_body_end                              = 0x2106,
+   DW_AT_GNU_dwo_name                          = 0x2130,
+   DW_AT_GNU_dwo_id                            = 0x2131,
+   DW_AT_GNU_ranges_base                       = 0x2132,
+   DW_AT_GNU_addr_base                         = 0x2133,
+   DW_AT_GNU_pubnames                          = 0x2134,
    DW_AT_hi_user                               = 0x3fff
 };
 
@@ -199,7 +205,13 @@ enum DwFormId {
    DW_FORM_ref4                                = 0x13,
    DW_FORM_ref8                                = 0x14,
    DW_FORM_ref_udata                           = 0x15,
-   DW_FORM_indirect                            = 0x16
+   DW_FORM_indirect                            = 0x16,
+   DW_FORM_sec_offset                          = 0x17,
+   DW_FORM_exprloc                             = 0x18,
+   DW_FORM_flag_present                        = 0x19,
+   DW_FORM_ref_sig8                            = 0x20,
+   DW_FORM_GNU_addr_index                      = 0x1f01,
+   DW_FORM_GNU_str_index                       = 0x1f02
 };
 
 extern StringLUT globl_DwOpcodeId_lut[];
@@ -353,7 +365,10 @@ enum DwOpcodeId {
    DW_OP_call2                                 = 0x97,
    DW_OP_call4                                 = 0x98,
    DW_OP_call_ref                              = 0x9a,
+   DW_OP_call_frame_cfa                        = 0x9c,
    DW_OP_lo_user                               = 0xe0,
+   DW_OP_GNU_addr_index                        = 0xfb,
+   DW_OP_GNU_const_index                       = 0xfc,
    DW_OP_hi_user                               = 0xff
 };
 
@@ -410,7 +425,14 @@ enum DwLangId {
    DW_LANG_Fortran90                           = 0x0008,
    DW_LANG_Pascal83                            = 0x0009,
    DW_LANG_Modula2                             = 0x000a,
+   DW_LANG_C99                                 = 0x000c,
    DW_LANG_Fortran95                           = 0x000e,
+   DW_LANG_C_plus_plus_03                      = 0x0019,
+   DW_LANG_C_plus_plus_11                      = 0x001a,
+   DW_LANG_C11                                 = 0x001d,
+   DW_LANG_C_plus_plus_14                      = 0x0021,
+   DW_LANG_Fortran03                           = 0x0022,
+   DW_LANG_Fortran08                           = 0x0023,
    DW_LANG_lo_user                             = 0x8000,
    DW_LANG_hi_user                             = 0xffff
 };
@@ -492,6 +514,24 @@ enum DwEHFrameId {
    DW_EH_PE_indirect                           = 0x80
 };
 
+extern StringLUT globl_DwLocListId_lut[];
+
+enum DwLocListId {
+   DW_LLE_end_of_list                          = 0x00,
+   DW_LLE_base_addressx                        = 0x01,
+   DW_LLE_startx_endx                          = 0x02,
+   DW_LLE_startx_length                        = 0x03,
+   DW_LLE_offset_pair                          = 0x04,
+   DW_LLE_default_location                     = 0x05,
+   DW_LLE_base_address                         = 0x06,
+   DW_LLE_start_end                            = 0x07,
+   DW_LLE_start_length                         = 0x08,
+   DW_LLE_GNU_end_of_list_entry                = 0x00,
+   DW_LLE_GNU_base_address_selection_entry     = 0x01,
+   DW_LLE_GNU_start_end_entry                  = 0x02,
+   DW_LLE_GNU_start_length_entry               = 0x03
+};
+
 extern StringLUT globl_DwChildId_lut[];
 
 enum DwChildId {
@@ -499,5 +539,18 @@ enum DwChildId {
    DW_CHILDREN_yes                             = 0x01
 };
 
+extern StringLUT globl_DwSectId_lut[];
+
+enum DwSectId {
+   DW_SECT_INFO                                = 0x01,
+   DW_SECT_TYPES                               = 0x02,
+   DW_SECT_ABBREV                              = 0x03,
+   DW_SECT_LINE                                = 0x04,
+   DW_SECT_LOC                                 = 0x05,
+   DW_SECT_STR_OFFSETS                         = 0x06,
+   DW_SECT_MACINFO                             = 0x07,
+   DW_SECT_MACRO                               = 0x08
+};
+
 
 #endif
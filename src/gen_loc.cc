@@ -42,7 +42,7 @@ bool FunctionLocation::at_first_line(Address addr) {
 void FunctionLocation::print() {
     printf ("0x%llx %-20s\n",
 	    (unsigned long long) address,
-	    symbol->name.c_str()) ;
+	    symbol->name) ;
 }
 
 
@@ -60,7 +60,7 @@ void FunctionLocation::print() {
 
 DIE* Location::get_subp_die() {
     if (func != NULL && func->symbol != NULL) {
-       return func->symbol->die;
+       return func->symbol->get_die();
     }
     return NULL;
 }
@@ -34,7 +34,7 @@ author: James Strother <jims@pathscale.com>
 #include "file_info.h"
 
 class SymbolTable;
-class LineInfo;
+class DwCUnit;
 class Process;
 class Frame;
 class Symbol;
@@ -80,7 +80,7 @@ public:
       address = 0;
       file = NULL;
       line = -1;
-      linfo = NULL;
+      unit = NULL;
       stab = NULL;
       func = NULL;
       offset = 0;
@@ -101,8 +101,8 @@ public:
    void set_symname(const std::string& s) { funcname = s; }
    const std::string& get_symname() const { return funcname; }
 
-   void set_lineinfo(LineInfo* _linfo) { linfo = _linfo; }
-   LineInfo* get_lineinfo() const { return linfo; }
+   void set_unit(DwCUnit* _unit) { unit = _unit; }     // of the line
+   DwCUnit* get_unit() const { return unit; }
 
    void set_symtab(SymbolTable* _stab) { stab = _stab; }
    SymbolTable* get_symtab() const { return stab; }
@@ -147,7 +147,7 @@ private:
    SymbolTable* stab;
    DirectoryTable* dirlist;
    FunctionLocation* func;
-   LineInfo* linfo;
+   DwCUnit* unit;
    Address address;
    File *file;
    int line;
@@ -0,0 +1,206 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: map_intern.h
+
+*/
+
+#ifndef _MAP_INTERN_H_
+#define _MAP_INTERN_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+template<class VTYPE>
+class Map_Intern
+{
+/* This class provides a lookup keyed on strings from a
+ * StringPool.  A pooled string is equal to another only if
+ * it is the same pointer, so the key is hashed and compared
+ * as a pointer and the characters are never looked at.  The
+ * caller gets the key with StringPool::find(), and if that
+ * is NULL the string is not in any map.
+ *
+ * It is an open addressed hash table with linear probing.
+ * The order of iteration is that of the table, not of the
+ * strings.
+ *
+ * It requires an assignment operator and a default
+ * constructor for the VTYPE.
+ */
+public:
+
+   /* Constructors and destructors.  Note that
+    * the copy constructor is disallowed.
+    */
+private:
+   Map_Intern(const Map_Intern&);
+
+public:
+   Map_Intern() {
+      data = NULL;
+      size = 0;
+      count = 0;
+   }
+
+   ~Map_Intern() {
+      if (data != NULL) {
+         delete[] data;
+      }
+   }
+
+   /* Add or replace an item */
+   void set(const char* key, VTYPE val) {
+      if ((count + 1) * 4 > size * 3) grow();
+
+      long i = slot(data, size, key);
+      if (data[i].key == NULL) {
+         data[i].key = key;
+         count++;
+      }
+      data[i].value = val;
+   }
+
+   /* The value for a key, or NULL if there is none */
+   VTYPE* find(const char* key) {
+      if (count == 0 || key == NULL) return NULL;
+
+      long i = slot(data, size, key);
+      if (data[i].key == NULL) return NULL;
+      return &data[i].value;
+   }
+
+   void clear() {
+      if (data != NULL) {
+         delete[] data;
+      }
+      data = NULL;
+      size = 0;
+      count = 0;
+   }
+
+   /* Informative member functions */
+   long length() { return count; }
+
+   /* Iterator for traversing the mapped values */
+   class doublet {
+   public:
+      doublet() { key = NULL; }
+      const char* key;
+      VTYPE value;
+   };
+
+   class iterator {
+   public:
+      iterator(Map_Intern<VTYPE>* _data, long _idx) {
+         data = _data;
+         idx = _idx;
+         skip();
+      }
+
+      iterator() {
+         data = NULL;
+         idx = -1;
+      }
+
+      const doublet& operator*() {
+         return data->data[idx];
+      }
+
+      const doublet* operator->() {
+         return &data->data[idx];
+      }
+
+      iterator operator++() {
+         idx += 1;
+         skip();
+         return *this;
+      }
+
+      iterator operator++(int) {
+         iterator tmp = *this;
+         idx += 1;
+         skip();
+         return tmp;
+      }
+
+      bool operator==(const iterator& X) {
+         return (idx == X.idx);
+      }
+
+      bool operator!=(const iterator& X) {
+         return (idx != X.idx);
+      }
+
+   private:
+      /* move to the next used slot, or the end */
+      void skip() {
+         while (idx >= 0 && idx < data->size && data->data[idx].key == NULL) {
+            idx += 1;
+         }
+         if (idx >= data->size) idx = -1;
+      }
+
+      Map_Intern<VTYPE>* data;
+      long idx;
+   };
+
+   iterator begin() {
+      if (count == 0) return end();
+      return iterator(this, 0);
+   }
+
+   iterator end() {
+      return iterator();
+   }
+
+private:
+   static long slot(doublet* d, long n, const char* key) {
+      uintptr_t h = (uintptr_t)key;
+      h = (h >> 4) ^ (h >> 16);
+      long i = (long)((h * 2654435761u) & (n - 1));
+      while (d[i].key != NULL && d[i].key != key) {
+         i = (i + 1) & (n - 1);
+      }
+      return i;
+   }
+
+   void grow() {
+      long n = size == 0 ? 64 : size * 2;
+      doublet* d = new doublet[n];
+      for (long i=0; i<size; i++) {
+         if (data[i].key != NULL) {
+            d[slot(d, n, data[i].key)] = data[i];
+         }
+      }
+      if (data != NULL) {
+         delete[] data;
+      }
+      data = d;
+      size = n;
+   }
+
+   doublet* data;
+   long size;   /* power of 2 */
+   long count;
+};
+
+#endif
@@ -91,6 +91,9 @@ public:
    bool raw(RTYPE lo, RTYPE hi, VTYPE val);
    void sort();
 
+   /* Remove the item starting at lo */
+   bool remove(RTYPE lo);
+
    /* Find an item with given range */
    bool get(RTYPE key, VTYPE* val) {
       if (unsort) sort();
@@ -114,6 +117,12 @@ public:
       return iterator(this, i);
    }
 
+   /* Remove all the items */
+   void clear() {
+      cpos = 0;
+      unsort = false;
+   }
+
    /* Informative member functions */
    long length() { return cpos; }
 
@@ -253,28 +262,45 @@ bool Map_Range<RTYPE, VTYPE>::add(
 
    if (unsort) sort();
 
-   for (long i=0; i<cpos; i++) {
-      if (lo < data[i].lo) {
-         memmove(data+i+1, data+i,
-           (cpos-i)*sizeof(triplet));
-
-         data[i].lo = lo;
-         data[i].hi = hi;
-         data[i].val = val;
-
-         cpos++;
-         return false;
-      } 
+   /* find the first item after lo */
+   long low = 0;
+   long high = cpos;
+   while (low < high) {
+      long mid = (low+high)/2;
+      if (lo < data[mid].lo) {
+         high = mid;
+      } else {
+         low = mid + 1;
+      }
    }
 
-   data[cpos].lo = lo;
-   data[cpos].hi = hi;
-   data[cpos].val = val;
+   memmove(data+low+1, data+low,
+     (cpos-low)*sizeof(triplet));
+
+   data[low].lo = lo;
+   data[low].hi = hi;
+   data[low].val = val;
 
    cpos++;
    return false;
 }
 
+template <class RTYPE, class VTYPE>
+bool Map_Range<RTYPE, VTYPE>::remove(RTYPE lo)
+{
+   if (unsort) sort();
+
+   long i = bin_search(data, cpos, lo);
+   if (i == -1 || !(data[i].lo == lo))
+      return true;
+
+   memmove(data+i, data+i+1,
+     (cpos-i-1)*sizeof(triplet));
+
+   cpos--;
+   return false;
+}
+
 template <class RTYPE, class VTYPE>
 bool Map_Range<RTYPE, VTYPE>::raw(
    RTYPE lo,
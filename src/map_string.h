@@ -34,6 +34,8 @@ Author:   James Strother <jims@pathscale.com>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <string>
+#include <vector>
 
 template<class VTYPE>
 class Map_String
@@ -56,6 +58,12 @@ class Map_String
  * but this class was needed for partial matches anyway and
  * it can be optimized for strings rather than general keys.
  *
+ * The keys are not copied, so they must live as long as the
+ * map does; strings from the StringPool do.  Raw appends are
+ * sorted on their own and merged into the sorted list, so a
+ * list that grows a little between lookups is cheap to keep
+ * sorted.
+ *
  * It requires only an assignment operator for the VTYPE.
  */
 public:
@@ -72,6 +80,7 @@ public:
       data = NULL;
       cpos = 0;
       size = 0;
+      nsorted = 0;
       unsort = false;
    }
 
@@ -82,13 +91,11 @@ public:
       data = NULL;
       cpos = 0;
       size = 0;
+      nsorted = 0;
       unsort = false;
    }
 
    ~Map_String() {
-      for (long i=0; i<cpos; i++) {
-         free((char*)data[i].key);
-      }
       if (data != NULL) {
          free(data);
       }
@@ -131,6 +138,26 @@ public:
       return iterator(this, lo, 1); 
    }
 
+   /* Append the rest of each distinct key that starts
+    * with prefix.  If limit is above zero no more than
+    * limit are added, but the last match is always one of
+    * them so that what is added has the same common start
+    * as all the matches.  Returns true if any were left out.
+    */
+   bool complete(const char* prefix, std::vector<std::string>& result, long limit);
+
+   /* Remove all the items */
+   void clear() {
+      if (data != NULL) {
+         free(data);
+      }
+      data = NULL;
+      cpos = 0;
+      size = 0;
+      nsorted = 0;
+      unsort = false;
+   }
+
    /* Informative member functions */
    long length() { return cpos; }
 
@@ -236,8 +263,15 @@ private:
    long search_hi(doublet*, long, const char*);
    long search_exact(doublet*, long, const char*);
 
-   /* Workhorse for quicksort algorithm */
+   /* Workhorses for quicksort and merge algorithms */
    static void quicksort(doublet*, long, long, doublet*);
+   static void median(doublet*, long, long, doublet*);
+   static void swap(doublet* a, doublet* b, doublet* swp) {
+      memcpy(swp,a,sizeof(doublet));
+      memcpy(a,b,sizeof(doublet));
+      memcpy(b,swp,sizeof(doublet));
+   }
+   bool merge();
 
    /* String comparison function hooks */
    static bool s_less(const char* a, const char* b) {
@@ -262,6 +296,7 @@ private:
    long   cpos;
    long   size;
    long  chunk;
+   long nsorted;   /* items before the raw appends */
    bool unsort;
 };
 
@@ -270,14 +305,16 @@ template <class VTYPE>
 bool Map_String<VTYPE>::chk_resize()
 {
    if (cpos >= size) {
+      /* grow by half again so appends are linear overall */
+      long grow = size/2 > chunk ? size/2 : chunk;
       doublet* nptr = (doublet*) realloc(data,
-         (size+chunk)*sizeof(doublet));
+         (size+grow)*sizeof(doublet));
 
       if (nptr == NULL) {
          return true;
       }
       data = nptr;
-      size = size+chunk;
+      size = size+grow;
    }
 
    return false;
@@ -294,23 +331,25 @@ bool Map_String<VTYPE>::add(
 
    if (unsort) sort();
 
-   for (long i=0; i<cpos; i++) {
-      if ( s_less(key,data[i].key) ) {
-         memmove(data+i+1, data+i,
-           (cpos-i)*sizeof(doublet));
-
-         data[i].key = strdup(key);
-         data[i].value = value;
-
-         cpos++;
-         return false;
-      } 
+   /* the first item greater than key */
+   long lo = 0, hi = cpos;
+   while (lo < hi) {
+      long mid = (lo+hi)/2;
+      if ( s_less(key,data[mid].key) ) {
+         hi = mid;
+      } else {
+         lo = mid + 1;
+      }
    }
 
-   data[cpos].key = strdup(key);
-   data[cpos].value = value;
+   memmove(data+lo+1, data+lo,
+     (cpos-lo)*sizeof(doublet));
+
+   data[lo].key = key;
+   data[lo].value = value;
 
    cpos++;
+   nsorted = cpos;
    return false;
 }
 
@@ -323,7 +362,7 @@ bool Map_String<VTYPE>::raw(
       return true;
 
    doublet* p_data = data+cpos;
-   p_data->key = strdup(key);
+   p_data->key = key;
    p_data->value = value;
    unsort = true;
 
@@ -341,33 +380,92 @@ void Map_String<VTYPE>::quicksort(
    const char* v;
    long i, j;
 
-   if (r <= l) return;
+   /* Recurse on the smaller side and loop on the larger
+    * so the stack stays shallow whatever the input.
+    */
+   while (r > l) {
+      median(d, l, r, swp);
+
+      i = l - 1;
+      j = r;
+      v = d[r].key;
 
-   i = l - 1;
-   j = r;
-   v = d[r].key;
+      for (;;) {
+         while ( s_less(d[++i].key, v) );
+         while ( s_less(v, d[--j].key) ) {
+            if (j == l) break;
+         }
 
-   for (;;) {
-      while ( s_less(d[++i].key, v) );
-      while ( s_less(v, d[--j].key) ) {
-         if (j == l) break;
+         if (i >= j) break;
+
+         swap(d+i, d+j, swp);
       }
 
-      if (i >= j) break;
+      if (i != r) {
+         swap(d+i, d+r, swp);
+      }
 
-      memcpy(swp,d+j,sizeof(doublet));
-      memcpy(d+j,d+i,sizeof(doublet));
-      memcpy(d+i,swp,sizeof(doublet));
+      if (i-l < r-i) {
+         quicksort(d, l, i-1, swp);
+         l = i+1;
+      } else {
+         quicksort(d, i+1, r, swp);
+         r = i-1;
+      }
    }
+}
+
+template <class VTYPE>
+void Map_String<VTYPE>::median(
+   doublet* d,
+   long l,
+   long r,
+   doublet* swp)
+{
+/* Move the median of the first, middle and last items to
+ * the end to be the pivot.  Without this a sorted list,
+ * which is what raw appends usually are, is the worst case.
+ */
+   long m = l + (r-l)/2;
+
+   if (r-l < 2) return;
+
+   if ( s_less(d[m].key, d[l].key) ) swap(d+m, d+l, swp);
+   if ( s_less(d[r].key, d[l].key) ) swap(d+r, d+l, swp);
+   if ( s_less(d[m].key, d[r].key) ) swap(d+m, d+r, swp);
+}
 
-   if (i != r) {
-      memcpy(swp,d+i,sizeof(doublet));
-      memcpy(d+i,d+r,sizeof(doublet));
-      memcpy(d+r,swp,sizeof(doublet));
+template <class VTYPE>
+bool Map_String<VTYPE>::merge()
+{
+/* Merge the sorted raw appends into the sorted items
+ * before them, from the top down so that only the appends
+ * need a copy.
+ */
+   long n = cpos - nsorted;
+   doublet* tmp = (doublet*) malloc(n*sizeof(doublet));
+
+   if (tmp == NULL) {
+      return true;
+   }
+   memcpy(tmp, data+nsorted, n*sizeof(doublet));
+
+   long i = nsorted - 1;
+   long j = n - 1;
+   long k = cpos - 1;
+   while (j >= 0) {
+      if (i >= 0 && s_less(tmp[j].key, data[i].key)) {
+         memcpy(data+k, data+i, sizeof(doublet));
+         i--;
+      } else {
+         memcpy(data+k, tmp+j, sizeof(doublet));
+         j--;
+      }
+      k--;
    }
 
-   quicksort(d, l, i-1, swp);
-   quicksort(d, i+1, r, swp);
+   free(tmp);
+   return false;
 }
 
 template <class VTYPE>
@@ -377,8 +475,54 @@ void Map_String<VTYPE>::sort()
 
    unsort = false;
 
-   if (cpos <= 1) return;
-   quicksort(data, 0, cpos-1, &swp); 
+   if (cpos <= 1) {
+      nsorted = cpos;
+      return;
+   }
+
+   if (nsorted == 0 || nsorted >= cpos) {
+      quicksort(data, 0, cpos-1, &swp);
+   } else {
+      quicksort(data, nsorted, cpos-1, &swp);
+      if (merge()) {
+         quicksort(data, 0, cpos-1, &swp);
+      }
+   }
+   nsorted = cpos;
+}
+
+template <class VTYPE>
+bool Map_String<VTYPE>::complete(
+   const char* prefix,
+   std::vector<std::string>& result,
+   long limit)
+{
+   if (cpos == 0) return false;
+   if (unsort) sort();
+
+   long lo = search_lo(data, cpos, prefix);
+   if (lo == -1) return false;
+
+   long hi = lo + search_hi(data+lo, cpos-lo, prefix);
+   size_t len = strlen(prefix);
+
+   const char* last = NULL;
+   long n = 0;
+   bool skipped = false;
+   for (long i=lo; i<=hi; i++) {
+      if (limit > 0 && n == limit-1 && i < hi) {
+         i = hi;   /* the last match */
+         skipped = true;
+      }
+      if (last != NULL && s_cmp(last, data[i].key) == 0) {
+         continue;
+      }
+      last = data[i].key;
+      result.push_back(std::string(last+len));
+      n++;
+   }
+
+   return skipped;
 }
 
 template <class VTYPE>
@@ -388,7 +532,9 @@ long Map_String<VTYPE>::search_lo(
    const char* v)
 {
 /* Searchs for the lowest element which
- * still matches against the given key.
+ * still matches against the given key.  Every
+ * key it matches sorts at or after it, so this
+ * is the first element not less than the key.
  */
 
    long low, mid, high;
@@ -396,28 +542,19 @@ long Map_String<VTYPE>::search_lo(
    if (lim == 0) return -1;
 
    low = 0;
-   high = lim - 1;
+   high = lim;
 
-   while (low <= high) {
+   while (low < high) {
       mid = (low+high)/2;
 
-      int out = s_cmp(v, d[mid].key);
-      if ( out == 0 ) {
-         return mid;
-      } else if (out < 0) {
-         high = mid - 1;
-      } else {
+      if ( s_less(d[mid].key, v) ) {
          low = mid + 1;
+      } else {
+         high = mid;
       }
    }
 
-   if (high >= 0 && high < lim &&
-       s_match(v, d[high].key)) {
-      return high; 
-   }
-
-   if (low >= 0 && low < lim &&
-       s_match(v, d[low].key)) {
+   if (low < lim && s_match(v, d[low].key)) {
       return low;
    }
 
@@ -970,6 +970,18 @@ ProcessController::get_frame_size()
 	return current_process->get_frame_size() ;
 }
 
+bool
+ProcessController::has_frame (int n)
+{
+	return current_process->has_frame(n) ;
+}
+
+void
+ProcessController::get_thread_stacks (int n, std::vector<std::vector<Address> > &stacks)
+{
+	current_process->get_thread_stacks(n, stacks) ;
+}
+
 int
 ProcessController::get_current_thread()
 {
@@ -80,6 +80,8 @@ public:
     RegisterSet * get_frame_reg ();
     int get_frame();
     int get_frame_size();
+    bool has_frame (int n);
+    void get_thread_stacks (int n, std::vector<std::vector<Address> > &stacks);
     void print_function_paras (int fid, DIE *die);
 
     File *find_file(std::string name);
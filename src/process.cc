@@ -35,8 +35,10 @@ author: David Allison <dallison@pathscale.com>
 #include "type_struct.h"
 #include "utils.h"
 #include "symtab.h"
+#include "sect_cache.h"
 #include "breakpoint.h"
 #include <errno.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include "dbg_thread_db.h"
@@ -51,6 +53,8 @@ author: David Allison <dallison@pathscale.com>
 #include <sys/stat.h>
 #include "trace.h"
 #include <ios>
+#include <fstream>
+#include <set>
 
 #if defined (__linux__)
 #define WAITPID_ALL_CHILD_TYPES __WALL
@@ -92,8 +96,8 @@ ObjectFile::ObjectFile (std::string name, ELF * elf, std::istream & stream, Symb
 }
                                                                                                                                            
 ObjectFile::~ObjectFile() {
+    delete symtab ;             // first, it may still be reading the ELF file
     delete elf ;
-    delete symtab ;
 }
 
 LinkMap::LinkMap (Architecture *arch, Process *proc, Address addr)
@@ -143,6 +147,9 @@ Frame::Frame (Process *proc, Architecture *arch, int n, Location &loc, RegisterS
 	set_loc(loc);
 }
 
+// the location of a frame that has been unwound is looked up when it is
+// first used
+
 Frame::Frame (Process *proc, Architecture *arch, int n)
 {
 	init (proc, arch, n);
@@ -157,14 +164,17 @@ void Frame::init (Process* _proc, Architecture* _arch, int _n) {
 
     /* init others */
     valid = false;
+    loc_valid = false;
     return_addr = 0;
+    stale = false;
 
     regs = arch->main_register_set_properties()->new_empty_register_set();
     fp_regs = arch->fpu_register_set_properties()->new_empty_register_set();
 }
 
 Frame::~Frame() {
-	// FIXME: Delete register sets.
+	delete regs;
+	delete fp_regs;
 }
 
 void Frame::set_pc(Address addr)
@@ -186,9 +196,14 @@ void Frame::set_fp(Address addr)
 
 void Frame::set_loc (Location &l) {
     loc = l ;
+    loc_valid = true ;
 }
 
 Location & Frame::get_loc() {
+        if (!loc_valid) {
+            loc = proc->lookup_address (get_pc()) ;
+            loc_valid = true ;
+        }
         return loc ;
 }
 
@@ -201,7 +216,7 @@ void Frame::print(PStream &os, bool indent, bool current) {
         }
     }
     os.print ("#%d  ", n ) ;
-    proc->print_loc(loc, this, os) ;
+    proc->print_loc(get_loc(), this, os) ;
 }
 
 void Frame::set_reg(int reg, Address value)
@@ -236,6 +251,10 @@ Address Frame::get_ra()
 
 void Frame::publish_regs(Thread * thr, bool force)
 {
+	if (stale)
+	{
+		proc->refresh_frames(n);
+	}
 	if (regs->is_dirty())
 	{
 		thr->soft_set_regs(regs, force);
@@ -319,79 +338,72 @@ std::string Rule::toString()
 }
 
 CFATable::CFATable (Architecture *arch, Process *proc, Address loc, int ra_reg)
-    : arch(arch), proc(proc), loc(loc),
+    : arch(arch), proc(proc), loc(loc), start(loc), last_loc(loc), backwards(false),
     ra_reg(ra_reg),
-    cfa(new Rule (CFA_CFA, 0, 0)),
-    ra(new Rule (CFA_UNDEFINED, 0, 0)), saved_regs(NULL), saved_ra(NULL) {
+    rules(FIRST_REG + arch->total_number_of_regs()) {
 
-    regs = new Rule * [arch->total_number_of_regs()] ;
+    rules[CFA_RULE] = Rule (CFA_CFA, 0, 0) ;
     for (int i = 0 ; i < arch->total_number_of_regs(); i++) {
-        regs[i] = new Rule (CFA_UNDEFINED, i, 0) ;
+        rules[FIRST_REG + i].reg = i ;
     }
 }
 
 CFATable::~CFATable() {
-    delete [] regs ;
-    delete cfa ;
-    delete ra ;
-    delete [] saved_regs ;
-    delete saved_ra ;
 }
 
 void CFATable::set_cfa(int reg, int offset) {
-        cfa->reg = reg ;
-        cfa->offset = offset ;
+        rules[CFA_RULE].reg = reg ;
+        rules[CFA_RULE].offset = offset ;
 }
 
 void CFATable::set_cfa_reg(int reg) {
-        cfa->reg = reg ;
+        rules[CFA_RULE].reg = reg ;
 }
 
 void CFATable::set_cfa_offset(int offset) {
-        cfa->offset = offset ;
+        rules[CFA_RULE].offset = offset ;
 }
 
 int CFATable::get_cfa_reg() {
-        return cfa->reg ;
+        return rules[CFA_RULE].reg ;
 }
 
 int CFATable::get_cfa_offset() {
-        return cfa->offset ;
+        return rules[CFA_RULE].offset ;
 }
 
 void CFATable::set_reg(int reg, CFARuleType type, int offset) {
-        if (reg == ra_reg) {
-            ra->type = type ;
-            ra->offset = offset ;
-        } else {
-            regs[reg]->type = type ;
-            regs[reg]->offset = offset ;
+        int r = reg == ra_reg ? RA_RULE : FIRST_REG + reg ;
+        if (reg < 0 || r >= (int)rules.size()) {
+            return ;            // not a register we know
         }
+        rules[r].type = type ;
+        rules[r].offset = offset ;
 }
 
 void CFATable::save() {
-    saved_regs = new Rule * [arch->total_number_of_regs()] ;
-    for (int i = 0 ; i < arch->total_number_of_regs(); i++) {
-        saved_regs[i] = new Rule (regs[i]->type, regs[i]->reg, regs[i]->offset) ;
-    }
-    saved_ra = new Rule (ra->type, ra->reg, ra->offset) ;
+    saved_rules = rules ;
 }
 
 void CFATable::restore(int reg) {
-    if (reg == ra_reg) {
-        ra->type = saved_ra->type ;
-        ra->offset = saved_ra->offset ;
-    } else {
-        regs[reg]->type = saved_regs[reg]->type ;
-        regs[reg]->offset = saved_regs[reg]->offset ;
+    int r = reg == ra_reg ? RA_RULE : FIRST_REG + reg ;
+    if (reg < 0 || r >= (int)saved_rules.size()) {
+        return ;
     }
+    rules[r].type = saved_rules[r].type ;
+    rules[r].offset = saved_rules[r].offset ;
 }
 
 void CFATable::advance_loc(Address delta) {
+        last_loc = loc ;
         loc += delta ;
 }
 
 void CFATable::set_loc(Address l) {
+        if (l < loc) {
+            backwards = true ;
+        }
+        last_loc = loc ;
         loc = l ;
 }
 
@@ -399,16 +411,40 @@ Address CFATable::get_loc() {
         return loc ;
 }
 
+// The instructions stop after the first advance past pc, so the row
+// runs from the location before it to the location after it, or to the
+// end of the FDE if they ran out first.
+void CFATable::get_row(Address pc, Address end, Address &rowstart, Address &rowend) {
+        if (loc > pc) {
+            rowstart = last_loc ;
+            rowend = loc < end ? loc : end ;
+        } else {
+            rowstart = loc ;
+            rowend = end ;
+        }
+        if (backwards || rowstart < start || rowstart > pc || rowend <= pc) {
+            rowstart = pc ;
+            rowend = pc + 1 ;
+        }
+}
+
 void CFATable::print() {
-        std::cout <<"0x" << std::hex <<  loc << " " << cfa->toString() << " " ;
+        std::cout <<"0x" << std::hex <<  loc << " " << rules[CFA_RULE].toString() << " " ;
         for (int i = 0 ; i < arch->total_number_of_regs(); i++) {
-            std::cout << regs[i]->toString() << " " ;
+            std::cout << rules[FIRST_REG + i].toString() << " " ;
         }
-        std::cout << ra->toString() ;
+        std::cout << rules[RA_RULE].toString() ;
         std::cout << '\n' ;
 }
 
 void CFATable::apply(Frame *from, Frame * to) {
+        apply (arch, proc, &rules[0], from, to) ;
+}
+
+void CFATable::apply(Architecture *arch, Process *proc, const Rule *rules, Frame *from, Frame * to) {
+        const Rule *cfa = &rules[CFA_RULE] ;
+        const Rule *ra = &rules[RA_RULE] ;
+        const Rule *regs = &rules[FIRST_REG] ;
 
         // set the PC of the next frame to the return address
         //printf ("setting pc to return address\n") ;
@@ -445,7 +481,7 @@ void CFATable::apply(Frame *from, Frame * to) {
         //std::cout << "applying cfa rules to registers" << '\n' ;
         int nregs = arch->total_number_of_regs() ;
         for (int i = 0 ; i < nregs; i++) {
-            Rule *rule = regs[i] ;
+            const Rule *rule = &regs[i] ;
             switch (rule->type) {
 	    case CFA_CFA:
 	    case CFA_UNDEFINED:
@@ -492,6 +528,48 @@ void CFATable::apply(Frame *from, Frame * to) {
 }
 
 
+const Rule *UnwindCache::find (Address pc) {
+    RowMap::iterator i = rows.upper_bound (pc) ;
+    if (i == rows.begin()) {
+        return NULL ;
+    }
+    i-- ;
+    if (pc >= i->second.end) {
+        return NULL ;
+    }
+    return &pool[i->second.first] ;
+}
+
+void UnwindCache::add (Address start, Address end, const Rule *rules, int n) {
+    if (nrules == 0) {
+        nrules = n ;
+    }
+    if (n != nrules || rows.count (start) != 0) {
+        return ;
+    }
+    rows.insert (std::pair<Address, Row> (start, Row (end, pool.size()))) ;
+    pool.insert (pool.end(), rules, rules + n) ;
+}
+
+// the pool is packed again without the rows that are dropped
+void UnwindCache::remove (Address start, Address end) {
+    RowMap::iterator first = rows.lower_bound (start) ;
+    RowMap::iterator last = rows.lower_bound (end) ;
+    if (first == last) {
+        return ;
+    }
+    rows.erase (first, last) ;
+    std::vector<Rule> kept ;
+    kept.reserve (rows.size() * nrules) ;
+    for (RowMap::iterator i = rows.begin() ; i != rows.end() ; i++) {
+        int old = i->second.first ;
+        i->second.first = kept.size() ;
+        kept.insert (kept.end(), pool.begin() + old, pool.begin() + old + nrules) ;
+    }
+    pool.swap (kept) ;
+}
+
+
 Process::Process (ProcessController * pcm, std::string program, Architecture * arch, Target *target, PStream &os, AttachType at)
     : pcm(pcm),
     program(program),
@@ -507,11 +585,18 @@ Process::Process (ProcessController * pcm, std::string program, Architecture * a
     ibpnum(1),
     hitbp(NULL),
     r_debug(0),
+    link_maps_deleted(false),
     stepping_lines(false),
     stepping_over(false),
     main(0),
     frame_cache_valid(false),
+    frames_complete(false),
+    stale_pid(0),
+    stale_complete(false),
+    stale_corrupted(false),
+    finishing(false),
     current_frame(-1),
+    caching_pages(false),
     plt_start(0),
     plt_end(0),
     fixup_addr(0),
@@ -572,11 +657,18 @@ Process::Process (const Process &old)
       ibpnum(1),
       hitbp(NULL),
       r_debug(0),
+      link_maps_deleted(false),
       stepping_lines(false),
       stepping_over(false),
       main(0),
       frame_cache_valid(false),
+      frames_complete(false),
+      stale_pid(0),
+      stale_complete(false),
+      stale_corrupted(false),
+      finishing(false),
       current_frame(-1),
+      caching_pages(false),
       plt_start(0),
       plt_end(0),
       fixup_addr(0),
@@ -625,6 +717,7 @@ Process::Process (const Process &old)
     }
     else if (program != "") {
         objectfiles.push_back (new ObjectFile (*old.objectfiles[0])) ;          // copy first object file
+        add_object_ranges (objectfiles[0]) ;
         main = lookup_symbol ("main") ;
         if (main != 0) {
             current_location = lookup_address (main) ;
@@ -747,7 +840,7 @@ Process::~Process() {
     }
 
     // delete frames from the frame cache
-    if(frame_cache_valid) invalidate_frame_cache();
+    invalidate_frame_cache();
 }
 
 const char *Process::get_state() {
@@ -1232,7 +1325,20 @@ void Process::open_object_file(std::string name, Address baseaddress, bool repor
     //elf->list_symbols() ;
     SymbolTable * symtab = NULL ;
     try {
-        symtab = new SymbolTable (arch, elf, *elfstream, pcm->get_aliases(), &os, reporterror) ;
+        // a shared library's debug information may be read when it is needed
+        // instead; a symbol table read in the background needs a stream of its own
+        bool deferred = !reporterror && get_int_opt(PRM_DEFER_SOL) != 0 ;
+        bool background = !reporterror && !deferred && get_int_opt(PRM_BG_SYM) != 0 ;
+        // compressed sections are spilled to the symbol cache when over the limit
+        section_cache.set_limit ((size_t)get_int_opt(PRM_SECT_CACHE) << 20, get_int_opt(PRM_SYM_CACHE) != 0) ;
+        std::istream *symstream = elfstream ;
+        if (background) {
+            symstream = new std::ifstream (name.c_str(), std::ios::binary) ;
+            open_streams.push_back (symstream) ;
+        }
+        symtab = new SymbolTable (arch, elf, *symstream, pcm->get_aliases(), &os, reporterror,
+                                  get_int_opt(PRM_PAR_SYM) != 0, background, get_int_opt(PRM_SYM_CACHE) != 0,
+                                  deferred, get_str_opt(PRM_DEBUG_DIR)) ;
     } catch (Exception e) {
         os.print ("no debugging information for file %s\n", name.c_str()) ;
     } catch (const char *s) {
@@ -1240,6 +1346,7 @@ void Process::open_object_file(std::string name, Address baseaddress, bool repor
     }
     objectfiles.push_back (new ObjectFile (name, elf, *elfstream, symtab)) ;
     open_streams.push_back(elfstream);
+    add_object_ranges (objectfiles.back()) ;
 
     // add code region to valid region table
     Section *text = elf->find_section (".text") ;
@@ -1307,7 +1414,7 @@ int Process::get_main_language() {
     if (MAIN__ != 0) {
         Location loc = lookup_address (MAIN__) ;
         if (loc.get_funcloc() != NULL) {
-            int lang = loc.get_funcloc()->symbol->die->get_language() ;
+            int lang = loc.get_funcloc()->symbol->get_die()->get_language() ;
             return lang ;
         }
     } else {
@@ -1315,7 +1422,7 @@ int Process::get_main_language() {
         if (main != 0) {
             Location loc = lookup_address (main) ;
             if (loc.get_funcloc() != NULL) {
-                int lang = loc.get_funcloc()->symbol->die->get_language() ;
+                int lang = loc.get_funcloc()->symbol->get_die()->get_language() ;
                 return lang ;
             }
         }
@@ -1338,9 +1445,7 @@ int Process::get_main_language() {
 }
 
 void Process::print_function_paras (int fid, DIE *die) {
-	build_frame_cache() ;
-
-	if (fid < 0 || fid >= frame_cache.size())
+	if (!has_frame (fid))
 		throw Exception("Frame is not right.");
 
 	print_function_paras (frame_cache[fid], die);
@@ -1407,7 +1512,7 @@ void Process::print_expression(std::string expr, Format &fmt, bool terse, bool r
     } else {
         Location &loc = frame_cache[current_frame]->get_loc() ;
         if (loc.has_debug_info()) {
-            die = loc.get_funcloc()->symbol->die ; // subprogram die
+            die = loc.get_funcloc()->symbol->get_die() ; // subprogram die
             die->check_loaded() ;
             symtab = loc.get_symtab();
             if (autolang) {
@@ -1495,7 +1600,7 @@ void Process::display_expression(int num, std::string expr, Node *tree, Format &
     } else {
         Location &loc = frame_cache[current_frame]->get_loc() ;
         if (loc.get_funcloc() != NULL) {
-            die = loc.get_funcloc()->symbol->die ; // subprogram die
+            die = loc.get_funcloc()->symbol->get_die() ; // subprogram die
             die->check_loaded() ;
             symtab = loc.get_symtab();
             if (autolang) {
@@ -1569,7 +1674,7 @@ void Process::print_type(std::string expr, bool show_contents) {
     } else {
         Location &loc = frame_cache[current_frame]->get_loc() ;
         if (loc.has_debug_info()) {
-            die = loc.get_funcloc()->symbol->die ; // subprogram die
+            die = loc.get_funcloc()->symbol->get_die() ; // subprogram die
             die->check_loaded() ;
             symtab = loc.get_symtab();
             if (autolang) {
@@ -1648,7 +1753,7 @@ Node *Process::compile_expression(std::string expr, int &end, bool single) {
     } else {
         Location &loc = frame_cache[current_frame]->get_loc() ;
         if (loc.get_funcloc() != NULL) {
-            die = loc.get_funcloc()->symbol->die ; // subprogram die
+            die = loc.get_funcloc()->symbol->get_die() ; // subprogram die
             die->check_loaded() ;
             symtab = loc.get_symtab();
             if (autolang) {
@@ -1682,7 +1787,7 @@ Address Process::evaluate_expression(std::string expr, int &end, bool needint) {
     } else {
         Location &loc = frame_cache[current_frame]->get_loc() ;
         if (loc.get_funcloc() != NULL) {
-            die = loc.get_funcloc()->symbol->die ; // subprogram die
+            die = loc.get_funcloc()->symbol->get_die() ; // subprogram die
             die->check_loaded() ;
             symtab = loc.get_symtab();
             if (autolang) {
@@ -1744,7 +1849,7 @@ Value Process::evaluate_expression(Node *tree, bool addressonly) {
     } else {
         Location &loc = frame_cache[current_frame]->get_loc() ;
         if (loc.get_funcloc() != NULL) {
-            die = loc.get_funcloc()->symbol->die ; // subprogram die
+            die = loc.get_funcloc()->symbol->get_die() ; // subprogram die
             die->check_loaded() ;
             symtab = loc.get_symtab();
             if (autolang) {
@@ -1783,7 +1888,7 @@ void Process::complete_symbol (std::string name, std::vector<std::string> &resul
         Location &loc = frame_cache[current_frame]->get_loc() ;
         DIE *die = NULL ;
         if (loc.get_funcloc() != NULL) {
-            die = loc.get_funcloc()->symbol->die ;
+            die = loc.get_funcloc()->symbol->get_die() ;
         } 
         if (die != NULL) {
             die->complete_symbol (name, pc, result) ;
@@ -1793,10 +1898,11 @@ void Process::complete_symbol (std::string name, std::vector<std::string> &resul
 
 
 void Process::complete_function (std::string name, std::vector<std::string> &result) {
+    int limit = get_int_opt (PRM_MAX_COMPL) ;
     for (uint i = 0 ; i < objectfiles.size(); i++) {
         ObjectFile *file = objectfiles[i] ;
         if (file->symtab != NULL) {
-            file->symtab->complete_function (name, result) ;
+            file->symtab->complete_function (name, result, limit) ;
         }
     }
 }
@@ -2412,11 +2518,11 @@ DIE * Process::find_scope(std::string name, bool topdown) {
         if (frame_cache_valid) {              // is there a current frame?
             Location &loc = frame_cache[current_frame]->get_loc() ;
             if (loc.get_funcloc() != NULL) {
-                die = loc.get_funcloc()->symbol->die ;
+                die = loc.get_funcloc()->symbol->get_die() ;
             } 
         } else {
             if (current_location.get_funcloc() != NULL) {
-                die = current_location.get_funcloc()->symbol->die ;
+                die = current_location.get_funcloc()->symbol->get_die() ;
             }
         }
  
@@ -2452,11 +2558,11 @@ SymbolValue Process::find_symbol(std::string name, Address reqpc) {
     if (frame_cache_valid) {              // is there a current frame?
         Location &loc = frame_cache[current_frame]->get_loc() ;
         if (loc.get_funcloc() != NULL) {
-            die = loc.get_funcloc()->symbol->die ;
+            die = loc.get_funcloc()->symbol->get_die() ;
         } 
     } else {
         if (current_location.get_funcloc() != NULL) {
-            die = current_location.get_funcloc()->symbol->die ;
+            die = current_location.get_funcloc()->symbol->get_die() ;
         }
     }
   
@@ -2490,14 +2596,9 @@ SymbolValue Process::find_symbol(std::string name, Address reqpc) {
 }
 
 FDE *Process::find_fde (Address addr) {
-    for (uint i = 0 ; i < objectfiles.size(); i++) {
-        ObjectFile *file = objectfiles[i] ;
-        if (file->symtab != NULL) {
-            FDE *fde = file->symtab->find_fde (addr) ;
-            if (fde != NULL) {
-                return fde ;
-            }
-        }
+    ObjectFile *file = find_object_file (addr) ;
+    if (file != NULL && file->symtab != NULL) {
+        return file->symtab->find_fde (addr) ;
     }
     return NULL ;
 }
@@ -2515,15 +2616,12 @@ Section * Process::lookup_symbol_section(std::string name) {
     return NULL ;
 }
 
+// the section addresses are those in the file, so take off the base address
 Section * Process::find_section_at_addr(Address addr) {
-    for (uint i = 0 ; i < objectfiles.size(); i++) {
-        ObjectFile *file = objectfiles[i] ;
-        Section * section = file->elf->find_section_at_addr (addr) ;
-        if (section != NULL) {
-            return section ;
-        }
+    ObjectFile *file = find_object_file (addr) ;
+    if (file != NULL) {
+        return file->elf->find_section_at_addr (addr - file->elf->get_base()) ;
     }
-
     return NULL ;
 }
 
@@ -2635,13 +2733,11 @@ bool Process::is_case_blind() {
 }
 
 Location Process::lookup_address(Address addr, bool guess) {
-    for (uint i = 0 ; i < objectfiles.size(); i++) {
-        ObjectFile *file = objectfiles[i] ;
-        if (file->symtab != NULL) {
-            Location loc = file->symtab->find_address (addr, guess) ;
-            if (loc.get_symname() != "") {           // found it?
-                return loc ;
-            }
+    ObjectFile *file = find_object_file (addr) ;
+    if (file != NULL && file->symtab != NULL) {
+        Location loc = file->symtab->find_address (addr, guess) ;
+        if (loc.get_symname() != "") {           // found it?
+            return loc ;
         }
     }
 
@@ -2683,8 +2779,29 @@ Address Process::lookup_line (int line) {
 // such as the frame pointer and the register values->  All the registers are
 // initially clean and are only published to a thread if they have been modified
 
-// invalidate the frame cache so that it will be build anew next time we stop
-void Process::invalidate_frame_cache() {
+// invalidate the frame cache so that it will be build anew next time we stop.
+// When the process is only being stepped the frames are kept, so that
+// the callers' frames can be used again if they are still on the stack.
+// A stop that only made frame 0, like the single steps of next and
+// finish, replaces just the innermost stale frame: the callers are
+// matched on their own stack and frame pointers and pc (see
+// reuse_stale_frames), so the deeper ones are still worth keeping
+void Process::invalidate_frame_cache(bool keep) {
+    if (keep && frame_cache.size() == 1 && stale_frames.size() > 1
+        && stale_pid == (*current_thread)->get_pid()) {
+        delete stale_frames[0] ;
+        stale_frames[0] = frame_cache[0] ;
+        frame_cache.clear() ;
+    }
+    if (!keep || !frame_cache.empty()) {
+        delete_stale_frames() ;
+    }
+    if (keep && !frame_cache.empty()) {
+        stale_frames.swap (frame_cache) ;
+        stale_pid = (*current_thread)->get_pid() ;
+        stale_complete = frames_complete ;
+        stale_corrupted = frame_corrupted ;
+    }
     frame_cache_valid = false ;
     for (uint i = 0 ; i < frame_cache.size() ; i++) {
         delete frame_cache[i] ;
@@ -2693,6 +2810,74 @@ void Process::invalidate_frame_cache() {
     current_frame = -1 ;
 }
 
+void Process::delete_stale_frames() {
+    for (uint i = 0 ; i < stale_frames.size() ; i++) {
+        delete stale_frames[i] ;
+    }
+    stale_frames.clear() ;
+}
+
+// A frame is the same one as before the step if it has the same stack
+// pointer (the CFA of the frame below it), frame pointer and pc.  The
+// frames above it are then the same as they were, so they are moved to
+// the frame cache instead of being unwound again.  The last frame unwound
+// is looked for among all the old frames but the innermost, as the step
+// may have left a function; it is tried as frame 1 and then as frame 2,
+// for a step into a function, whose caller's pc has moved on.
+//
+// Only the pcs and stack and frame pointers of the old frames are known
+// to be right.  Registers that the functions below them had not saved
+// may have changed, so the old frames are marked stale and their
+// registers are worked out again if they are used (see refresh_frames).
+void Process::reuse_stale_frames() {
+    Frame *caller = frame_cache.back() ;
+    uint match = 0 ;
+    if (stale_pid == (*current_thread)->get_pid()) {
+        for (uint i = 1 ; i < stale_frames.size() ; i++) {
+            Frame *old = stale_frames[i] ;
+            if (old->get_sp() == caller->get_sp() && old->get_fp() == caller->get_fp()
+                && old->get_pc() == caller->get_pc()) {
+                match = i ;
+                break ;
+            }
+        }
+    }
+    if (match == 0 && frame_cache.size() < 3) {
+        return ;                        // keep them to try frame 2
+    }
+    if (match != 0) {
+        for (uint i = match + 1 ; i < stale_frames.size() ; i++) {
+            stale_frames[i]->set_n (frame_cache.size()) ;
+            stale_frames[i]->set_stale (true) ;
+            frame_cache.push_back (stale_frames[i]) ;
+        }
+        stale_frames.resize (match + 1) ;
+        frames_complete = stale_complete ;
+        frame_corrupted = stale_corrupted ;
+    }
+    delete_stale_frames() ;
+}
+
+// work out the registers of the stale frames up to frame n again, from the
+// frames below them
+void Process::refresh_frames(int n) {
+    for (int i = 1 ; i <= n && i < (int)frame_cache.size() ; i++) {
+        Frame *frame = frame_cache[i] ;
+        if (!frame->is_stale()) {
+            continue ;
+        }
+        frame->set_stale (false) ;
+        Frame *nframe = new Frame (this, arch, i) ;
+        try {
+            unwind_regs (frame_cache[i-1], nframe) ;
+            frame->get_regs()->take_values_from (nframe->get_regs()) ;
+        } catch (Exception e) {
+            // keep the old ones
+        }
+        delete nframe ;
+    }
+}
+
 bool Process::check_code_address (Address pc) {
     if (!is_valid_code_address (pc)) {
          return false ;
@@ -2700,6 +2885,10 @@ bool Process::check_code_address (Address pc) {
     return true ;
 }
 
+// Only the frame that stopped is made when the process stops.  The
+// frames above it are unwound one at a time when something asks for
+// them, by has_frame, and their locations are looked up when they are
+// first used.
 void Process::build_frame_cache() {
     if (frame_cache_valid ||
         state == IDLE ||
@@ -2707,80 +2896,71 @@ void Process::build_frame_cache() {
        return;
     }
 
+    frame_corrupted = false;
+    frames_complete = false;
+
     /* we want to persist errors */
     try {
 
-    /* setup stack iterators */
-    int n = 0;
-    frame_corrupted = false;
-
     /* find current registers */
     sync();
     Address pc = get_reg("pc");
-    Address sp = get_reg("sp");
-    Address fp = get_reg("fp");
     Location loc = lookup_address (pc);
 
     /* instantiate top frame */
-    Frame *frame = new Frame (this, arch, n++, loc, get_frame_reg());
+    Frame *frame = new Frame (this, arch, 0, loc, get_frame_reg());
     frame_cache.push_back (frame);
 
-    /* iterate up through stack frames */
-    while (loc.get_symname() != "main" && frame->get_fp() != 0) {
-        Frame *nframe;
-        FDE* fde;
-
-        /* don't follow a corrupt pc */
-        if ( !test_address(pc) ) {
-            frame_corrupted = true;
-            break;
-        }
+    } catch (Exception e) {
+        frames_complete = true;
+    }
 
-        nframe = new Frame (this, arch, n++);
+    /* mark frame as read */
+    frame_cache_valid = true;
+    current_frame = 0;
+}
 
-        /* first check for signal trampoline */
-        if (arch->in_sigtramp(this, loc.get_symname())) {
-            RegisterSet *r = nframe->get_regs();
-            arch->get_sigcontext_frame(this, sp, r);
-            goto next_iteration;
-        } 
+// Unwind the frame above the last one in the frame cache.  There is none
+// above main, or a frame with no frame pointer, or when the stack looks
+// corrupt.
+bool Process::unwind_frame() {
+    if (frames_complete || frame_cache.empty()) {
+        return false;
+    }
+    frames_complete = true;             // unless a frame is added
 
-        /* then check for an FDE entry */
-        fde = find_fde (pc);
-        if (fde != NULL) {
-            execute_fde (fde, pc, frame, nframe, false);
+    Frame *frame = frame_cache.back();
+    Frame *nframe = NULL;
 
-	    fde = find_fde (nframe->get_pc());
-	    if (fde != NULL) {
-		execute_fde (fde, nframe->get_pc(), frame, nframe, false);
-		goto next_iteration;
-	    }
-        }
+    /* we want to persist errors */
+    try {
 
-        /* no luck, fall back on frame pointer */
-        arch->guess_frame (this, frame, nframe);
+    Address pc = frame->get_pc();
+    Location &loc = frame->get_loc();
 
-next_iteration:
+    if (loc.get_symname() == "main" || frame->get_fp() == 0) {
+        return false;
+    }
 
-        /* update the loop values */
-        pc = nframe->get_pc();
-        sp = nframe->get_sp();
-        fp = nframe->get_fp();
-        loc = lookup_address (pc);
-        nframe->set_loc (loc);
+    /* don't follow a corrupt pc */
+    if ( !test_address(pc) ) {
+        frame_corrupted = true;
+        return false;
+    }
 
-        /* check pc before pushing */
-        if ( !test_address(pc) )  {
-           frame_corrupted = true;
-           delete nframe;
-           break;
-        }
+    if (frame->is_stale()) {
+        refresh_frames (frame_cache.size() - 1);
+    }
+    nframe = new Frame (this, arch, frame_cache.size());
+    unwind_regs (frame, nframe);
 
-        frame_cache.push_back (nframe);
-        frame = nframe;
+    /* check pc before pushing */
+    if ( !test_address(nframe->get_pc()) )  {
+       frame_corrupted = true;
+       delete nframe;
+       return false;
     }
 
-    /* fall out of frame building */
     } catch (Exception e) {
         /* ignore errors.  they are likely just
          * unable to access memory errors b/c a
@@ -2788,11 +2968,126 @@ next_iteration:
          */
 
         /* e.report(std::cerr); */
+        delete nframe;
+        return false;
     }
 
-    /* mark frame as read */
-    frame_cache_valid = true;
-    current_frame = 0;
+    frame_cache.push_back (nframe);
+    frames_complete = false;
+    if (frame_cache.size() <= 3 && !stale_frames.empty()) {
+        reuse_stale_frames() ;
+    }
+    return true;
+}
+
+// Work out the registers of the frame that called frame.  Throws
+// Exception.
+void Process::unwind_regs(Frame *frame, Frame *nframe) {
+    Address pc = frame->get_pc();
+    Address sp = frame->get_sp();
+    Location &loc = frame->get_loc();
+    FDE* fde;
+
+    /* first check for signal trampoline */
+    if (arch->in_sigtramp(this, loc.get_symname())) {
+        RegisterSet *r = nframe->get_regs();
+        arch->get_sigcontext_frame(this, sp, r);
+        return;
+    } 
+
+    /* then check for an FDE entry */
+    fde = find_fde (pc);
+    if (fde != NULL) {
+        execute_fde (fde, pc, frame, nframe, false);
+
+        fde = find_fde (nframe->get_pc());
+        if (fde != NULL) {
+            execute_fde (fde, nframe->get_pc(), frame, nframe, false);
+            return;
+        }
+    }
+
+    /* no luck, fall back on frame pointer */
+    arch->guess_frame (this, frame, nframe);
+}
+
+// The pcs of the frames of every thread, innermost first, as far as n
+// frames (all of them if n is negative).  The threads are not switched
+// to: the current thread's frames are kept, and the others are unwound
+// in turn from their registers and deleted.  The unwind rows found for
+// one thread are used for the rest, and the memory read is cached a page
+// at a time for the whole pass, as the threads share their code and the
+// stacks would otherwise be read a word at a time.
+void Process::get_thread_stacks(int n, std::vector<std::vector<Address> > &stacks) {
+    if (state == IDLE || state == EXITED) {
+       throw Exception ("The program is not being run") ;
+    }
+    stacks.clear() ;
+    stacks.resize (threads.size()) ;
+
+    ThreadList::iterator current = current_thread ;
+    int cur = get_current_thread() ;
+    for (int i = 0 ; (n < 0 || i < n) && has_frame (i) ; i++) {
+        stacks[cur].push_back (frame_cache[i]->get_pc()) ;
+    }
+
+    // the stale frames are the current thread's; keep them from the
+    // other threads' unwinding, which would try to reuse them
+    FrameVec saved ;
+    FrameVec saved_stale ;
+    saved.swap (frame_cache) ;
+    saved_stale.swap (stale_frames) ;
+    bool saved_complete = frames_complete ;
+    bool saved_corrupted = frame_corrupted ;
+    int saved_frame = current_frame ;
+    caching_pages = true ;
+
+    int t = 0 ;
+    for (ThreadList::iterator thr = threads.begin() ; thr != threads.end() ; thr++, t++) {
+        if (thr == current) {
+            continue ;
+        }
+        current_thread = thr ;
+        frames_complete = false ;
+        frame_corrupted = false ;
+        try {
+            (*thr)->syncin() ;
+            Frame *frame = new Frame (this, arch, 0) ;
+            frame->get_regs()->take_values_from ((*thr)->get_frame_reg()) ;
+            frame_cache.push_back (frame) ;
+            while ((n < 0 || (int)frame_cache.size() < n) && unwind_frame()) {
+            }
+            for (uint i = 0 ; i < frame_cache.size() && (n < 0 || (int)i < n) ; i++) {
+                stacks[t].push_back (frame_cache[i]->get_pc()) ;
+            }
+        } catch (Exception e) {
+            // a thread we can't read shows no frames
+        }
+        for (uint i = 0 ; i < frame_cache.size() ; i++) {
+            delete frame_cache[i] ;
+        }
+        frame_cache.clear() ;
+    }
+
+    caching_pages = false ;
+    pages.clear() ;
+    current_thread = current ;
+    frame_cache.swap (saved) ;
+    stale_frames.swap (saved_stale) ;
+    frame_cache_valid = true ;
+    frames_complete = saved_complete ;
+    frame_corrupted = saved_corrupted ;
+    current_frame = saved_frame ;
+}
+
+bool Process::has_frame(int n) {
+    build_frame_cache();
+    if (n < 0) {
+        return false;
+    }
+    while ((int) frame_cache.size() <= n && unwind_frame()) {
+    }
+    return n < (int) frame_cache.size();
 }
 
 
@@ -3009,6 +3304,12 @@ void Process::execute_fde(FDE * fde, Address pc, Frame * from, Frame *to, bool d
         ra = cie->get_ra() ;
     }
 
+    const Rule *rules = debug ? NULL : unwind_cache.find (pc) ;
+    if (rules != NULL) {
+        CFATable::apply (arch, this, rules, from, to) ;
+        return ;
+    }
+
     CFATable table (arch, this, fde->get_start_address(), ra) ;
 
     //std::cout << "executing FDE" << '\n' ;
@@ -3023,6 +3324,10 @@ void Process::execute_fde(FDE * fde, Address pc, Frame * from, Frame *to, bool d
     if (debug) {
         table.print() ;
     }
+
+    Address rowstart, rowend ;
+    table.get_row (pc, fde->get_end_address(), rowstart, rowend) ;
+    unwind_cache.add (rowstart, rowend, table.get_rules(), table.get_num_rules()) ;
     table.apply (from, to) ;
 }
 
@@ -3060,9 +3365,25 @@ Frame *Process::get_current_frame() {
     return frame_cache[current_frame] ;
 }
 
+// the canonical frame address of the current frame is the stack pointer
+// of its caller, so unwind it by one frame
+Address Process::get_cfa() {
+    Frame *frame = get_current_frame() ;
+    if (frame->is_stale()) {
+        refresh_frames (current_frame) ;
+    }
+    Frame caller (this, arch, current_frame + 1) ;
+    FDE *fde = find_fde (frame->get_pc()) ;
+    if (fde != NULL) {
+        execute_fde (fde, frame->get_pc(), frame, &caller, false) ;
+    } else {
+        arch->guess_frame (this, frame, &caller) ;
+    }
+    return caller.get_sp() ;
+}
+
 void Process::set_frame(int frameno) {
-    build_frame_cache() ;
-    if (frameno < 0 || (uint) frameno >= frame_cache.size()) {
+    if (!has_frame (frameno)) {
        os.print ("Frame number is out of range.\n") ;
        return ;
     }
@@ -3108,12 +3429,12 @@ void Process::up(int n) {
     // if we are asked to go up by more than one frame, limit it to take us to the
     // top
     if (n > 1) {
-        if (uint(current_frame + n) >= frame_cache.size()) {
+        if (!has_frame (current_frame + n)) {
             n = frame_cache.size() - current_frame - 1 ;
         }
         set_frame (current_frame + n) ;
     } else {
-        if (current_frame == (int) frame_cache.size() - 1) {
+        if (!has_frame (current_frame + 1)) {
            os.print ("Initial frame selected; you cannot go up.\n") ;
         } else {
             set_frame (current_frame + 1) ;
@@ -3145,20 +3466,94 @@ void Process::dump(Address addr, int size) {
 }
 
 std::string Process::read_string(Address addr) {
+    for (int i = snapshots.size() - 1 ; i >= 0 ; i--) {
+        Snapshot &snap = snapshots[i] ;
+        Address end = snap.addr + snap.data.size() ;
+        if (addr >= snap.addr && addr < end) {
+            const char *p = &snap.data[addr - snap.addr] ;
+            const char *nul = (const char *)memchr (p, 0, end - addr) ;
+            if (nul != NULL) {
+                return std::string (p, nul - p) ;
+            }
+            break ;
+        }
+    }
     return target->read_string ((*current_thread)->get_pid(), addr) ;
 }
 
 std::string Process::read_string(Address addr, int len) {
+    const char *p = find_snapshot (addr, len) ;
+    if (p != NULL) {
+        return std::string (p, len) ;
+    }
     return target->read_string ((*current_thread)->get_pid(), addr, len) ;
 }
 
-LinkMap * Process::find_link_map(Address addr) {
-   for (uint map = 0 ; map < linkmaps.size(); map++) {
-       if (linkmaps[map]->get_addr() == addr) {
-            return linkmaps[map] ;
-       }
-   }
-   return NULL ;
+// The libraries that have been unloaded are no longer in the chain.
+// Their object files are kept as there may still be pointers into
+// their symbol tables, but addresses no longer map to them.  The chain
+// is only walked if the dynamic linker has said it is removing a
+// library; otherwise it has only appended to it (see get_new_link_map).
+void Process::unload_link_maps() {
+    if (!link_maps_deleted) {
+        return ;
+    }
+    link_maps_deleted = false ;
+    int ps = arch->ptrsize() ;
+    std::set<Address> chain ;
+    Address linkmap = readptr (r_debug+ps) ;
+    while (linkmap != 0) {
+        chain.insert (linkmap) ;
+        linkmap = readptr (linkmap+ps+ps+ps) ;
+    }
+
+    LinkMapVec kept ;
+    for (uint map = 0 ; map < linkmaps.size(); map++) {
+        LinkMap *lm = linkmaps[map] ;
+        if (chain.count (lm->get_addr()) != 0) {
+            kept.push_back (lm) ;
+            continue ;
+        }
+        for (uint i = 1 ; i < objectfiles.size() ; i++) {
+            ObjectFile *file = objectfiles[i] ;
+            if (file->name == lm->get_name() && file->elf->get_base() == lm->get_base()) {
+                remove_object_ranges (file) ;
+            }
+        }
+        delete lm ;
+    }
+    linkmaps.swap (kept) ;
+}
+
+// the loadable segments of an object file, at their load addresses
+void Process::add_object_ranges(ObjectFile *file) {
+    ELF *elf = file->elf ;
+    for (int i = 0 ; i < elf->get_num_segments() ; i++) {
+        ProgramSegment *seg = elf->get_segment (i) ;
+        if (seg->get_type() == PT_LOAD && seg->get_size() > 0) {
+            object_ranges.add (seg->get_start(), seg->get_start() + seg->get_size() - 1, file) ;
+        }
+    }
+}
+
+void Process::remove_object_ranges(ObjectFile *file) {
+    ELF *elf = file->elf ;
+    for (int i = 0 ; i < elf->get_num_segments() ; i++) {
+        ProgramSegment *seg = elf->get_segment (i) ;
+        ObjectFile *f ;
+        if (seg->get_type() == PT_LOAD && !object_ranges.get (seg->get_start(), &f) && f == file) {
+            object_ranges.remove (seg->get_start()) ;
+            unwind_cache.remove (seg->get_start(), seg->get_start() + seg->get_size()) ;
+        }
+    }
+}
+
+ObjectFile *Process::find_object_file(Address addr) {
+    ObjectFile *file ;
+    if (object_ranges.get (addr, &file)) {
+        return NULL ;
+    }
+    return file ;
 }
 
 void Process::load_link_map(Address addr) {
@@ -3174,20 +3569,18 @@ void Process::load_link_map(Address addr) {
     }
 }
 
+// The maps are kept in chain order and new libraries are added at the
+// end of the chain, so the next new one follows the last map we have.
 LinkMap * Process::get_new_link_map() {
     int ps = arch->ptrsize() ;
-    Address linkmap = readptr (r_debug+ps) ;
-    while (linkmap != 0) {
-        LinkMap * map = find_link_map (linkmap) ;
-        if (map == NULL) {
-            LinkMap * lm = new LinkMap (arch, this, linkmap) ;
-            linkmaps.push_back (lm) ;
-            //lm->print() ;
-            return lm ;
-        }
-        linkmap = readptr (linkmap+ps+ps+ps) ;
+    Address linkmap = linkmaps.empty() ? readptr (r_debug+ps) : readptr (linkmaps.back()->get_addr()+ps+ps+ps) ;
+    if (linkmap == 0) {
+        return NULL ;
     }
-    return NULL ;
+    LinkMap * lm = new LinkMap (arch, this, linkmap) ;
+    linkmaps.push_back (lm) ;
+    //lm->print() ;
+    return lm ;
 }
 
 Address Process::get_r_debug_state() {
@@ -3472,12 +3865,55 @@ bool Process::test_address(Address addr) {
     if (threads.size() == 0) {
         return false ;
     }
+    Address tmp ;
+    if (find_snapshot (addr, 1) != NULL || (caching_pages && read_cached (addr, 1, tmp))) {
+        return true ;
+    }
     return target->test_address ((*current_thread)->get_pid(), addr) ;
 }
 
+// the value of size bytes of memory, in the target's byte order
+static Address memory_value (Architecture *arch, const char *p, int size) {
+    Address v = 0 ;
+    for (int i = 0 ; i < size ; i++) {
+        v = (v << 8) | (unsigned char)p[arch->is_little_endian() ? size - 1 - i : i] ;
+    }
+    return v ;
+}
+
+// read memory from the page cache, reading the whole page from the target
+// the first time.  False if the target can't read it in one go, or the
+// read crosses a page
+bool Process::read_cached(Address addr, int size, Address &value) {
+    const Address pagesize = 4096 ;
+    Address page = addr & ~(pagesize - 1) ;
+    if (addr + size > page + pagesize) {
+        return false ;
+    }
+    PageMap::iterator i = pages.find (page) ;
+    if (i == pages.end()) {
+        i = pages.insert (std::make_pair (page, std::vector<char>(pagesize))).first ;
+        if (!target->read_block ((*current_thread)->get_pid(), page, &i->second[0], pagesize)) {
+            i->second.clear() ;
+        }
+    }
+    if (i->second.empty()) {
+        return false ;
+    }
+    value = memory_value (arch, &i->second[addr - page], size) ;
+    return true ;
+}
+
 // read memory and replace any breakpoints
 Address Process::read(Address addr, int size) {
-    Address tmp = target->read ((*current_thread)->get_pid(), addr, size) ;
+    Address tmp = 0 ;
+    const char *p = size <= (int)sizeof(tmp) ? find_snapshot (addr, size) : NULL ;
+    if (p != NULL) {
+        return memory_value (arch, p, size) ;
+    }
+    if (!caching_pages || !read_cached (addr, size, tmp)) {
+        tmp = target->read ((*current_thread)->get_pid(), addr, size) ;
+    }
     for (BreakpointList::reverse_iterator i = breakpoints.rbegin(); i != breakpoints.rend(); i++) {
         Breakpoint *bp = *i ;
 
@@ -3495,12 +3931,98 @@ Address Process::read(Address addr, int size) {
     return tmp ;
 }
 
+// read a block of memory in one go and replace any breakpoints.  False if
+// the target can't read it that way or any of it is unreadable
+bool Process::read_block(Address addr, char *buf, int len) {
+    const char *p = find_snapshot (addr, len) ;
+    if (p != NULL) {
+        memcpy (buf, p, len) ;
+        return true ;
+    }
+    if (threads.size() == 0 || !target->read_block ((*current_thread)->get_pid(), addr, buf, len)) {
+        return false ;
+    }
+    for (BreakpointList::reverse_iterator i = breakpoints.rbegin(); i != breakpoints.rend(); i++) {
+        Breakpoint *bp = *i ;
+
+        if ( !bp->is_software() ) continue;
+
+        Address bpaddr = bp->get_address() ;
+        if (bpaddr >= addr && bpaddr < addr + len) {
+            SoftwareBreakpoint *abp = dynamic_cast<SoftwareBreakpoint*>(bp) ;
+            int oldvalue = abp->get_old_value() ;
+            int n = arch->bpsize() ;
+            if (n > addr + len - bpaddr) {
+                n = addr + len - bpaddr ;
+            }
+            for (int j = 0 ; j < n ; j++) {
+                int shift = arch->is_little_endian() ? j : arch->bpsize() - 1 - j ;
+                buf[bpaddr - addr + j] = oldvalue >> (shift * 8) ;
+            }
+        }
+    }
+    return true ;
+}
+
+// Read a block of memory so that reads inside it while a value is printed
+// don't go to the target.  False if it is already read, or can't be read
+// in one go; the caller pops it only if this returns true
+bool Process::push_snapshot(Address addr, int len) {
+    const int MAX_SNAPSHOT = 65536 ;
+    if (len <= 0 || len > MAX_SNAPSHOT || find_snapshot (addr, len) != NULL) {
+        return false ;
+    }
+    Snapshot snap ;
+    snap.addr = addr ;
+    snap.data.resize (len) ;
+    if (!read_block (addr, &snap.data[0], len)) {
+        return false ;
+    }
+    snapshots.push_back (snap) ;
+    return true ;
+}
+
+void Process::pop_snapshot() {
+    snapshots.pop_back() ;
+}
+
+// the snapshot bytes for a read, or NULL if no snapshot holds all of it
+const char *Process::find_snapshot(Address addr, int len) {
+    for (int i = snapshots.size() - 1 ; i >= 0 ; i--) {
+        Snapshot &snap = snapshots[i] ;
+        if (!snap.data.empty() && addr >= snap.addr
+            && addr + len <= snap.addr + (Address)snap.data.size()) {
+            return &snap.data[addr - snap.addr] ;
+        }
+    }
+    return NULL ;
+}
+
+// a write to memory makes any snapshot of it out of date
+void Process::forget_snapshots(Address addr, int len) {
+    for (uint i = 0 ; i < snapshots.size() ; i++) {
+        Snapshot &snap = snapshots[i] ;
+        if (addr < snap.addr + (Address)snap.data.size() && addr + len > snap.addr) {
+            snap.data.clear() ;
+        }
+    }
+}
+
 // read memory directly from target
 Address Process::raw_read(Address addr, int size) {
     return target->read ((*current_thread)->get_pid(), addr, size) ;
 }
 
 Address Process::readptr(Address addr) {
+    Address tmp = 0 ;
+    const char *p = find_snapshot (addr, arch->ptrsize()) ;
+    if (p != NULL) {
+        memcpy (&tmp, p, arch->ptrsize()) ;
+        return arch->ptrsize() == 4 ? (int32_t)tmp : tmp ;
+    }
+    if (caching_pages && read_cached (addr, arch->ptrsize(), tmp)) {
+        return arch->ptrsize() == 4 ? (int32_t)tmp : tmp ;
+    }
     return target->readptr ((*current_thread)->get_pid(), addr) ;
 }
 
@@ -3601,7 +4123,8 @@ bool Process::cont(int sig) {
 }
 
 bool Process::docont() {
-    invalidate_frame_cache() ;                       // frame cache is not valid until we stop
+    // frame cache is not valid until we stop; a step may continue to a breakpoint
+    invalidate_frame_cache(finishing || state == STEPPING || state == CSTEPPING || state == ISTEPPING) ;
 
     //println ("continuing")
     if (hitbp != NULL && !hitbp->is_sw_watchpoint()) {
@@ -3654,7 +4177,7 @@ bool Process::docont() {
 }
 
 void Process::single_step() {
-    invalidate_frame_cache() ;                       // frame cache is not valid until we stop
+    invalidate_frame_cache(true) ;                   // frame cache is not valid until we stop
     stepped_onto_breakpoint = false ;
 
     //printf ("single step\n") ;
@@ -3841,9 +4364,8 @@ bool Process::jump(Address addr) {
 }
 
 Address Process::get_return_addr() {  
-    build_frame_cache() ;
     Address addr = 0 ;
-    if (frame_cache_valid && frame_cache.size() > 1) {
+    if (has_frame (1)) {
         Frame *frame = frame_cache[1] ;         // frame just above current
         addr = frame->get_reg (arch->translate_regname("pc")) ;
     } else {            // no valid frame cache, lets try to get it the hard way
@@ -4612,8 +5134,7 @@ Catchpoint *Process::new_catchpoint (CatchpointType type, std::string data) {
     return bp ;
 }
 
-// because we print the values of the function arguments in the stack trace, we need
-// to unwind the stack fully on a trace
+// a trace of n frames unwinds only as far as the last of them
 
 void Process::stacktrace(int n) {
     build_frame_cache() ;
@@ -4623,18 +5144,13 @@ void Process::stacktrace(int n) {
 
     if (n > 0) {
        first = current_frame;
-       unsigned x_last = current_frame+n;
-       if (x_last > frame_cache.size()) {
-          last = frame_cache.size();
-       } else {
-          last = x_last;
-       }
+       last = current_frame+n;
     } else {
        first = 0;
-       last = frame_cache.size();
+       last = get_frame_size();
     }
 
-    for (unsigned i = first ; i < last; i++) {
+    for (unsigned i = first ; i < last && has_frame (i); i++) {
         frame_cache[i]->print(os, !gdbmode, i == (uint) current_frame) ;
     }
 
@@ -4644,9 +5160,7 @@ void Process::stacktrace(int n) {
 }
 
 bool Process::stack_contains(Address fp, Address start_pc, Address end_pc) {
-    build_frame_cache();
-
-    for (unsigned i = 0; i < frame_cache.size(); i++) {
+    for (int i = 0; has_frame (i); i++) {
         Frame* frame = frame_cache[i];
         Address f_fp = frame->get_fp();
         Address f_pc = frame->get_pc();
@@ -4756,7 +5270,7 @@ void Display::execute (Process *proc) {
     if (local) {
         Location l = proc->get_current_location() ;
         if (l.get_funcloc() != NULL && loc.get_funcloc() != NULL) {
-            if (l.get_funcloc()->symbol->die != loc.get_funcloc()->symbol->die) {
+            if (l.get_funcloc()->symbol->get_die() != loc.get_funcloc()->symbol->get_die()) {
                 return ;
             }
         }
@@ -5116,8 +5630,7 @@ void Process::search (std::string text) {
 #endif
 
 void Process::return_from_func(Address value) {              // return from function with value
-    build_frame_cache() ;
-    if (frame_cache.size() > 1) {
+    if (has_frame (current_frame + 1)) {
         Frame *frame = frame_cache[current_frame] ;
         Location loc = frame->get_loc() ;
         char buf[1024] ;
@@ -5147,8 +5660,7 @@ void Process::return_from_func(Address value) {              // return from func
 }
                                                                                                                                   
 void Process::finish() {                                     // finish execution of current function
-    build_frame_cache() ;
-    if (frame_cache.size() < 2) {
+    if (!has_frame (current_frame + 1)) {
         throw Exception ("\"finish\" not meaningful in the outermost frame.") ;
     }
 
@@ -5166,7 +5678,14 @@ void Process::finish() {                                     // finish execution
     // set a breakpoint at the return address and continue to it
     Address ra = nextframe->get_pc() ;                 // return address
     new_breakpoint (BP_TEMP, "", ra) ;                      // new temporary breakpoint
-    cont() ;                                            // continue execution
+    finishing = true ;                                  // the callers' frames can be used again
+    try {
+        cont() ;                                        // continue execution
+    } catch (...) {
+        finishing = false ;
+        throw ;
+    }
+    finishing = false ;
     wait() ;                                            // wait for it to stop
 
     // now show the value returned and record it (if not void)
@@ -5272,7 +5791,7 @@ void Process::get_current_subprogram(DIE *&die, int &language) {
     } else {
         Location &loc = frame_cache[current_frame]->get_loc() ;
         if (loc.has_debug_info()) {
-            die = loc.get_funcloc()->symbol->die ; // subprogram die
+            die = loc.get_funcloc()->symbol->get_die() ; // subprogram die
             die->check_loaded() ;
             symtab = loc.get_symtab();
             if (autolang) {
@@ -5353,7 +5872,7 @@ void Process::info (std::string root, std::string tail) {
         } else {
             Location &loc = frame_cache[current_frame]->get_loc() ;
             if (loc.get_funcloc() != NULL) {
-                die = loc.get_funcloc()->symbol->die ; // subprogram die
+                die = loc.get_funcloc()->symbol->get_die() ; // subprogram die
                 die->check_loaded() ;
                 symtab = loc.get_symtab();
                 if (autolang) {
@@ -5377,7 +5896,7 @@ void Process::info (std::string root, std::string tail) {
         }
         os.print ("\nNon-debugging symbols:\n") ;
         for (uint i = 0 ; i < objectfiles.size() ; i++) {
-            if (objectfiles[i]->elf->find_section (".debug_info") == NULL) {
+            if (objectfiles[i]->symtab == NULL || !objectfiles[i]->symtab->has_debug_info()) {
                 objectfiles[i]->elf->list_functions (os) ;
             }
         }
@@ -5424,6 +5943,32 @@ void Process::info (std::string root, std::string tail) {
             cu->info (os); 
         }
     } else if (root == "sharedlibrary") {
+        if (objectfiles.size() <= 1) {
+            os.print ("No shared libraries loaded at this time.\n") ;
+        } else {
+            os.print ("From                To                  Syms Read   Shared Object Library\n") ;
+            for (uint i = 1 ; i < objectfiles.size() ; i++) {
+                ObjectFile *file = objectfiles[i] ;
+                Address from = 0, to = 0 ;
+                Section *text = file->elf->find_section (".text") ;
+                if (text != NULL) {
+                    from = text->get_addr() + file->elf->get_base() ;
+                    to = from + text->get_size() ;
+                }
+                char status[16] ;
+                if (file->symtab == NULL) {
+                    strcpy (status, "No") ;
+                } else if (file->symtab->is_deferred()) {
+                    strcpy (status, "Deferred") ;
+                } else if (file->symtab->is_ready()) {
+                    strcpy (status, "Yes") ;
+                } else {
+                    snprintf (status, sizeof (status), "%d%%", file->symtab->get_progress()) ;
+                }
+                os.print ("0x%016llx  0x%016llx  %-11s %s\n", (unsigned long long)from, (unsigned long long)to,
+                          status, file->name.c_str()) ;
+            }
+        }
     } else if (root == "sources") {
         os.print ("Source files for which symbols have been read in:\n\n") ;
         // all files are read on demand
@@ -5457,7 +6002,7 @@ void Process::info (std::string root, std::string tail) {
         } else {
             Location &loc = frame_cache[current_frame]->get_loc() ;
             if (loc.get_funcloc() != NULL) {
-                die = loc.get_funcloc()->symbol->die ; // subprogram die
+                die = loc.get_funcloc()->symbol->get_die() ; // subprogram die
                 die->check_loaded() ;
                 symtab = loc.get_symtab();
                 if (autolang) {
@@ -5481,7 +6026,7 @@ void Process::info (std::string root, std::string tail) {
         }
         os.print ("\nNon-debugging symbols:\n") ;
         for (uint i = 0 ; i < objectfiles.size() ; i++) {
-            if (objectfiles[i]->elf->find_section (".debug_info") == NULL) {
+            if (objectfiles[i]->symtab == NULL || !objectfiles[i]->symtab->has_debug_info()) {
                 objectfiles[i]->elf->list_variables (os) ;
             }
         }
@@ -5745,7 +6290,7 @@ void Process::print_loc(const Location& loc, Frame *frame, PStream &os, bool sho
            os.print ("%s ", funcname.c_str()) ;
         }
         if (loc.get_funcloc() != NULL) {
-           print_function_paras (frame, loc.get_funcloc()->symbol->die) ;
+           print_function_paras (frame, loc.get_funcloc()->symbol->get_die()) ;
         }
 
         os.print (" at %s", loc.get_file()->name.c_str());
@@ -5799,7 +6344,9 @@ Address Process::get_frame_pc (int tid, int fid)
 			switch_thread_1(tid);
 		}
 
-		build_frame_cache() ;
+		if (!has_frame (fid)) {
+			throw Exception ("No such frame");
+		}
 		ret = frame_cache[fid]->get_pc();
 	} catch (...) {
 		get_error = 1;
@@ -5818,6 +6365,8 @@ Address Process::get_frame_pc (int tid, int fid)
 int Process::get_frame_size ()
 {
 	build_frame_cache() ;
+	while (unwind_frame()) {
+	}
 
 	return frame_cache.size();
 }
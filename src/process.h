@@ -41,6 +41,7 @@ author: David Allison <dallison@pathscale.com>
 #include "pcm.h"
 #include "dis.h"
 #include "register_set.h"
+#include "map_range.h"
 
 // imported classes
 class ProcessController ;
@@ -107,6 +108,8 @@ public:
 	void set_fp(Address addr);
 	void set_n (int i) { n = i; }
 	RegisterSet *get_regs() { return regs; }
+	void set_stale (bool s) { stale = s; }
+	bool is_stale() { return stale; }
 
 protected:
 	void init(Process *proc, Architecture *arch, int n);
@@ -115,15 +118,17 @@ protected:
 	Architecture *arch;
 	int n;
 	Location loc;
+	bool loc_valid;                 // loc has been looked up
 	Address return_addr;
 	bool valid;
 	RegisterSet *regs;
 	RegisterSet *fp_regs;
+	bool stale;                     // reused from before a step; only pc, sp and fp are right
 } ;
 
 class Rule {
 public:
-    Rule(CFARuleType type, int reg, int offset) ;
+    Rule(CFARuleType type = CFA_UNDEFINED, int reg = 0, int offset = 0) ;
     ~Rule() ; 
     std::string toString () ;
     CFARuleType type ; 
@@ -150,19 +155,55 @@ public:
 
     void save() ;
     void restore (int reg) ;
+
+    // the rules are the CFA's, the return address's and then each register's
+    const Rule *get_rules() { return &rules[0] ; }
+    int get_num_rules() { return rules.size() ; }
+    static void apply (Architecture *arch, Process *proc, const Rule *rules, Frame *from, Frame *to) ;
+
+    // the PCs that have the same rules as pc once the instructions for pc
+    // have been run; end is the end of the FDE
+    void get_row (Address pc, Address end, Address &rowstart, Address &rowend) ;
 protected:
 private:
+    enum {
+        CFA_RULE, RA_RULE, FIRST_REG
+    } ;
+
     Architecture *arch ;
     Process *proc ;
     Address loc ; 
+    Address start ;             // of the FDE
+    Address last_loc ;          // before the last advance
+    bool backwards ;            // a DW_CFA_set_loc went back
     int ra_reg ; 
-    Rule *cfa ; 
-    Rule **regs ; 
-    Rule * ra ; 
+    std::vector<Rule> rules ;
 
     // for DW_CFA_restore
-    Rule **saved_regs ;
-    Rule *saved_ra ;
+    std::vector<Rule> saved_rules ;
+} ;
+
+// The unwind rows already worked out, each for the range of PCs it
+// covers, so that a frame at a PC in one doesn't run the CFA
+// instructions again.  The rules of the rows are kept one after another
+// in a pool.  The rows of a library are dropped when it is unloaded.
+class UnwindCache {
+public:
+    UnwindCache() : nrules(0) {}
+    const Rule *find (Address pc) ;                     // NULL if no row has pc
+    void add (Address start, Address end, const Rule *rules, int n) ;
+    void remove (Address start, Address end) ;          // rows starting in start..end-1
+private:
+    struct Row {
+        Row (Address end, int first) : end(end), first(first) {}
+        Address end ;                   // first PC after the row
+        int first ;                     // rule in the pool
+    } ;
+    typedef std::map<Address, Row> RowMap ;
+
+    RowMap rows ;                       // start PC vs row
+    std::vector<Rule> pool ;
+    int nrules ;                        // in a row
 } ;
 
 class LinkMap {
@@ -276,6 +317,7 @@ class Process {
     typedef std::map<Address, BreakpointList*> BreakpointMap ;
     typedef std::vector<Frame*> FrameVec ;
     typedef std::vector<ObjectFile *> ObjectFileVec ;
+    typedef Map_Range<Address, ObjectFile *> ObjectFileMap ;
     typedef std::vector<LinkMap *> LinkMapVec ;
     typedef std::list<Display*> DisplayList ;
 
@@ -292,6 +334,9 @@ public :
     RegisterSet *get_frame_reg();
     int get_frame () {build_frame_cache(); return current_frame;}
     int get_frame_size ();
+    bool has_frame (int n) ;            // unwinds the stack as far as frame n
+    void refresh_frames (int n) ;       // the registers of stale frames up to n
+    void get_thread_stacks (int n, std::vector<std::vector<Address> > &stacks) ;
 
     File *find_file(std::string name);
     DIE *new_int_type ();
@@ -399,16 +444,21 @@ public :
     void down (int n) ;
     void dump (Address addr, int size) ;
     Frame *get_current_frame() ;
+    Address get_cfa() ;                         // of the current frame
 
 
     LinkMap * get_new_link_map () ;
+    void unload_link_maps () ;                  // drop the maps of unloaded libraries
+    void delete_link_maps () { link_maps_deleted = true ; }     // at an RT_DELETE event
     Address get_r_debug_state () ;
 
     /* read and write just passes control to target */
     void write (Address addr, long data, int size=4) {
+        forget_snapshots (addr, size) ;
         target->write((*current_thread)->get_pid(), addr, data, size);
     }
     void write_string (Address addr, std::string s) {
+        forget_snapshots (addr, s.size()) ;
         target->write_string((*current_thread)->get_pid(), addr, s);
     } 
     /* XXX: have target hold pid so we can drop get_pid crap */
@@ -431,6 +481,9 @@ public :
     bool test_address (Address addr) ;
     Address read (Address addr, int size);
     Address raw_read (Address addr, int size) ;
+    bool read_block (Address addr, char *buf, int len) ;
+    bool push_snapshot (Address addr, int len) ;
+    void pop_snapshot () ;
     Address readptr (Address addr) ;
     Address readelfxword (ELF * elf, Address addr) ;
     bool docont () ;
@@ -523,14 +576,20 @@ private:
     void sync_threads () ;
     void apply_breakpoints () ;
     void sync () ;
-    void invalidate_frame_cache () ;
+    void invalidate_frame_cache (bool keep = false) ;
+    void delete_stale_frames () ;
+    void reuse_stale_frames () ;
     void build_frame_cache () ;
+    bool unwind_frame () ;              // add the next frame up to the frame cache
+    void unwind_regs (Frame *frame, Frame *nframe) ;
     void execute_fde (FDE * fde, Address pc, Frame * from, Frame *to, bool debug) ;
     Address get_fde_return_address (FDE * fde, Address pc, Frame * frame) ;
     void execute_cfa (Architecture *arch, CFATable *table, BVector code, Address pc,
         int caf, int daf, int ra, bool debug);
-    LinkMap * find_link_map (Address addr) ;
     void load_link_map (Address addr) ;
+    void add_object_ranges (ObjectFile *file) ;
+    void remove_object_ranges (ObjectFile *file) ;
+    ObjectFile *find_object_file (Address addr) ;       // the file loaded at addr, or NULL
     void step_from_breakpoint (Breakpoint * bp) ; // single step one instruction from breakpoint
     bool step_one_instruction () ;                // single step one instruction
     ProcessController * pcm ; 
@@ -568,19 +627,47 @@ private:
     Breakpoint * hitbp ; // the breakpoint that we hit
     bool stepped_onto_breakpoint ;
     Address r_debug ; // address of struct r_debug for debuggee
+    bool link_maps_deleted ;    // a library was removed from the chain since it was consistent
     bool stepping_lines ; 
     bool stepping_over ; 
     Address main ; // address of main
     FrameVec frame_cache ; // vector of locations when stopped
+    UnwindCache unwind_cache ;
     bool frame_cache_valid ; 
     bool frame_corrupted;
+    bool frames_complete ;              // there are no more frames to unwind
+
+    // the frames from before the process was stepped
+    FrameVec stale_frames ;
+    int stale_pid ;                     // of the thread the stale frames are from
+    bool stale_complete ;
+    bool stale_corrupted ;
+    bool finishing ;                    // continuing to the return address; the frames are kept
     int current_frame ; 
+
+    // memory read a page at a time while the threads' stacks are unwound
+    typedef std::map<Address, std::vector<char> > PageMap ;
+    PageMap pages ;
+    bool caching_pages ;
+    bool read_cached (Address addr, int size, Address &value) ;
+
+    // blocks of memory read in one go while a value is printed.  Reads
+    // that fall inside one are served from it
+    struct Snapshot {
+        Address addr ;
+        std::vector<char> data ;
+    } ;
+    std::vector<Snapshot> snapshots ;
+    const char *find_snapshot (Address addr, int len) ;
+    void forget_snapshots (Address addr, int len) ;
+
     Address plt_start ; // start of the PLT
     Address plt_end ; // end of the PLT
     Address fixup_addr ; // address of 'fixup'
     Address dyn_start ; // start of dynamic linker .text section
     Address dyn_end ; // end of dynamic linker .text section
     ObjectFileVec objectfiles ; // vector of LoadedFile
+    ObjectFileMap object_ranges ;       // loaded segments vs object file
     LinkMapVec linkmaps ; 
     PStream &os ;                        // output stream
     int current_signal ;                // current signal to send to process
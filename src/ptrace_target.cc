@@ -395,6 +395,10 @@ Address PtraceTarget::read(int pid, Address addr, int size) {
     return val;
 }
 
+bool PtraceTarget::read_block (int pid, Address addr, char *buf, int len) {
+    return Trace::read_block (pid, (void*)addr, buf, len) == 0 ;
+}
+
 Address PtraceTarget::readptr (int pid, Address addr) {
 	if (arch->ptrsize() == 8) {
 		return read(pid, addr, arch->ptrsize());
@@ -23,6 +23,7 @@ public:
     bool test_address (int pid, Address addr) ;                  // check if address is good
     Address read (int pid, Address addr, int size=4) ;           // read a number of words
     Address readptr (int pid, Address addr)  ;
+    bool read_block (int pid, Address addr, char *buf, int len) ;
     void write (int pid, Address addr, Address data, int size) ;    // write a word
     virtual void get_regs(int pid, RegisterSet *regs);               // get register set
     virtual void set_regs(int pid, RegisterSet *regs);               // set register set
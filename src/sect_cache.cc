@@ -0,0 +1,241 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: sect_cache.cc
+
+*/
+
+#include "sect_cache.h"
+#include "dbg_elf.h"
+#include "dbg_except.h"
+#include "symcache.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+
+SectionCache section_cache;
+
+static const size_t DEFAULT_LIMIT = 256 * 1024 * 1024;
+
+SectionCache::SectionCache()
+  : resident(0), limit(DEFAULT_LIMIT), spilling(true) {
+   pthread_mutex_init(&mutex, NULL);
+}
+
+SectionCache::~SectionCache() {
+   for (EntryList::iterator i = entries.begin(); i != entries.end(); i++) {
+      munmap(i->data, i->length);
+   }
+   pthread_mutex_destroy(&mutex);
+}
+
+void
+SectionCache::set_limit(size_t bytes, bool spill) {
+   pthread_mutex_lock(&mutex);
+   limit = bytes;
+   spilling = spill;
+   trim();
+   pthread_mutex_unlock(&mutex);
+}
+
+/* FNV-1a */
+static uint64_t
+hash_bytes(uint64_t h, const void *data, size_t len) {
+   const unsigned char *p = (const unsigned char *)data;
+   for (size_t i = 0; i < len; i++) {
+      h ^= p[i];
+      h *= 1099511628211ULL;
+   }
+   return h;
+}
+
+/* The file a section is spilled to is named after the path, modification
+ * time and size of its ELF file and where the section is in it.  Returns
+ * "" if there is nowhere to put it.
+ */
+std::string
+SectionCache::spill_path(Section *section, uint64_t size) {
+   std::string dir = SymbolCache::get_dir(true);
+   std::string name = section->get_elf()->get_name();
+   struct stat st;
+   if (dir == "" || stat(name.c_str(), &st) != 0) {
+      return "";
+   }
+   uint64_t h = 14695981039346656037ULL;
+   h = hash_bytes(h, name.c_str(), name.size() + 1);
+   int64_t mtime = st.st_mtime;
+   int64_t fsize = st.st_size;
+   int64_t offset = section->get_offset();
+   h = hash_bytes(h, &mtime, sizeof(mtime));
+   h = hash_bytes(h, &fsize, sizeof(fsize));
+   h = hash_bytes(h, &offset, sizeof(offset));
+   h = hash_bytes(h, &size, sizeof(size));
+   char buf[32];
+   snprintf(buf, sizeof(buf), "z%016llx", (unsigned long long)h);
+   return dir + "/" + buf + ".sec";
+}
+
+/* map a spilled section; NULL if the file isn't there or is the wrong size */
+byte *
+SectionCache::map_spilled(const std::string &path, uint64_t size, size_t length) {
+   int fd = open(path.c_str(), O_RDONLY);
+   if (fd < 0) {
+      return NULL;
+   }
+   struct stat st;
+   void *map = MAP_FAILED;
+   if (fstat(fd, &st) == 0 && (uint64_t)st.st_size == size) {
+      map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+   }
+   close(fd);
+   return map == MAP_FAILED ? NULL : (byte *)map;
+}
+
+/* Write a section out and map the file over its memory.  The file is
+ * written under a temporary name and renamed so that another debugger
+ * never maps half of it.
+ */
+bool
+SectionCache::spill(Entry &entry) {
+   std::string path = spill_path(entry.section, entry.size);
+   if (path == "") {
+      return false;
+   }
+   char tmp[32];
+   snprintf(tmp, sizeof(tmp), ".%d", (int)getpid());
+   std::string tmppath = path + tmp;
+   int fd = open(tmppath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0) {
+      return false;
+   }
+   uint64_t done = 0;
+   while (done < entry.size) {
+      ssize_t n = write(fd, entry.data + done, entry.size - done);
+      if (n <= 0) {
+         break;
+      }
+      done += n;
+   }
+   void *map = MAP_FAILED;
+   if (done == entry.size && rename(tmppath.c_str(), path.c_str()) == 0) {
+      map = mmap(entry.data, entry.length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+   } else {
+      unlink(tmppath.c_str());
+   }
+   close(fd);
+   if (map == MAP_FAILED) {
+      return false;
+   }
+   entry.spilled = true;
+   return true;
+}
+
+/* Spill the least recently used sections until the rest fit.  The most
+ * recently used one is kept as it is about to be read.
+ */
+void
+SectionCache::trim() {
+   if (!spilling) {
+      return;
+   }
+   EntryList::iterator i = entries.end();
+   while (resident > limit && i != entries.begin()) {
+      i--;
+      if (i == entries.begin()) {
+         break;
+      }
+      if (!i->spilled && spill(*i)) {
+         resident -= i->length;
+      }
+   }
+}
+
+BVector
+SectionCache::get(Section *section, std::istream &stream) {
+   pthread_mutex_lock(&mutex);
+   EntryMap::iterator e = index.find(section);
+   if (e != index.end()) {
+      entries.splice(entries.begin(), entries, e->second);
+      Entry &entry = entries.front();
+      pthread_mutex_unlock(&mutex);
+      return BVector(entry.data, entry.size);
+   }
+
+   try {
+      uint64_t size = section->get_uncompressed_size(stream);
+      long pagesize = sysconf(_SC_PAGESIZE);
+      size_t length = (size + pagesize - 1) / pagesize * pagesize;
+      if (length == 0) {
+         length = pagesize;
+      }
+
+      std::string path = spilling ? spill_path(section, size) : "";
+      byte *data = path == "" ? NULL : map_spilled(path, size, length);
+      bool spilled = data != NULL;
+      if (data == NULL) {
+         void *map = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+         if (map == MAP_FAILED) {
+            throw Exception("Unable to allocate memory for section %s",
+                            section->get_name().c_str());
+         }
+         data = (byte *)map;
+         try {
+            section->decompress(stream, data, size);
+         } catch (...) {
+            munmap(data, length);
+            throw;
+         }
+         mprotect(data, length, PROT_READ);
+         resident += length;
+      }
+
+      entries.push_front(Entry(section, data, size, length));
+      entries.front().spilled = spilled;
+      index[section] = entries.begin();
+      trim();
+      pthread_mutex_unlock(&mutex);
+      return BVector(data, size);
+   } catch (...) {
+      pthread_mutex_unlock(&mutex);
+      throw;
+   }
+}
+
+void
+SectionCache::remove(Section *section) {
+   pthread_mutex_lock(&mutex);
+   EntryMap::iterator e = index.find(section);
+   if (e != index.end()) {
+      Entry &entry = *e->second;
+      if (!entry.spilled) {
+         resident -= entry.length;
+      }
+      munmap(entry.data, entry.length);
+      entries.erase(e->second);
+      index.erase(e);
+   }
+   pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,98 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: sect_cache.h
+
+*/
+
+#ifndef _SECT_CACHE_H_
+#define _SECT_CACHE_H_
+
+#include "bstream.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <list>
+#include <map>
+
+class Section;
+
+// The contents of compressed ELF sections (SHF_COMPRESSED, or the older
+// .zdebug_ sections), decompressed the first time they are asked for.
+// Each section is decompressed once into an anonymous mapping that the
+// readers of the section share (section_cache), and stays at the same
+// address until its ELF file is deleted.
+//
+// The mappings are kept in least recently used order.  When they hold
+// more than the limit, the oldest are written to files beside the
+// symbol cache and the files are mapped over them, so the kernel can
+// drop their pages and read them back when they are used.  A section
+// already written to the cache is mapped from it without decompressing
+// it.
+//
+// Readers keep pointers into the mappings, so a section that can't be
+// spilled (the symbol cache is off, or the file can't be written) stays
+// in memory over the limit.
+
+class SectionCache {
+public:
+   SectionCache();
+   ~SectionCache();
+
+   void set_limit(size_t bytes, bool spill);
+   BVector get(Section *section, std::istream &stream);   // throws Exception
+   void remove(Section *section);       // the section is being deleted
+
+private:
+   SectionCache(const SectionCache &);
+
+   struct Entry {
+      Entry(Section *section, byte *data, uint64_t size, size_t length)
+        : section(section), data(data), size(size), length(length), spilled(false) {}
+      Section *section;
+      byte *data;
+      uint64_t size;
+      size_t length;                    // of the mapping, a number of pages
+      bool spilled;                     // mapped from a file
+   };
+
+   typedef std::list<Entry> EntryList;
+   typedef std::map<Section *, EntryList::iterator> EntryMap;
+
+   std::string spill_path(Section *section, uint64_t size);
+   byte *map_spilled(const std::string &path, uint64_t size, size_t length);
+   bool spill(Entry &entry);
+   void trim();
+
+   pthread_mutex_t mutex;               // sections are read on background threads
+
+   EntryList entries;                   // most recently used first
+   EntryMap index;
+   size_t resident;                     // bytes in anonymous mappings
+   size_t limit;
+   bool spilling;
+};
+
+extern SectionCache section_cache;
+
+#endif
@@ -0,0 +1,141 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: str_pool.cc
+
+*/
+
+#include "str_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+StringPool string_pool;
+
+static const uint32_t INITIAL_SLOTS = 1024;
+static const size_t BLOCK_SIZE = 64 * 1024;
+
+StringPool::StringPool()
+  : nslots(INITIAL_SLOTS), count(0), next(NULL), left(0) {
+   pthread_mutex_init(&mutex, NULL);
+   slots = (Slot*)calloc(nslots, sizeof(Slot));
+}
+
+StringPool::~StringPool() {
+   for (unsigned int i = 0; i < blocks.size(); i++) {
+      free(blocks[i]);
+   }
+   free(slots);
+   pthread_mutex_destroy(&mutex);
+}
+
+/* FNV-1a */
+uint32_t
+StringPool::hash(const char* s, size_t len) {
+   uint32_t h = 2166136261u;
+   for (size_t i = 0; i < len; i++) {
+      h = (h ^ (unsigned char)s[i]) * 16777619u;
+   }
+   return h;
+}
+
+/* the slot holding s, or the empty slot where it would go */
+uint32_t
+StringPool::lookup(const char* s, size_t len, uint32_t h) {
+   uint32_t mask = nslots - 1;
+   uint32_t slot = h & mask;
+   while (slots[slot].str != NULL) {
+      Slot& sl = slots[slot];
+      if (sl.hash == h && sl.len == len && memcmp(sl.str, s, len) == 0) {
+         break;
+      }
+      slot = (slot + 1) & mask;
+   }
+   return slot;
+}
+
+/* Strings are carved out of large blocks; one too big to share a block
+ * gets a block of its own.
+ */
+char*
+StringPool::allocate(size_t size) {
+   if (size > BLOCK_SIZE / 4) {
+      char* block = (char*)malloc(size);
+      blocks.push_back(block);
+      return block;
+   }
+   if (size > left) {
+      next = (char*)malloc(BLOCK_SIZE);
+      left = BLOCK_SIZE;
+      blocks.push_back(next);
+   }
+   char* p = next;
+   next += size;
+   left -= size;
+   return p;
+}
+
+void
+StringPool::grow() {
+   Slot* old = slots;
+   uint32_t oldn = nslots;
+   nslots *= 2;
+   slots = (Slot*)calloc(nslots, sizeof(Slot));
+   for (uint32_t i = 0; i < oldn; i++) {
+      if (old[i].str != NULL) {
+         slots[lookup(old[i].str, old[i].len, old[i].hash)] = old[i];
+      }
+   }
+   free(old);
+}
+
+const char*
+StringPool::intern(const char* s) {
+   size_t len = strlen(s);
+   uint32_t h = hash(s, len);
+   pthread_mutex_lock(&mutex);
+   uint32_t slot = lookup(s, len, h);
+   if (slots[slot].str == NULL) {
+      char* str = allocate(len + 1);
+      memcpy(str, s, len + 1);
+      slots[slot].str = str;
+      slots[slot].hash = h;
+      slots[slot].len = len;
+      if (++count * 4 > nslots * 3) {
+         grow();
+      }
+      pthread_mutex_unlock(&mutex);
+      return str;
+   }
+   const char* str = slots[slot].str;
+   pthread_mutex_unlock(&mutex);
+   return str;
+}
+
+const char*
+StringPool::find(const char* s) {
+   size_t len = strlen(s);
+   uint32_t h = hash(s, len);
+   pthread_mutex_lock(&mutex);
+   const char* str = slots[lookup(s, len, h)].str;
+   pthread_mutex_unlock(&mutex);
+   return str;
+}
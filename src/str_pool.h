@@ -0,0 +1,80 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: str_pool.h
+
+*/
+
+#ifndef _STR_POOL_H_
+#define _STR_POOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+// A pool of strings that are kept for the life of the process.  Each
+// string is held once, so two pooled strings are equal only if they are
+// the same pointer.  The symbol names of every object go into one pool
+// (string_pool); the ELF symbol table, the DWARF symbol maps and the
+// aliases share the copies, and their maps are keyed on the pointer (see
+// Map_Intern).  Symbol tables are read on background threads, so the pool
+// has a lock.
+
+class StringPool {
+public:
+   StringPool();
+   ~StringPool();
+
+   const char* intern(const char* s);   // the pooled copy of s, added if needed
+   const char* intern(const std::string& s) { return intern(s.c_str()); }
+   const char* find(const char* s);     // the pooled copy of s, or NULL
+   const char* find(const std::string& s) { return find(s.c_str()); }
+
+private:
+   StringPool(const StringPool&);
+
+   struct Slot {
+      const char* str;                  // NULL if empty
+      uint32_t hash;
+      uint32_t len;
+   };
+
+   uint32_t hash(const char* s, size_t len);
+   uint32_t lookup(const char* s, size_t len, uint32_t h);
+   char* allocate(size_t size);
+   void grow();
+
+   pthread_mutex_t mutex;
+
+   Slot* slots;                         // open addressed, linear probing
+   uint32_t nslots;                     // power of 2
+   uint32_t count;
+
+   std::vector<char*> blocks;           // the arena holding the strings
+   char* next;
+   size_t left;
+};
+
+extern StringPool string_pool;
+
+#endif
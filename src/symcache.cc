@@ -0,0 +1,728 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: symcache.cc
+
+*/
+
+#include "symcache.h"
+#include "symtab.h"
+#include "dwf_cunit.h"
+#include "dwf_cfa.h"
+#include "map_range.h"
+#include "str_pool.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <set>
+
+// The cache file is a header followed by a number of tables, each aligned
+// on an 8 byte boundary.  Names are offsets into the string table and
+// addresses are relative to the base address of the object.
+
+static const char cache_magic[8] = { 'P', 'D', 'B', 'S', 'Y', 'M', 'S', 0 } ;
+static const uint32_t cache_version = 4 ;
+static const uint32_t no_string = 0xffffffff ;
+static const uint64_t no_section = ~(uint64_t)0 ;
+
+// the cache is only used if these sections are the same size as when it was written
+static const char *checked_sections[] = {
+    ".debug_info", ".debug_abbrev", ".debug_str", ".debug_line", ".eh_frame", ".debug_frame"
+} ;
+#define NUM_CHECKED_SECTIONS (sizeof (checked_sections) / sizeof (checked_sections[0]))
+
+enum CacheTable {
+    CT_STRINGS,                 // char
+    CT_UNITS,                   // CacheUnit
+    CT_DIRS,                    // uint32_t, directory names
+    CT_FILES,                   // CacheFile
+    CT_LINES,                   // CacheLine, the rows of the line table
+    CT_LINEFILES,               // CacheLineFile, the files of the rows
+    CT_SYMBOLS,                 // CacheSymbol
+    CT_FUNCTIONS,               // uint32_t, symbol index
+    CT_VARIABLES,               // uint32_t, symbol index
+    CT_STRUCTS,                 // uint32_t, symbol index
+    CT_RANGES,                  // CacheRange, function address ranges
+    CT_LINEADDRS,               // uint32_t, row in address order
+    CT_FILELINES,               // CacheFileLines
+    CT_FILEROWS,                // uint32_t, row in line number order
+    CT_FDES,                    // CacheFDE
+    CT_NUM
+} ;
+
+struct CacheTableEntry {
+    uint64_t offset ;
+    uint64_t count ;
+} ;
+
+struct CacheHeader {
+    char magic[8] ;
+    uint32_t version ;
+    uint32_t pad ;
+    uint64_t sections[NUM_CHECKED_SECTIONS] ;
+    CacheTableEntry tables[CT_NUM] ;
+} ;
+
+struct CacheUnit {
+    uint64_t offset ;           // in .debug_info
+    int32_t language ;
+    uint32_t name ;
+    uint32_t comp_dir ;
+    uint32_t first_dir ;
+    uint32_t ndirs ;
+    uint32_t first_file ;
+    uint32_t nfiles ;
+    uint32_t length ;           // from the unit header, after the length field
+} ;
+
+struct CacheFile {
+    uint32_t name ;             // no_string for the empty first entry
+    int32_t dir ;
+    int32_t mtime ;
+    int32_t size ;
+} ;
+
+struct CacheLine {
+    uint64_t address ;
+    uint32_t file ;             // CacheLineFile index and flags, as in the line table
+    int32_t lineno ;
+    uint32_t column ;
+} ;
+
+struct CacheLineFile {
+    uint32_t unit ;
+    uint32_t file ;             // in the unit's file table
+} ;
+
+struct CacheSymbol {
+    uint64_t offset ;           // of the DIE, relative to the unit
+    uint32_t name ;
+    uint32_t unit ;
+} ;
+
+struct CacheRange {
+    uint64_t lo ;
+    uint64_t hi ;
+    uint32_t symbol ;
+} ;
+
+struct CacheFileLines {
+    uint32_t name ;
+    uint32_t first ;
+    uint32_t count ;
+} ;
+
+enum {
+    CF_EH = 1,                  // in .eh_frame
+    CF_PCREL = 2                // addresses move with the base address
+} ;
+
+struct CacheFDE {
+    uint64_t start ;
+    uint64_t end ;
+    uint64_t offset ;
+    uint32_t flags ;
+} ;
+
+static uint64_t align8 (uint64_t n) {
+    return (n + 7) & ~(uint64_t)7 ;
+}
+
+// the DWARF may be in a separate debug file, .eh_frame is in the object
+static void get_section_sizes (ELF *elf, ELF *debugfile, uint64_t *sizes) {
+    for (uint i = 0 ; i < NUM_CHECKED_SECTIONS ; i++) {
+        bool is_eh = strcmp (checked_sections[i], ".eh_frame") == 0 ;
+        Section *section = (is_eh ? elf : debugfile)->find_section (checked_sections[i]) ;
+        sizes[i] = section == NULL ? no_section : (uint64_t)section->get_size() ;
+    }
+}
+
+// FNV-1a
+static uint64_t hash_bytes (uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data ;
+    for (size_t i = 0 ; i < len ; i++) {
+        h ^= p[i] ;
+        h *= 1099511628211ULL ;
+    }
+    return h ;
+}
+
+SymbolCache::SymbolCache (SymbolTable *symtab)
+    : symtab(symtab) {
+}
+
+SymbolCache::~SymbolCache() {
+}
+
+// the key is the GNU build-id if there is one, otherwise a hash of the
+// path, modification time and size of the file
+std::string SymbolCache::get_key() {
+    if (key != "") {
+        return key ;
+    }
+    ELF *elf = symtab->elffile ;
+    char buf[64] ;
+    key = elf->get_build_id (symtab->stream) ;
+    if (key != "") {
+        return key ;
+    }
+
+    struct stat st ;
+    std::string name = elf->get_name() ;
+    if (stat (name.c_str(), &st) != 0) {
+        return "" ;
+    }
+    uint64_t h = 14695981039346656037ULL ;
+    h = hash_bytes (h, name.c_str(), name.size() + 1) ;
+    int64_t mtime = st.st_mtime ;
+    int64_t size = st.st_size ;
+    h = hash_bytes (h, &mtime, sizeof(mtime)) ;
+    h = hash_bytes (h, &size, sizeof(size)) ;
+    snprintf (buf, sizeof(buf), "f%016llx", (unsigned long long)h) ;
+    key = buf ;
+    return key ;
+}
+
+// the cache lives in $XDG_CACHE_HOME/pathdb or ~/.cache/pathdb
+std::string SymbolCache::get_dir (bool create) {
+    std::string dir ;
+    const char *xdg = getenv ("XDG_CACHE_HOME") ;
+    if (xdg != NULL && *xdg != 0) {
+        dir = xdg ;
+    } else {
+        const char *home = getenv ("HOME") ;
+        if (home == NULL || *home == 0) {
+            return "" ;
+        }
+        dir = std::string (home) + "/.cache" ;
+    }
+    if (create) {
+        mkdir (dir.c_str(), 0755) ;
+    }
+    dir += "/pathdb" ;
+    if (create) {
+        mkdir (dir.c_str(), 0755) ;
+    }
+    return dir ;
+}
+
+std::string SymbolCache::get_path (bool create) {
+    std::string dir = get_dir (create) ;
+    if (dir == "") {
+        return "" ;
+    }
+    std::string k = get_key() ;
+    if (k == "") {
+        return "" ;
+    }
+    return dir + "/" + k + ".sym" ;
+}
+
+bool SymbolCache::load (PStream *os, bool reporterror) {
+    std::string path = get_path (false) ;
+    if (path == "") {
+        return false ;
+    }
+    int fd = open (path.c_str(), O_RDONLY) ;
+    if (fd < 0) {
+        return false ;
+    }
+    struct stat st ;
+    if (fstat (fd, &st) != 0 || st.st_size < (off_t)sizeof (CacheHeader)) {
+        close (fd) ;
+        return false ;
+    }
+    void *map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) ;
+    close (fd) ;
+    if (map == MAP_FAILED) {
+        return false ;
+    }
+    bool ok = restore ((const char *)map, st.st_size, os, reporterror) ;
+    munmap (map, st.st_size) ;
+    return ok ;
+}
+
+// find a table in the mapped file; NULL if it doesn't fit
+template <class T> static const T *get_table (const char *data, long size, int table, uint32_t &count) {
+    const CacheHeader *header = (const CacheHeader *)data ;
+    uint64_t offset = header->tables[table].offset ;
+    uint64_t n = header->tables[table].count ;
+    if (offset % 8 != 0 || offset > (uint64_t)size || n > 0xffffffff ||
+        n > ((uint64_t)size - offset) / sizeof(T)) {
+        return NULL ;
+    }
+    count = n ;
+    return (const T *)(data + offset) ;
+}
+
+bool SymbolCache::restore (const char *data, long size, PStream *os, bool reporterror) {
+    const CacheHeader *header = (const CacheHeader *)data ;
+    if (memcmp (header->magic, cache_magic, sizeof(cache_magic)) != 0 || header->version != cache_version) {
+        return false ;
+    }
+    uint64_t sizes[NUM_CHECKED_SECTIONS] ;
+    get_section_sizes (symtab->elffile, symtab->debugfile, sizes) ;
+    if (memcmp (sizes, header->sections, sizeof(sizes)) != 0) {
+        return false ;
+    }
+
+    uint32_t nstrings, nunits, ndirs, nfiles, nlines, nlinefiles, nsymbols, nfunctions, nvariables, nstructs ;
+    uint32_t nranges, nlineaddrs, nfilelines, nfilerows, nfdes ;
+    const char *strings = get_table<char> (data, size, CT_STRINGS, nstrings) ;
+    const CacheUnit *units = get_table<CacheUnit> (data, size, CT_UNITS, nunits) ;
+    const uint32_t *dirs = get_table<uint32_t> (data, size, CT_DIRS, ndirs) ;
+    const CacheFile *files = get_table<CacheFile> (data, size, CT_FILES, nfiles) ;
+    const CacheLine *lines = get_table<CacheLine> (data, size, CT_LINES, nlines) ;
+    const CacheLineFile *linefiles = get_table<CacheLineFile> (data, size, CT_LINEFILES, nlinefiles) ;
+    const CacheSymbol *symbols = get_table<CacheSymbol> (data, size, CT_SYMBOLS, nsymbols) ;
+    const uint32_t *functions = get_table<uint32_t> (data, size, CT_FUNCTIONS, nfunctions) ;
+    const uint32_t *variables = get_table<uint32_t> (data, size, CT_VARIABLES, nvariables) ;
+    const uint32_t *structs = get_table<uint32_t> (data, size, CT_STRUCTS, nstructs) ;
+    const CacheRange *ranges = get_table<CacheRange> (data, size, CT_RANGES, nranges) ;
+    const uint32_t *lineaddrs = get_table<uint32_t> (data, size, CT_LINEADDRS, nlineaddrs) ;
+    const CacheFileLines *filelines = get_table<CacheFileLines> (data, size, CT_FILELINES, nfilelines) ;
+    const uint32_t *filerows = get_table<uint32_t> (data, size, CT_FILEROWS, nfilerows) ;
+    const CacheFDE *fdes = get_table<CacheFDE> (data, size, CT_FDES, nfdes) ;
+    if (strings == NULL || units == NULL || dirs == NULL || files == NULL || lines == NULL || linefiles == NULL ||
+        symbols == NULL || functions == NULL || variables == NULL || structs == NULL ||
+        ranges == NULL || lineaddrs == NULL || filelines == NULL || filerows == NULL || fdes == NULL) {
+        return false ;
+    }
+
+    // check all the indexes before building anything
+    if (nstrings == 0 || strings[nstrings-1] != 0) {
+        return false ;
+    }
+#define CHECK(cond) if (!(cond)) return false
+#define VALID_STRING(s) ((s) < nstrings)
+    for (uint32_t i = 0 ; i < ndirs ; i++) {
+        CHECK (VALID_STRING (dirs[i])) ;
+    }
+    // the units are in .debug_info order and must fit in it
+    uint64_t infosize = sizes[0] == no_section ? 0 : sizes[0] ;
+    uint64_t unitend = 0 ;
+    for (uint32_t i = 0 ; i < nunits ; i++) {
+        const CacheUnit &u = units[i] ;
+        CHECK (u.offset >= unitend && u.offset <= infosize && u.length <= infosize - u.offset
+               && 4 <= infosize - u.offset - u.length) ;
+        unitend = u.offset + u.length + 4 ;
+        CHECK (VALID_STRING (u.name) && VALID_STRING (u.comp_dir)) ;
+        CHECK (u.first_dir <= ndirs && u.ndirs <= ndirs - u.first_dir) ;
+        CHECK (u.first_file <= nfiles && u.nfiles <= nfiles - u.first_file) ;
+        for (uint32_t j = 0 ; j < u.nfiles ; j++) {
+            const CacheFile &f = files[u.first_file + j] ;
+            if (f.name != no_string) {
+                CHECK (VALID_STRING (f.name) && f.dir >= 0 && (uint32_t)f.dir < u.ndirs) ;
+            }
+        }
+    }
+    for (uint32_t i = 0 ; i < nlinefiles ; i++) {
+        CHECK (linefiles[i].unit < nunits && (linefiles[i].file == 0 || linefiles[i].file < units[linefiles[i].unit].nfiles)) ;
+    }
+    for (uint32_t i = 0 ; i < nlines ; i++) {
+        CHECK ((lines[i].file & LineTable::LT_FILE) < nlinefiles) ;
+    }
+    for (uint32_t i = 0 ; i < nsymbols ; i++) {
+        CHECK (VALID_STRING (symbols[i].name) && symbols[i].unit < nunits) ;
+        // a DIE is after the unit header and inside the unit
+        CHECK (symbols[i].offset >= 11 && symbols[i].offset < units[symbols[i].unit].length + 4) ;
+    }
+    for (uint32_t i = 0 ; i < nfunctions ; i++) {
+        CHECK (functions[i] < nsymbols) ;
+    }
+    for (uint32_t i = 0 ; i < nvariables ; i++) {
+        CHECK (variables[i] < nsymbols) ;
+    }
+    for (uint32_t i = 0 ; i < nstructs ; i++) {
+        CHECK (structs[i] < nsymbols) ;
+    }
+    for (uint32_t i = 0 ; i < nranges ; i++) {
+        CHECK (ranges[i].symbol < nsymbols) ;
+    }
+    for (uint32_t i = 0 ; i < nlineaddrs ; i++) {
+        CHECK (lineaddrs[i] < nlines) ;
+    }
+    for (uint32_t i = 0 ; i < nfilelines ; i++) {
+        const CacheFileLines &fl = filelines[i] ;
+        CHECK (VALID_STRING (fl.name) && fl.first <= nfilerows && fl.count <= nfilerows - fl.first) ;
+    }
+    for (uint32_t i = 0 ; i < nfilerows ; i++) {
+        CHECK (filerows[i] < nlines) ;
+    }
+#undef CHECK
+#undef VALID_STRING
+
+    if (reporterror && sizes[0] == no_section) {
+        symtab->report_no_symbols (os) ;
+    }
+
+    Address base = symtab->get_base() ;
+
+    std::vector<DwCUnit *> cus (nunits) ;
+    for (uint32_t i = 0 ; i < nunits ; i++) {
+        const CacheUnit &u = units[i] ;
+        DwCUnit *cu = new DwCUnit (symtab) ;
+        cu->restore (u.offset, u.length, u.language, strings + u.name, strings + u.comp_dir) ;
+        for (uint32_t j = 0 ; j < u.ndirs ; j++) {
+            cu->restore_directory (strings + dirs[u.first_dir + j]) ;
+        }
+        for (uint32_t j = 0 ; j < u.nfiles ; j++) {
+            const CacheFile &f = files[u.first_file + j] ;
+            cu->restore_file (f.name == no_string ? NULL : strings + f.name, f.dir, f.mtime, f.size) ;
+        }
+        cus[i] = cu ;
+        symtab->compilation_units.push_back (cu) ;
+    }
+
+    std::vector<Symbol *> syms (nsymbols) ;
+    for (uint32_t i = 0 ; i < nsymbols ; i++) {
+        syms[i] = new Symbol (string_pool.intern (strings + symbols[i].name), cus[symbols[i].unit], symbols[i].offset) ;
+    }
+    for (uint32_t i = 0 ; i < nfunctions ; i++) {
+        symtab->functions.set (syms[functions[i]]->name, syms[functions[i]]) ;
+        symtab->completions.raw (syms[functions[i]]->name, true) ;
+    }
+    for (uint32_t i = 0 ; i < nvariables ; i++) {
+        symtab->variables.set (syms[variables[i]]->name, syms[variables[i]]) ;
+    }
+    for (uint32_t i = 0 ; i < nstructs ; i++) {
+        symtab->structs.set (syms[structs[i]]->name, syms[structs[i]]) ;
+    }
+    for (uint32_t i = 0 ; i < nranges ; i++) {
+        const CacheRange &r = ranges[i] ;
+        Address lowpc = r.lo + base ;
+        Address highpc = r.hi + base ;
+        symtab->funcmap.raw (lowpc, highpc, new FunctionLocation (symtab, lowpc, syms[r.symbol], lowpc, highpc)) ;
+    }
+
+    LineTable &table = symtab->get_line_table() ;
+    for (uint32_t i = 0 ; i < nlinefiles ; i++) {
+        table.unitfiles.push_back (LineTable::UnitFile (cus[linefiles[i].unit], linefiles[i].file)) ;
+    }
+    table.addresses.resize (nlines) ;
+    table.files.resize (nlines) ;
+    table.lines.resize (nlines) ;
+    table.columns.resize (nlines) ;
+    for (uint32_t i = 0 ; i < nlines ; i++) {
+        const CacheLine &l = lines[i] ;
+        table.addresses[i] = l.address + base ;
+        table.files[i] = l.file ;
+        table.lines[i] = l.lineno ;
+        table.columns[i] = l.column ;
+    }
+    table.by_address.assign (lineaddrs, lineaddrs + nlineaddrs) ;
+    for (uint32_t i = 0 ; i < nfilelines ; i++) {
+        const CacheFileLines &fl = filelines[i] ;
+        table.by_file[strings + fl.name].assign (filerows + fl.first, filerows + fl.first + fl.count) ;
+    }
+
+    symtab->fde_index.resize (nfdes) ;
+    for (uint32_t i = 0 ; i < nfdes ; i++) {
+        const CacheFDE &f = fdes[i] ;
+        FDEIndexEntry &entry = symtab->fde_index[i] ;
+        Address reloc = (f.flags & CF_PCREL) ? base : 0 ;
+        entry.start = f.start + reloc ;
+        entry.end = f.end + reloc ;
+        entry.offset = f.offset ;
+        entry.is_eh = (f.flags & CF_EH) != 0 ;
+        entry.fde = NULL ;
+    }
+    return true ;
+}
+
+// strings are shared in the string table
+class CacheStrings {
+public:
+    uint32_t add (const std::string &s) {
+        std::map<std::string, uint32_t>::iterator i = offsets.find (s) ;
+        if (i != offsets.end()) {
+            return i->second ;
+        }
+        uint32_t offset = data.size() ;
+        data.insert (data.end(), s.begin(), s.end()) ;
+        data.push_back (0) ;
+        offsets[s] = offset ;
+        return offset ;
+    }
+    std::vector<char> data ;
+private:
+    std::map<std::string, uint32_t> offsets ;
+} ;
+
+template <class T> static void set_table (CacheHeader &header, int table, std::vector<T> &v, uint64_t &offset) {
+    header.tables[table].offset = offset ;
+    header.tables[table].count = v.size() ;
+    offset = align8 (offset + v.size() * sizeof(T)) ;
+}
+
+template <class T> static bool write_table (FILE *fp, std::vector<T> &v) {
+    static const char zeros[8] = { 0 } ;
+    size_t bytes = v.size() * sizeof(T) ;
+    if (bytes != 0 && fwrite (&v[0], 1, bytes, fp) != bytes) {
+        return false ;
+    }
+    size_t pad = align8 (bytes) - bytes ;
+    return pad == 0 || fwrite (zeros, 1, pad, fp) == pad ;
+}
+
+// write the symbol table to the cache.  Nothing is written if any symbol
+// can't be described, and errors writing the file are ignored.
+void SymbolCache::save() {
+    std::string path = get_path (true) ;
+    if (path == "") {
+        return ;
+    }
+    Address base = symtab->get_base() ;
+    CacheStrings strings ;
+    strings.add ("") ;
+    std::vector<CacheUnit> units ;
+    std::vector<uint32_t> dirs ;
+    std::vector<CacheFile> files ;
+    std::vector<CacheLine> lines ;
+    std::vector<CacheLineFile> linefiles ;
+    std::vector<CacheSymbol> symbols ;
+    std::vector<uint32_t> functions, variables, structs ;
+    std::vector<CacheRange> ranges ;
+    std::vector<uint32_t> lineaddrs ;
+    std::vector<CacheFileLines> filelines ;
+    std::vector<uint32_t> filerows ;
+    std::vector<CacheFDE> fdes ;
+
+    // the compilation units
+    std::map<DwCUnit *, uint32_t> unitindex ;
+    CUVec &cus = symtab->compilation_units ;
+    for (uint i = 0 ; i < cus.size() ; i++) {
+        DwCUnit *cu = cus[i] ;
+        unitindex[cu] = i ;
+        CacheUnit u ;
+        memset (&u, 0, sizeof(u)) ;
+        u.offset = cu->get_sec_offset() ;
+        u.length = cu->get_info_length() ;
+        if (cu->get_cu_die() != NULL) {
+            try {
+                u.language = cu->get_language() ;
+            } catch (...) {
+                u.language = 0 ;
+            }
+        }
+        u.name = strings.add (cu->get_name()) ;
+        u.comp_dir = strings.add (cu->get_comp_dir()) ;
+
+        DirectoryTable &dt = cu->get_directory_table() ;
+        u.first_dir = dirs.size() ;
+        u.ndirs = dt.size() ;
+        for (uint j = 0 ; j < dt.size() ; j++) {
+            dirs.push_back (strings.add (dt[j])) ;
+        }
+
+        FileTable &ft = cu->get_file_table() ;
+        u.first_file = files.size() ;
+        u.nfiles = ft.size() ;
+        for (uint j = 0 ; j < ft.size() ; j++) {
+            CacheFile f ;
+            memset (&f, 0, sizeof(f)) ;
+            f.name = no_string ;
+            if (ft[j] != NULL) {
+                f.name = strings.add (ft[j]->basename) ;
+                f.dir = ft[j]->dir ;
+                f.mtime = ft[j]->mtime ;
+                f.size = ft[j]->size ;
+            }
+            files.push_back (f) ;
+        }
+        units.push_back (u) ;
+    }
+
+    // the line table as it is
+    LineTable &table = symtab->get_line_table() ;
+    for (uint i = 0 ; i < table.unitfiles.size() ; i++) {
+        std::map<DwCUnit *, uint32_t>::iterator u = unitindex.find (table.unitfiles[i].cu) ;
+        if (u == unitindex.end()) {
+            return ;
+        }
+        CacheLineFile lf ;
+        lf.unit = u->second ;
+        lf.file = table.unitfiles[i].file ;
+        linefiles.push_back (lf) ;
+    }
+    for (uint32_t i = 0 ; i < table.size() ; i++) {
+        CacheLine l ;
+        memset (&l, 0, sizeof(l)) ;
+        l.address = table.addresses[i] - base ;
+        l.file = table.files[i] ;
+        l.lineno = table.lines[i] ;
+        l.column = table.columns[i] ;
+        lines.push_back (l) ;
+    }
+    lineaddrs = table.by_address ;
+    for (LineTable::FileIndex::iterator fi = table.by_file.begin() ; fi != table.by_file.end() ; fi++) {
+        CacheFileLines fl ;
+        memset (&fl, 0, sizeof(fl)) ;
+        fl.name = strings.add (fi->first) ;
+        fl.first = filerows.size() ;
+        fl.count = fi->second.size() ;
+        filerows.insert (filerows.end(), fi->second.begin(), fi->second.end()) ;
+        filelines.push_back (fl) ;
+    }
+
+    // the symbols, found by the offsets of their DIEs
+    std::vector<Symbol *> syms ;
+    std::map<Symbol *, uint32_t> symindex ;
+    Map_Range<Address,FunctionLocation*> &funcmap = symtab->funcmap ;
+    SymbolTable::SymbolMap *maps[3] = { &symtab->functions, &symtab->variables, &symtab->structs } ;
+    std::vector<uint32_t> *mapindexes[3] = { &functions, &variables, &structs } ;
+    for (int m = 0 ; m < 3 ; m++) {
+        for (SymbolTable::SymbolMap::iterator i = maps[m]->begin() ; i != maps[m]->end() ; i++) {
+            if (symindex.find (i->value) == symindex.end()) {
+                symindex[i->value] = syms.size() ;
+                syms.push_back (i->value) ;
+            }
+            mapindexes[m]->push_back (symindex[i->value]) ;
+        }
+    }
+    // the funcmap is written in its current order so that it sorts the same way
+    for (long i = 0 ; i < funcmap.length() ; i++) {
+        FunctionLocation *func = funcmap.get_triplet (i).val ;
+        if (symindex.find (func->symbol) == symindex.end()) {
+            symindex[func->symbol] = syms.size() ;
+            syms.push_back (func->symbol) ;
+        }
+    }
+
+    std::set<DIE *> wanted ;
+    for (uint i = 0 ; i < syms.size() ; i++) {
+        if (syms[i]->die == NULL) {
+            return ;
+        }
+        wanted.insert (syms[i]->die) ;
+    }
+    std::map<DIE *, Offset> dieoffsets ;
+    for (uint i = 0 ; i < cus.size() ; i++) {
+        OffsetMap &dies = cus[i]->get_dies() ;
+        for (OffsetMap::iterator d = dies.begin() ; d != dies.end() ; d++) {
+            if (wanted.count (d->second) != 0) {
+                dieoffsets[d->second] = d->first ;
+            }
+        }
+    }
+    for (uint i = 0 ; i < syms.size() ; i++) {
+        DIE *die = syms[i]->die ;
+        std::map<DIE *, Offset>::iterator d = dieoffsets.find (die) ;
+        std::map<DwCUnit *, uint32_t>::iterator u = unitindex.find (die->get_cunit()) ;
+        if (d == dieoffsets.end() || u == unitindex.end()) {
+            return ;
+        }
+        CacheSymbol s ;
+        memset (&s, 0, sizeof(s)) ;
+        s.offset = d->second ;
+        s.name = strings.add (syms[i]->name) ;
+        s.unit = u->second ;
+        symbols.push_back (s) ;
+    }
+
+    for (long i = 0 ; i < funcmap.length() ; i++) {
+        const Map_Range<Address,FunctionLocation*>::triplet &t = funcmap.get_triplet (i) ;
+        CacheRange r ;
+        memset (&r, 0, sizeof(r)) ;
+        r.lo = t.lo - base ;
+        r.hi = t.hi - base ;
+        r.symbol = symindex[t.val->symbol] ;
+        ranges.push_back (r) ;
+    }
+
+    // the FDE index, in the order of fdevec
+    for (uint i = 0 ; i < symtab->fdevec.size() ; i++) {
+        FDE *fde = symtab->fdevec[i] ;
+        CacheFDE f ;
+        memset (&f, 0, sizeof(f)) ;
+        bool pcrel = (fde->get_cie()->get_fde_encoding() & 0x70) == DW_EH_PE_pcrel ;
+        Address reloc = pcrel ? base : 0 ;
+        f.start = fde->get_start_address() - reloc ;
+        f.end = fde->get_end_address() - reloc ;
+        f.offset = fde->get_offset() ;
+        f.flags = (fde->is_eh() ? CF_EH : 0) | (pcrel ? CF_PCREL : 0) ;
+        fdes.push_back (f) ;
+    }
+
+    CacheHeader header ;
+    memset (&header, 0, sizeof(header)) ;
+    memcpy (header.magic, cache_magic, sizeof(cache_magic)) ;
+    header.version = cache_version ;
+    get_section_sizes (symtab->elffile, symtab->debugfile, header.sections) ;
+    uint64_t offset = align8 (sizeof(header)) ;
+    set_table (header, CT_STRINGS, strings.data, offset) ;
+    set_table (header, CT_UNITS, units, offset) ;
+    set_table (header, CT_DIRS, dirs, offset) ;
+    set_table (header, CT_FILES, files, offset) ;
+    set_table (header, CT_LINES, lines, offset) ;
+    set_table (header, CT_LINEFILES, linefiles, offset) ;
+    set_table (header, CT_SYMBOLS, symbols, offset) ;
+    set_table (header, CT_FUNCTIONS, functions, offset) ;
+    set_table (header, CT_VARIABLES, variables, offset) ;
+    set_table (header, CT_STRUCTS, structs, offset) ;
+    set_table (header, CT_RANGES, ranges, offset) ;
+    set_table (header, CT_LINEADDRS, lineaddrs, offset) ;
+    set_table (header, CT_FILELINES, filelines, offset) ;
+    set_table (header, CT_FILEROWS, filerows, offset) ;
+    set_table (header, CT_FDES, fdes, offset) ;
+
+    // write to a temporary file and rename it so that a reader never sees
+    // a partial file
+    char suffix[32] ;
+    snprintf (suffix, sizeof(suffix), ".%d", (int)getpid()) ;
+    std::string tmp = path + suffix ;
+    FILE *fp = fopen (tmp.c_str(), "wb") ;
+    if (fp == NULL) {
+        return ;
+    }
+    std::vector<CacheHeader> hv (1, header) ;
+    bool ok = write_table (fp, hv) &&
+        write_table (fp, strings.data) &&
+        write_table (fp, units) &&
+        write_table (fp, dirs) &&
+        write_table (fp, files) &&
+        write_table (fp, lines) &&
+        write_table (fp, linefiles) &&
+        write_table (fp, symbols) &&
+        write_table (fp, functions) &&
+        write_table (fp, variables) &&
+        write_table (fp, structs) &&
+        write_table (fp, ranges) &&
+        write_table (fp, lineaddrs) &&
+        write_table (fp, filelines) &&
+        write_table (fp, filerows) &&
+        write_table (fp, fdes) ;
+    if (fclose (fp) != 0) {
+        ok = false ;
+    }
+    if (!ok || rename (tmp.c_str(), path.c_str()) != 0) {
+        unlink (tmp.c_str()) ;
+    }
+}
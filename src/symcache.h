@@ -0,0 +1,61 @@
+/*
+
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at
+ * http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/CDDL.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+
+file: symcache.h
+
+*/
+
+#ifndef symcache_h_included
+#define symcache_h_included
+
+#include <string>
+
+class SymbolTable ;
+class PStream ;
+
+// The symbol cache keeps the indexes built by reading an object's debug
+// information in a file under ~/.cache/pathdb, so that the next time the
+// object is loaded the DWARF does not have to be read again.
+//
+// Entries are named after the object's GNU build-id, or a hash of its
+// path, modification time and size if it has none.  The cache holds the
+// function, variable and struct tables, the function address ranges, the
+// line tables and the FDE index.  The symbols refer to their DIEs by
+// offset; the compilation unit holding a DIE is read when it is first
+// needed.
+
+class SymbolCache {
+public:
+    SymbolCache (SymbolTable *symtab) ;
+    ~SymbolCache() ;
+    bool load (PStream *os, bool reporterror) ;         // restore the symbol table from the cache
+    void save() ;                                       // write the symbol table to the cache
+    static std::string get_dir (bool create) ;          // "" if there is no home directory
+private:
+    SymbolTable *symtab ;
+    std::string key ;
+
+    std::string get_key() ;
+    std::string get_path (bool create) ;
+    bool restore (const char *data, long size, PStream *os, bool reporterror) ;
+} ;
+
+#endif
@@ -33,17 +33,35 @@ author: David Allison <dallison@pathscale.com>
 #include "dwf_cunit.h"
 #include "arch.h"
 #include "map_range.h"
+#include "symcache.h"
+#include "str_pool.h"
+#include "utils.h"
 
 #include <algorithm>
 #include <set>
 #include <algorithm>
+#include <fstream>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 extern "C" char *cpp_demangle_gnu3(const char *);
 
 AliasManager::AliasManager() {
+    pthread_mutex_init (&mutex, NULL) ;
 }
 
 AliasManager::~AliasManager() {
+    pthread_mutex_destroy (&mutex) ;
+}
+
+// add_alias must be called with the lock held; the lookups take it themselves
+void AliasManager::lock() {
+    pthread_mutex_lock (&mutex) ;
+}
+
+void AliasManager::unlock() {
+    pthread_mutex_unlock (&mutex) ;
 }
 
 
@@ -55,53 +73,130 @@ std::string demangle(const std::string &func)
 
 
 void AliasManager::list_aliases() {
+    lock() ;
+    std::vector<std::pair<std::string, const char *> > sorted ;
     for (AliasMap::iterator i = aliases.begin() ; i != aliases.end() ; i++) {
-        printf ("%s: %s\n", i->first, i->second) ;
+        sorted.push_back (std::make_pair (std::string (i->key), i->value)) ;
+    }
+    unlock() ;
+    std::sort (sorted.begin(), sorted.end()) ;
+    for (uint i = 0 ; i < sorted.size() ; i++) {
+        printf ("%s: %s\n", sorted[i].first.c_str(), sorted[i].second) ;
     }
 }
 
 void AliasManager::add_alias (const char *name, const char *alias) {
-    aliases[name] = alias ;
+    aliases.set (string_pool.intern (name), string_pool.intern (alias)) ;
 }
 
+// a name that isn't an alias yet is demangled if it is a C++ symbol, or
+// else the symbol tables that have finished loading are asked for one
 const char *AliasManager::find_alias (const char *alias) {
-    AliasMap::iterator a = aliases.find (alias) ;
-    if (a == aliases.end()) {
+    lock() ;
+    const char **a = aliases.find (string_pool.find (alias)) ;
+    if (a != NULL) {
+        const char *name = *a ;
+        unlock() ;
+        return name ;
+    }
+    if (strncmp (alias, "_Z", 2) == 0) {
+        const char *name = demangle_locked (alias) ;
+        unlock() ;
+        return name ;
+    }
+    std::vector<SymbolTable *> tables = sources ;
+    unlock() ;
+
+    for (uint i = 0 ; i < tables.size() ; i++) {
+        if (tables[i]->is_ready()) {
+            const char *name = tables[i]->make_alias (alias) ;
+            if (name != NULL) {
+                return name ;
+            }
+        }
+    }
+    return NULL ;
+}
+
+const char *AliasManager::demangle (const char *mangled) {
+    lock() ;
+    const char *name = demangle_locked (mangled) ;
+    unlock() ;
+    return name ;
+}
+
+// a name is only given to the demangler once
+const char *AliasManager::demangle_locked (const char *mangled) {
+    const char *key = string_pool.intern (mangled) ;
+    const char **a = aliases.find (key) ;
+    if (a != NULL) {
+        return *a ;
+    }
+    if (undemangled.find (key) != NULL) {
         return NULL ;
     }
-    return a->second ;
+    char *buf = cpp_demangle_gnu3 (key) ;
+    const char *name = set_demangled_locked (key, buf) ;
+    free (buf) ;
+    return name ;
 }
 
-void AliasManager::complete (std::string name, std::vector<std::string> &result) {
-    for (AliasMap::iterator i = aliases.begin() ; i != aliases.end() ; i++) {
-        if (strncmp (i->first, name.c_str(), name.size()) == 0) {
-            result.push_back (std::string (i->first).substr (name.size())) ;
-        }
+// the symbol tables demangle names on worker threads and record them here
+void AliasManager::set_demangled (const char *mangled, const char *demangled) {
+    lock() ;
+    set_demangled_locked (string_pool.intern (mangled), demangled) ;
+    unlock() ;
+}
+
+// the demangled name is remembered as an alias both ways, and a failure as
+// one
+const char *AliasManager::set_demangled_locked (const char *key, const char *demangled) {
+    if (demangled == NULL) {
+        undemangled.set (key, true) ;
+        return NULL ;
     }
+    const char *name = string_pool.intern (demangled) ;
+    aliases.set (key, name) ;
+    aliases.set (name, key) ;
+    return name ;
+}
 
+void AliasManager::add_source (SymbolTable *symtab) {
+    lock() ;
+    sources.push_back (symtab) ;
+    unlock() ;
 }
 
-Symbol::Symbol (std::string name, DIE * die)
+void AliasManager::remove_source (SymbolTable *symtab) {
+    lock() ;
+    sources.erase (std::remove (sources.begin(), sources.end(), symtab), sources.end()) ;
+    unlock() ;
+}
+
+Symbol::Symbol (const char *name, DIE * die)
     : name(name),
-    die(die) {
+    die(die),
+    cu(NULL),
+    offset(0) {
 }
 
-Symbol::~Symbol() {
+Symbol::Symbol (const char *name, DwCUnit *cu, Offset offset)
+    : name(name),
+    die(NULL),
+    cu(cu),
+    offset(offset) {
 }
 
-class Compare_linematrix {
-public:
-    bool operator() (LineInfo *l1, LineInfo *l2) {
-        return l1->address < l2->address ;
+// the DIE of a symbol restored from the symbol cache is read on first use
+DIE *Symbol::get_die() {
+    if (die == NULL && cu != NULL) {
+        die = cu->find_die (offset) ;
     }
-} ;
+    return die ;
+}
 
-class Compare_line {
-public:
-    bool operator() (LineInfo *l1, LineInfo *l2) {
-        return l1->lineno < l2->lineno ;
-    }
-} ;
+Symbol::~Symbol() {
+}
 
 class Compare_address {
 public:
@@ -151,134 +246,617 @@ static std::string get_cpp_basename (const char *fullname, int &nlevels) {
     return std::string (s, p-s+1) ;
 }
 
-SymbolTable::SymbolTable (Architecture *arch, ELF * elf, std::istream & stream, AliasManager *aliases, PStream *os, bool reporterror)
+// is name one of the basenames of a demangled name?
+static bool has_cpp_basename (const char *fullname, const std::string &name) {
+    for (int level = 1 ; ; level++) {
+        int n = level ;
+        std::string x = get_cpp_basename (fullname, n) ;
+        if (n != 0) {
+            return false ;
+        }
+        if (x == name) {
+            return true ;
+        }
+    }
+}
+
+// skip a source name (a length and an identifier) or return NULL
+static const char *skip_source_name (const char *p) {
+    char *end ;
+    long len = strtol (p, &end, 10) ;
+    if (len <= 0 || (long)strnlen (end, len) < len) {
+        return NULL ;
+    }
+    return end + len ;
+}
+
+// Skip the template arguments starting at p (an 'I') and return what
+// follows them.  Only types, template parameters, substitutions and
+// integer literals are understood; for anything else this returns NULL.
+static const char *skip_template_args (const char *p) {
+    int depth = 0 ;
+    do {
+        char c = *p ;
+        if (isdigit (c)) {
+            p = skip_source_name (p) ;
+        } else if (c == 'I' || c == 'N' || c == 'F' || c == 'J') {
+            depth++ ;
+            p++ ;
+        } else if (c == 'E') {
+            depth-- ;
+            p++ ;
+        } else if (c == 'L') {                  // L <builtin type> [n] <number> E
+            p++ ;
+            if (!islower (*p)) {
+                return NULL ;
+            }
+            p++ ;
+            if (*p == 'n') p++ ;
+            if (!isdigit (*p)) {
+                return NULL ;
+            }
+            while (isdigit (*p)) p++ ;
+            if (*p++ != 'E') {
+                return NULL ;
+            }
+        } else if (c == 'S' && p[1] != '\0' && strchr ("tabsiod", p[1]) != NULL) {
+            p += 2 ;
+        } else if (c == 'S' || c == 'T') {      // S <seq-id> _, T <seq-id> _
+            p++ ;
+            while (isdigit (*p) || isupper (*p)) p++ ;
+            if (*p++ != '_') {
+                return NULL ;
+            }
+        } else if (c == 'A') {                  // A <number> _ <type>
+            p++ ;
+            while (isdigit (*p)) p++ ;
+            if (*p++ != '_') {
+                return NULL ;
+            }
+        } else if (c == 'D' && p[1] != '\0' && strchr ("pnacisfdehu", p[1]) != NULL) {
+            p += 2 ;
+        } else if (c != 'u' && (islower (c) || strchr ("PROKVCGM", c) != NULL)) {
+            p++ ;                               // builtin types and qualifiers
+        } else {
+            return NULL ;
+        }
+    } while (p != NULL && depth > 0) ;
+    return p ;
+}
+
+// The basenames get_cpp_basename would find in the demangled name, read
+// from the mangled one.  Only names made of identifiers, std::,
+// substitutions, template arguments and constructors and destructors are
+// understood; for others, such as function templates, operators and
+// special names, this returns false and the name has to be demangled.
+// The outer levels of a name with template arguments or substitutions in
+// it can't be spelt without demangling, so for those only the last
+// component is returned and partial is set.  Then start is set to how
+// the demangled name starts, as far as that is known.
+static bool get_mangled_basenames (const char *name, std::vector<std::string> &levels, bool &partial,
+                                   std::string &start) {
+    if (strncmp (name, "_Z", 2) != 0 || strchr (name, '.') != NULL) {   // clones are left to the demangler
+        return false ;
+    }
+    const char *p = name + 2 ;
+    if (*p == 'L') {
+        p++ ;
+    }
+    bool nested = *p == 'N' ;
+    if (nested) {
+        p++ ;
+        while (*p == 'r' || *p == 'V' || *p == 'K') p++ ;        // cv-qualifiers
+        if (*p == 'R' || *p == 'O') p++ ;                        // ref-qualifier
+    }
+    partial = false ;
+    std::vector<std::string> parts ;
+    if (p[0] == 'S' && p[1] == 't') {
+        parts.push_back ("std") ;
+        p += 2 ;
+    } else if (nested && p[0] == 'S') {         // a prefix seen before
+        p++ ;
+        while (isdigit (*p) || isupper (*p)) p++ ;
+        if (*p++ != '_') {
+            return false ;
+        }
+        parts.push_back ("") ;
+        partial = true ;
+    }
+    for (;;) {
+        if (isdigit (*p)) {
+            const char *end = skip_source_name (p) ;
+            if (end == NULL) {
+                return false ;
+            }
+            while (isdigit (*p)) p++ ;
+            if (strncmp (p, "_GLOBAL_", 8) == 0) {
+                return false ;
+            }
+            parts.push_back (std::string (p, end - p)) ;
+            p = end ;
+        } else if (nested && parts.size() > 0 && parts.back() != "" && ((p[0] == 'C' && p[1] >= '1' && p[1] <= '3') || (p[0] == 'D' && p[1] >= '0' && p[1] <= '2'))) {
+            parts.push_back ((p[0] == 'D' ? "~" : "") + parts.back()) ;
+            p += 2 ;
+        } else {
+            break ;
+        }
+        if (!nested) {
+            break ;
+        }
+        if (*p == 'I') {                        // a class template, if something follows
+            p = skip_template_args (p) ;
+            if (p == NULL || *p == 'E') {
+                return false ;
+            }
+            if (!partial) {
+                for (uint i = 0 ; i < parts.size() ; i++) {
+                    start += (i == 0 ? "" : "::") + parts[i] ;
+                }
+                start += "<" ;
+            }
+            partial = true ;
+        }
+    }
+    if (parts.size() == 0 || parts.back() == "" || (parts.size() == 1 && parts[0] == "std")) {
+        return false ;
+    }
+    if (nested ? *p != 'E' : (*p == 'I' || *p == 'B')) {      // function templates and ABI tags
+        return false ;
+    }
+
+    if (partial) {
+        levels.push_back (parts.back()) ;
+        return true ;
+    }
+    std::string base ;
+    for (int i = parts.size() - 1 ; i >= 0 ; i--) {
+        base = i == (int)parts.size() - 1 ? parts[i] : parts[i] + "::" + base ;
+        levels.push_back (base) ;
+    }
+    return true ;
+}
+
+SymbolTable::SymbolTable (Architecture *arch, ELF * elf, std::istream & stream, AliasManager *aliases, PStream *os, bool reporterror,
+                          bool parallel, bool background, bool usecache, bool deferred,
+                          std::string debugdir)
     : DwInfo(elf, stream),
       arch(arch),
+      os(os),
+      parallel(parallel),
+      usecache(usecache),
+      loading(false),
+      deferred(false),
+      failed(false),
+      done(0),
       debugger_cu(NULL),
-      aliases(aliases)
+      aliases(aliases),
+      cxx_aliases(false),
+      f90_aliases(false)
       //dirlist(dirlist)
 {
-    read(os, reporterror) ;
+    if (debugdir != "" && !has_debug_info()) {
+        open_debug_file (debugdir) ;
+    }
+
+    // a library without debug information is still read now, so that is
+    // reported when it is loaded
+    if (deferred && !reporterror && has_debug_info()) {
+        this->deferred = true ;
+        aliases->add_source (this) ;
+        return ;
+    }
+
+    // errors are reported by the foreground read, so only read quietly in the background
+    if (background && !reporterror) {
+        if (pthread_create (&loader, NULL, read_thread, this) == 0) {
+            loading = true ;
+            aliases->add_source (this) ;
+            return ;
+        }
+    }
+    read(os, reporterror, parallel) ;
+    aliases->add_source (this) ;
+}
+
+void *SymbolTable::read_thread (void *arg) {
+    SymbolTable *symtab = (SymbolTable *)arg ;
+    symtab->read_quietly() ;
+    __sync_lock_test_and_set (&symtab->done, 1) ;
+    return NULL ;
+}
+
+// a read in the background or when deferred; a failure is reported by wait()
+void SymbolTable::read_quietly() {
+    try {
+        read (NULL, false, parallel) ;
+    } catch (...) {
+        failed = true ;
+        discard() ;
+    }
+}
+
+// wait for the background read to finish, or do the deferred read.  Only
+// called from the main thread, or from the loader thread itself through
+// the DwInfo lookups, which it doesn't wait for.
+void SymbolTable::wait() {
+    if (deferred) {
+        deferred = false ;
+        read_quietly() ;
+    } else if (loading && !pthread_equal (pthread_self(), loader)) {
+        pthread_join (loader, NULL) ;
+        loading = false ;
+    } else {
+        return ;
+    }
+    if (failed && os != NULL) {
+        os->print ("no debugging information for file %s\n", elffile->get_name().c_str()) ;
+    }
+}
+
+bool SymbolTable::is_ready() {
+    return !loading || __sync_fetch_and_add (&done, 0) != 0 ;
+}
+
+int SymbolTable::get_progress() {
+    int total = get_units_total() ;
+    if (total == 0) {
+        return is_ready() ? 100 : 0 ;
+    }
+    return get_units_read() * 100 / total ;
+}
+
+// a failed read leaves the indexes partially built; empty them so the table
+// behaves as one without debug information
+void SymbolTable::discard() {
+    functions.clear() ;
+    variables.clear() ;
+    structs.clear() ;
+    line_table.clear() ;
+    function_start_addresses.clear() ;
+    cpp_basenames.clear() ;
+    completions.clear() ;
+    partial_names.clear() ;
+    demangled_completions.clear() ;
+    cxx_aliases = false ;
+    f90_aliases = false ;
+    funcmap.clear() ;
+}
+
+// unwinding doesn't need the rest of the debug information
+FDE *SymbolTable::find_fde (Address addr) {
+    if (deferred) {
+        read_frames() ;
+    } else {
+        wait() ;
+    }
+    return search_fde (addr) ;
+}
+
+// A deferred table is read for a name that its ELF symbols have, as is
+// or as a Fortran or C++ name.  The C++ basenames come from the ELF
+// symbols, so they are indexed for the first name looked for.  Both that
+// and the read (see wait) are done on the main thread by the lookup that
+// needs them, so the first lookup of a name that a library with deferred
+// symbols defines waits for its debug information to be read.  Handing
+// the read to the background loader would not help as the lookup can't
+// go on until it is done.
+bool SymbolTable::may_define (const std::string &name) {
+    if (!deferred) {
+        return true ;
+    }
+    if (elffile->find_symbol (name, true) != 0 || elffile->find_symbol (name + "_", true) != 0
+        || elffile->find_symbol (name + "__", true) != 0) {
+        return true ;
+    }
+    if (!cxx_aliases) {
+        do_cxx_alias() ;
+    }
+    std::string stripped = name.substr (0, name.find ('(')) ;
+    if (cpp_basenames.count (stripped) != 0) {
+        return true ;
+    }
+    // only the last component of a name in a class template is indexed
+    if (stripped.find ('<') != std::string::npos) {
+        int n = 1 ;
+        return cpp_basenames.count (get_cpp_basename (stripped.c_str(), n)) != 0 ;
+    }
+    return false ;
 }
 
 SymbolTable::~SymbolTable() {
+    aliases->remove_source (this) ;
+    if (loading) {
+        pthread_join (loader, NULL) ;
+    }
     Map_Range<Address,FunctionLocation*>::iterator i;
     for (i=funcmap.begin(); i!=funcmap.end(); ++i) {
        delete i->val;
     }
 
     delete debugger_cu ;
+    if (debugfile != elffile) {
+        delete debugstream ;
+        delete debugfile ;
+    }
+}
+
+// the table is made before main so that symbol tables reading in the
+// background can share it
+struct CRCTable {
+    CRCTable() {
+        for (uint32_t n = 0 ; n < 256 ; n++) {
+            uint32_t c = n ;
+            for (int k = 0 ; k < 8 ; k++) {
+                c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1 ;
+            }
+            table[n] = c ;
+        }
+    }
+    uint32_t table[256] ;
+} ;
+
+static CRCTable crc_table ;
+
+// the CRC32 .gnu_debuglink holds for the debug file (the one zlib computes)
+static bool file_crc32 (std::string path, uint32_t &crc) {
+    const uint32_t *table = crc_table.table ;
+    std::ifstream in (path.c_str(), std::ios::binary) ;
+    if (!in.good()) {
+        return false ;
+    }
+    uint32_t c = 0xffffffff ;
+    char buf[65536] ;
+    while (in) {
+        in.read (buf, sizeof (buf)) ;
+        std::streamsize n = in.gcount() ;
+        for (std::streamsize i = 0 ; i < n ; i++) {
+            c = table[(c ^ (unsigned char)buf[i]) & 0xff] ^ (c >> 8) ;
+        }
+    }
+    crc = c ^ 0xffffffff ;
+    return true ;
+}
+
+// Look for the debug information of a stripped object where gdb does: by
+// build-id under the debug directory, then by the .gnu_debuglink name in
+// the object's directory, its .debug subdirectory and the same directory
+// under the debug directory.
+void SymbolTable::open_debug_file (std::string debugdir) {
+    std::string id = elffile->get_build_id (stream) ;
+    if (id.size() > 2) {
+        std::string path = debugdir + "/.build-id/" + id.substr (0, 2) + "/" + id.substr (2) + ".debug" ;
+        if (try_debug_file (path, id, false, 0)) {
+            return ;
+        }
+    }
+
+    uint32_t crc = 0 ;
+    std::string link = elffile->get_debuglink (stream, crc) ;
+    if (link == "") {
+        return ;
+    }
+    char real[PATH_MAX] ;
+    std::string dir = elffile->get_name() ;
+    if (realpath (dir.c_str(), real) != NULL) {
+        dir = real ;
+    }
+    std::string::size_type slash = dir.rfind ('/') ;
+    dir = slash == std::string::npos ? "." : dir.substr (0, slash) ;
+    if (try_debug_file (dir + "/" + link, id, true, crc) ||
+        try_debug_file (dir + "/.debug/" + link, id, true, crc)) {
+        return ;
+    }
+    try_debug_file (debugdir + dir + "/" + link, id, true, crc) ;
+}
+
+// use the file if it has the debug information and is for this object
+bool SymbolTable::try_debug_file (std::string path, std::string id, bool checkcrc, uint32_t crc) {
+    if (path == elffile->get_name() || access (path.c_str(), R_OK) != 0) {
+        return false ;
+    }
+    ELF *elf = new ELF (path) ;
+    std::istream *s = NULL ;
+    try {
+        s = elf->open (elffile->get_base()) ;
+        uint32_t filecrc ;
+        if (elf->find_section (".debug_info") != NULL &&
+            (id == "" || elf->get_build_id (*s) == id) &&
+            (!checkcrc || (file_crc32 (path, filecrc) && filecrc == crc))) {
+            debugfile = elf ;
+            debugstream = s ;
+            return true ;
+        }
+    } catch (...) {
+    }
+    delete s ;
+    delete elf ;
+    return false ;
+}
+
+// the basenames of a C++ symbol, as a worker of do_cxx_alias finds them
+struct CxxSymbol {
+   const char *name ;
+   bool simple ;                        // the basenames were read from the mangled name
+   bool partial ;                       // only the last component was
+   std::string start ;                  // and the start of the demangled name
+   char *demangled ;                    // otherwise what the demangler made of it
+   std::vector<std::string> levels ;
+} ;
+
+static const int CXX_ALIAS_CHUNK = 4096 ;        // symbols per job
+
+static void cxx_alias_job (void *arg, int job) {
+   std::vector<CxxSymbol> &symbols = *(std::vector<CxxSymbol> *)arg ;
+   uint end = std::min ((uint)(job + 1) * CXX_ALIAS_CHUNK, (uint)symbols.size()) ;
+   for (uint i = job * CXX_ALIAS_CHUNK ; i < end ; i++) {
+      CxxSymbol &sym = symbols[i] ;
+      sym.simple = get_mangled_basenames (sym.name, sym.levels, sym.partial, sym.start) ;
+      if (sym.simple) {
+         continue ;
+      }
+      sym.levels.clear() ;
+      sym.demangled = cpp_demangle_gnu3 (sym.name) ;
+      if (sym.demangled == NULL) {
+         continue ;
+      }
+      for (int level = 1 ; ; level++) {
+         int n = level ;
+         std::string x = get_cpp_basename (sym.demangled, n) ;
+         if (n != 0) {
+            break ;
+         }
+         sym.levels.push_back (x) ;
+      }
+   }
 }
 
 void SymbolTable::do_cxx_alias() {
-  /* Add aliases to C++ demangled names to the symbol table.
-   * This includes basenames, for example, "a::b::c" adds
-   * "c", ""b::c", as well as "a::b::c"
+  /* Index the basenames of the C++ symbols, for example, "a::b::c"
+   * adds "c", "b::c", as well as "a::b::c".  They are read from the
+   * mangled name where that is simple; only the other names are
+   * demangled now.  The aliases between mangled and demangled names
+   * are made when they are asked for (see find_alias), and the
+   * demangled names are offered for completion when a completion asks
+   * for them (see complete_demangled).
+   *
+   * The names are worked out in chunks, in parallel if the table is
+   * read that way, and then added to the indexes in symbol order.
    */
 
-   Map_Range<Address,ELFSymbol*> &symmap = elffile->get_symbols();
-   Map_Range<Address,ELFSymbol*>::iterator i;
-
-   for (i=symmap.begin(); i!=symmap.end(); ++i) {
-      ELFSymbol *sym = i->val;
-
-      const char *name = sym->get_c_name() ;
-      const char *demangled = cpp_demangle_gnu3 (name) ;
-      if (demangled != NULL) {
-         aliases->add_alias (name, demangled) ;
-         aliases->add_alias (demangled, name) ;
-         int level = 1 ;
-         for (;;) {
-            int n = level ;
-            std::string x = get_cpp_basename (demangled, n) ;
-            if (n != 0) {
-                break ;
-            }
-            cpp_basenames.insert (BaseMap::value_type(x, demangled)) ;
-            level++ ;
-         }
+   std::vector<CxxSymbol> symbols ;
+   int nsymbols = elffile->get_num_symbols() ;
+   for (int i = 0 ; i < nsymbols ; i++) {
+      const char *name = elffile->get_symbol (i).get_c_name() ;
+      if (strncmp (name, "_Z", 2) == 0) {
+         symbols.push_back (CxxSymbol()) ;
+         symbols.back().name = name ;
+         symbols.back().simple = false ;
+         symbols.back().partial = false ;
+         symbols.back().demangled = NULL ;
       }
    }
+   int njobs = (symbols.size() + CXX_ALIAS_CHUNK - 1) / CXX_ALIAS_CHUNK ;
+   Utils::parallel_for (njobs, cxx_alias_job, &symbols, parallel ? 0 : 1) ;
+
+   for (uint i = 0 ; i < symbols.size() ; i++) {
+      CxxSymbol &sym = symbols[i] ;
+      if (!sym.simple) {
+         aliases->set_demangled (sym.name, sym.demangled) ;
+         free (sym.demangled) ;
+      }
+      if (sym.simple && sym.partial) {
+         partial_names.insert (BaseMap::value_type(sym.start, sym.name)) ;
+      }
+      for (uint j = 0 ; j < sym.levels.size() ; j++) {
+         cpp_basenames.insert (BaseMap::value_type(sym.levels[j], sym.name)) ;
+         completions.raw (string_pool.intern (sym.levels[j]), true) ;
+      }
+   }
+   cxx_aliases = true ;
 }
 
-void SymbolTable::do_f90_alias() {
-   Map_Range<Address,ELFSymbol*> &symmap = elffile->get_symbols();
-   Map_Range<Address,ELFSymbol*>::iterator i;
-
-   for (i=symmap.begin(); i!=symmap.end(); ++i) {
-      ELFSymbol* sym = i->val;
-
-      const char *name = sym->get_c_name() ;
-      const char *ch = name + strlen (name) - 1; 
-      char *demangled = NULL ;
-      if (*ch == '_') {
-          if (ch[-1] == '_') {
-             ch-- ;
-             const char *s = name ;
-             bool contains_uscore = false ;
-             while (s != ch) {
-                if (*s == '_') {
-                   contains_uscore = true ;
-                   break ;
-                }
-                s++ ;
-             }
-             if (contains_uscore) {
-                demangled = strndup (name, ch-name) ;
-             } else {
-                demangled = strndup (name, ch-name+1) ;
-             }
-         } else {                    // single underscore
-            demangled = strndup (name, ch-name) ;
+// The demangled names of the C++ symbols are offered for completion as
+// well as their basenames.  They are demangled when a prefix they may
+// start with is completed: the names whose basenames start with it, and
+// the names indexed only by their last component that start the same way
+// as it, which are then done with.
+void SymbolTable::complete_demangled (const std::string &prefix) {
+   std::vector<const char *> names ;
+   std::string key = prefix.substr (0, prefix.find ('(')) ;
+   for (BaseMap::iterator i = cpp_basenames.lower_bound (key) ;
+        i != cpp_basenames.end() && i->first.compare (0, key.size(), key) == 0 ; i++) {
+      names.push_back (i->second) ;
+   }
+   for (uint len = 0 ; len < prefix.size() ; len++) {
+      std::pair<BaseMap::iterator,BaseMap::iterator> p = partial_names.equal_range (prefix.substr (0, len)) ;
+      for (BaseMap::iterator i = p.first ; i != p.second ; i++) {
+         names.push_back (i->second) ;
+      }
+      partial_names.erase (p.first, p.second) ;
+   }
+   BaseMap::iterator first = partial_names.lower_bound (prefix) ;
+   BaseMap::iterator last = first ;
+   while (last != partial_names.end() && last->first.compare (0, prefix.size(), prefix) == 0) {
+      names.push_back (last->second) ;
+      last++ ;
+   }
+   partial_names.erase (first, last) ;
+   for (uint i = 0 ; i < names.size() ; i++) {
+      const char *demangled = aliases->demangle (names[i]) ;
+      if (demangled != NULL && demangled_completions.find (demangled) == NULL) {
+         demangled_completions.set (demangled, true) ;
+         completions.raw (demangled, true) ;
+      }
+   }
+}
+
+// the name a Fortran compiler would have turned into this symbol, or NULL
+static char *f90_demangle (const char *name) {
+   size_t len = strlen (name) ;
+   if (len < 2 || name[len-1] != '_') {
+      return NULL ;
+   }
+   const char *ch = name + len - 1 ;
+   if (ch[-1] == '_') {
+      ch-- ;
+      const char *s = name ;
+      bool contains_uscore = false ;
+      while (s != ch) {
+         if (*s == '_') {
+            contains_uscore = true ;
+            break ;
          }
+         s++ ;
       }
-      if (demangled != NULL) {
-         aliases->add_alias (name, demangled) ;
-         aliases->add_alias (demangled, name) ;
+      if (contains_uscore) {
+         return strndup (name, ch-name) ;
+      } else {
+         return strndup (name, ch-name+1) ;
       }
    }
+   return strndup (name, ch-name) ;           // single underscore
 }
 
-void SymbolTable::read(PStream *os, bool reporterror) {
+// the aliases are made when they are asked for (see find_alias); only the
+// Fortran names are offered for completion now
+void SymbolTable::do_f90_alias() {
+   int nsymbols = elffile->get_num_symbols() ;
+   for (int i = 0 ; i < nsymbols ; i++) {
+      char *fname = f90_demangle (elffile->get_symbol (i).get_c_name()) ;
+      if (fname != NULL) {
+         completions.raw (string_pool.intern (fname), true) ;
+         free (fname) ;
+      }
+   }
+   f90_aliases = true ;
+}
+
+void SymbolTable::read(PStream *os, bool reporterror, bool parallel) {
     try {
-        read_string_table() ;
-        read_abbreviations() ;
-        read_debug_info(os, reporterror) ;
-        read_frames() ;
         debugger_cu = new DwCUnit(this) ;
+        SymbolCache cache (this) ;
+        bool cached = usecache && cache.load (os, reporterror) ;
+        if (!cached) {
+            read_string_table() ;
+            read_abbreviations() ;
+            read_debug_info(os, reporterror, parallel) ;
+            read_frames() ;
+            // the cache is saved by all_units_read() as it needs all the units
+            // read, so with no cache to load they are expanded now to write it.
+            // A cached unit is read again from .debug_info, so there is no
+            // cache for an object with split units
+            if (usecache && !has_split_units()) {
+                expand_all_units() ;
+            }
+        }
+
         bool cpp_found = false ;                // do we have a C++ compilation unit?
         bool fortran_found = false ;            // same for fortran
-
         for (uint i = 0 ; i < compilation_units.size() ; i++) {
             DwCUnit *cu = compilation_units[i] ;
-            //DIEMap &symbols = cu->get_symbols() ;
-            FileTable &filetable = cu->get_file_table() ;
-
-            LineMatrix &lines = cu->get_line_matrix() ;
-            int lastfile = -1 ;
-            LineInfoVec *lastlines = NULL ;
-            for (uint i = 0 ; i < lines.size() ; i++) {
-                lineaddresses.push_back (lines[i]) ;            // add to main line map (indexed on address)
-
-                LineInfoVec *linevec = NULL ;
-                if (lines[i]->file == lastfile) {
-                    linevec = lastlines ;
-                } else {
-                    std::string &filename = filetable[lines[i]->file]->basename ;                // filename for this line
-                    FileMap::iterator fi = files.find (filename) ;                              // exitsts in map?
-                    if (fi == files.end()) {                                            // no, add new entry
-                        linevec = new LineInfoVec() ;
-                        files[filename] = linevec ;
-                    } else {
-                        linevec = fi->second ;
-                    }
-                }
-                linevec->push_back (lines[i]) ;                 // add line to line vec for file
-                // cache for next time
-                lastfile = lines[i]->file ;
-                lastlines = linevec ;
+            if (!cu->has_language()) {          // a skeleton whose split unit is missing
+                continue ;
             }
-
             if (cu->get_language() == DW_LANG_C_plus_plus) {
                 cpp_found = true ;
             } else if (cu->get_language() == DW_LANG_Fortran77 || cu->get_language() == DW_LANG_Fortran90) {
@@ -287,15 +865,7 @@ void SymbolTable::read(PStream *os, bool reporterror) {
             }
         }
 
-        std::sort (lineaddresses.begin(), lineaddresses.end(), Compare_linematrix()) ;
-
-        // now sort all the line vectors in the file map (XXX: this is probably already sorted)
-        for (FileMap::iterator fi = files.begin() ; fi != files.end() ; fi++) {
-            LineInfoVec *vec = fi->second ;
-            std::sort (vec->begin(), vec->end(), Compare_line()) ;
-        }
-
-        if (cpp_found) {
+        if (cpp_found && !cxx_aliases) {          // may have been done while deferred
 	  do_cxx_alias();
         }
         if (fortran_found) {
@@ -307,13 +877,54 @@ void SymbolTable::read(PStream *os, bool reporterror) {
     }
 }
 
+// all the units have been read, so the symbol table can be saved
+void SymbolTable::all_units_read() {
+    if (usecache && !has_split_units()) {
+        SymbolCache cache (this) ;
+        cache.save() ;
+    }
+}
+
+// the units to expand for a name are also found from the ELF symbols of
+// the Fortran names and of the C++ names with it as a basename
+void SymbolTable::find_symbol_addresses (std::string name, std::vector<Address> &addrs) {
+    DwInfo::find_symbol_addresses (name, addrs) ;
+    DwInfo::find_symbol_addresses (name + "_", addrs) ;
+    DwInfo::find_symbol_addresses (name + "__", addrs) ;
+    if (cxx_aliases) {
+        std::string stripped = name.substr (0, name.find ('(')) ;
+        std::pair<BaseMap::iterator,BaseMap::iterator> p = cpp_basenames.equal_range (stripped) ;
+        for (BaseMap::iterator i = p.first ; i != p.second ; i++) {
+            DwInfo::find_symbol_addresses (i->second, addrs) ;
+        }
+    }
+}
+
+void SymbolTable::find_prefix_addresses (std::string prefix, std::vector<Address> &addrs) {
+    DwInfo::find_prefix_addresses (prefix, addrs) ;
+    if (cxx_aliases) {
+        for (BaseMap::iterator i = cpp_basenames.lower_bound (prefix) ; i != cpp_basenames.end() ; i++) {
+            if (i->first.compare (0, prefix.size(), prefix) != 0) {
+                break ;
+            }
+            DwInfo::find_symbol_addresses (i->second, addrs) ;
+        }
+    }
+}
+
 // because of lazy loading of the dwarf info, some subprograms may not
 // be available until they are referenced (inside a class, for example).  This
 // virtual function is called whenever a new subprogram is added to the dwarf objects.
 
 void SymbolTable::register_subprogram (std::string name, DIE *die) {
-    Symbol *func = new Symbol (name, die) ;
-    functions[name] = func ;
+    const char *key = string_pool.intern (name) ;
+    Symbol *func = new Symbol (key, die) ;
+    if (functions.find (key) == NULL) {
+        completions.raw (key, true) ;
+    }
+    if (replaces (functions, key, die)) {
+        functions.set (key, func) ;
+    }
     Address lowpc = (Address)func->die->getAttribute (DW_AT_low_pc) + get_base() ;
     Address highpc = (Address)func->die->getAttribute (DW_AT_high_pc) + get_base() ;
 
@@ -324,14 +935,33 @@ void SymbolTable::register_subprogram (std::string name, DIE *die) {
 }
 
 void SymbolTable::register_symbol (std::string name, DIE *die) {
-    variables[name] = new Symbol(name, die) ;             // all symbols, not just variables
+    const char *key = string_pool.intern (name) ;
+    if (replaces (variables, key, die)) {
+        variables.set (key, new Symbol(key, die)) ;             // all symbols, not just variables
+    }
 }
 
 void SymbolTable::register_struct (std::string name, DIE *die) {
-    structs[name] = new Symbol(name, die) ;          
+    const char *key = string_pool.intern (name) ;
+    if (replaces (structs, key, die)) {
+        structs.set (key, new Symbol(key, die)) ;
+    }
+}
+
+// When all the units are read in order a symbol replaces any earlier one of
+// the same name.  The units are read in the order they are needed, so keep a
+// symbol from a later unit to get the same result.
+bool SymbolTable::replaces (SymbolMap &map, const char *name, DIE *die) {
+    Symbol **s = map.find (name) ;
+    if (s == NULL) {
+        return true ;
+    }
+    DwCUnit *cu = (*s)->die != NULL ? (*s)->die->get_cunit() : (*s)->cu ;
+    return cu->get_sec_offset() <= die->get_cunit()->get_sec_offset() ;
 }
 
 FunctionLocation* SymbolTable::find_function_by_address(Address addr) {
+    expand_unit_at (addr - get_base()) ;
     FunctionLocation* x;
     if ( funcmap.get(addr,&x) ) {
        return NULL;
@@ -348,13 +978,97 @@ std::string SymbolTable::find_alias (std::string name) {
     return alias ;
 }
 
+// Make an alias for a name that isn't mangled, if this table has a symbol
+// it is the demangled name of.  What is found is added to the aliases, and
+// a miss on a name already in the string pool is remembered so the next
+// lookup is quick; other names aren't pooled, so typos and completion
+// prefixes don't grow the pool.  A deferred table makes its aliases once
+// it has been read.
+const char *SymbolTable::make_alias (const char *name) {
+    if (deferred) {
+        return NULL ;
+    }
+    wait() ;
+    if (!cxx_aliases && !f90_aliases) {
+        return NULL ;
+    }
+    const char *key = string_pool.find (name) ;        // NULL if no symbol has the name
+    if (key != NULL && no_alias.find (key) != NULL) {
+        return NULL ;
+    }
+    const char *alias = NULL ;
+    if (cxx_aliases) {
+        alias = find_cxx_alias (name) ;
+    }
+    if (alias == NULL && f90_aliases) {
+        alias = find_f90_alias (name) ;
+    }
+    if (alias == NULL && key != NULL) {
+        no_alias.set (key, true) ;
+    }
+    return alias ;
+}
+
+// the mangled name of a demangled one.  The symbols with the same basename
+// are demangled to find it
+const char *SymbolTable::find_cxx_alias (const char *name) {
+    int n = 1 ;
+    std::string base = get_cpp_basename (name, n) ;
+    std::pair<BaseMap::iterator,BaseMap::iterator> p = cpp_basenames.equal_range (base) ;
+    for (BaseMap::iterator i = p.first ; i != p.second ; i++) {
+        const char *demangled = aliases->demangle (i->second) ;
+        if (demangled != NULL && strcmp (demangled, name) == 0) {
+            return string_pool.intern (i->second) ;
+        }
+    }
+    return NULL ;
+}
+
+// a Fortran name and the symbol the compiler made of it, either way round
+const char *SymbolTable::find_f90_alias (const char *name) {
+    const char *symbol = NULL ;
+    char *demangled = NULL ;
+    bool mangled = false ;                      // name is the compiler's
+    if (elffile->find_symbol (name) != 0) {
+        symbol = string_pool.intern (name) ;
+        mangled = true ;
+        demangled = f90_demangle (name) ;
+    } else {
+        std::string candidates[2] = { std::string (name) + "_", std::string (name) + "__" } ;
+        for (int i = 0 ; i < 2 && symbol == NULL ; i++) {
+            if (elffile->find_symbol (candidates[i]) == 0) {
+                continue ;
+            }
+            demangled = f90_demangle (candidates[i].c_str()) ;
+            if (demangled != NULL && strcmp (demangled, name) == 0) {
+                symbol = string_pool.intern (candidates[i]) ;
+            } else {
+                free (demangled) ;
+                demangled = NULL ;
+            }
+        }
+    }
+    if (demangled == NULL) {
+        return NULL ;
+    }
+    const char *fname = string_pool.intern (demangled) ;
+    free (demangled) ;
+    aliases->lock() ;
+    aliases->add_alias (symbol, fname) ;
+    aliases->add_alias (fname, symbol) ;
+    aliases->unlock() ;
+    return mangled ? fname : symbol ;
+}
+
 
 Location SymbolTable::find_address(Address addr, bool guess) {
-    int start = 0 ;
-    int end = lineaddresses.size() - 1 ;
+    wait() ;
+    expand_unit_at (addr - get_base()) ;
+    bool exact ;
+    int row = line_table.find_address (addr, exact) ;
 
     // if no DWARF info, look up the location in ELF.
-    if (end == -1) {
+    if (row == -1) {
         std::string symname = "" ;
         int offset = 0 ;
         elffile->find_symbol_at_address (addr, symname, offset) ;
@@ -367,77 +1081,65 @@ Location SymbolTable::find_address(Address addr, bool guess) {
         return loc;
     }
 
-    while (start <= end) {
-        int mid = (end + start) / 2 ;
-        if (addr == lineaddresses[mid]->address) {
-            LineInfo * info = lineaddresses[mid] ;
-            FileTable & files = info->cu->get_file_table() ;
-            FunctionLocation * func = find_function_by_address (addr) ;
-            int offset = 0 ;
-            if (func == NULL) {
-                std::string symname = "" ;
-                elffile->find_symbol_at_address (addr, symname, offset) ;
-
-                Location loc;
-                loc.set_lineinfo(info);
-                loc.set_symtab(this);
-                loc.set_addr(addr);
-                loc.set_file(files[info->file]);
-                //loc.set_dirlist(&dirlist);
-                loc.set_line(info->lineno);
-                loc.set_symname(symname);
-                loc.set_offset(offset);
-                return loc;
-            }
-            int language = func->symbol->die->get_language() ;
-            std::string funcname = func->get_name() ;
-            bool infunc = addr >= func->get_start_address() && addr <= func->get_end_address() ;
-            if (!infunc) {
-                std::string symname = "" ;
-                elffile->find_symbol_at_address (addr, symname, offset) ;
-                if (language == DW_LANG_C_plus_plus) {
-                   symname = find_alias (symname) ;
-                }
-                Location loc;
-                loc.set_lineinfo(info);
-                loc.set_symtab(this);
-                loc.set_addr(addr);
-                loc.set_funcloc(func);
-                loc.set_file(files[info->file]);
-                //loc.set_dirlist(&dirlist);
-                loc.set_line(info->lineno);
-                loc.set_symname(symname);
-                loc.set_offset(offset);
-                return loc;
-            } else {
-                offset = addr - func->get_start_address() ;
-            }
+    DwCUnit *cu = line_table.get_unit (row) ;
+    File *file = line_table.get_file (row) ;
+    int lineno = line_table.get_line (row) ;
+    if (exact) {
+        FunctionLocation * func = find_function_by_address (addr) ;
+        int offset = 0 ;
+        if (func == NULL) {
+            std::string symname = "" ;
+            elffile->find_symbol_at_address (addr, symname, offset) ;
+
+            Location loc;
+            loc.set_unit(cu);
+            loc.set_symtab(this);
+            loc.set_addr(addr);
+            loc.set_file(file);
+            //loc.set_dirlist(&dirlist);
+            loc.set_line(lineno);
+            loc.set_symname(symname);
+            loc.set_offset(offset);
+            return loc;
+        }
+        int language = func->symbol->get_die()->get_language() ;
+        std::string funcname = func->get_name() ;
+        bool infunc = addr >= func->get_start_address() && addr <= func->get_end_address() ;
+        if (!infunc) {
+            std::string symname = "" ;
+            elffile->find_symbol_at_address (addr, symname, offset) ;
             if (language == DW_LANG_C_plus_plus) {
-                funcname = find_alias (funcname) ;
+               symname = find_alias (symname) ;
             }
             Location loc;
-            loc.set_lineinfo(info);
+            loc.set_unit(cu);
             loc.set_symtab(this);
             loc.set_addr(addr);
             loc.set_funcloc(func);
-            loc.set_file(files[info->file]);
-            loc.set_line(info->lineno);
+            loc.set_file(file);
             //loc.set_dirlist(&dirlist);
-            loc.set_symname(funcname);
+            loc.set_line(lineno);
+            loc.set_symname(symname);
             loc.set_offset(offset);
             return loc;
-        }
-        if (addr < lineaddresses[mid]->address) {
-            end = mid - 1 ;
         } else {
-            start = mid + 1 ;
+            offset = addr - func->get_start_address() ;
         }
+        if (language == DW_LANG_C_plus_plus) {
+            funcname = find_alias (funcname) ;
+        }
+        Location loc;
+        loc.set_unit(cu);
+        loc.set_symtab(this);
+        loc.set_addr(addr);
+        loc.set_funcloc(func);
+        loc.set_file(file);
+        loc.set_line(lineno);
+        //loc.set_dirlist(&dirlist);
+        loc.set_symname(funcname);
+        loc.set_offset(offset);
+        return loc;
     }
-    if (end < 0) {
-        end = 0 ;
-    }
-    LineInfo *info = lineaddresses[end] ;
-    FileTable & files = info->cu->get_file_table() ;
     FunctionLocation * func = find_function_by_address (addr) ;
     int offset = 0 ;
     if (func == NULL) {
@@ -445,19 +1147,19 @@ Location SymbolTable::find_address(Address addr, bool guess) {
         elffile->find_symbol_at_address (addr, symname, offset) ;
 
         Location loc;
-        loc.set_lineinfo(info);
+        loc.set_unit(cu);
         loc.set_funcloc(func);
         loc.set_addr(addr);
         //loc.set_dirlist(&dirlist);
         loc.set_symtab(this);
-        loc.set_file(files[info->file]);
+        loc.set_file(file);
         loc.set_symname(find_alias(symname));
         loc.set_offset(offset);
         return loc;
     }
     std::string funcname = func->get_name() ;
     bool infunc = addr >= func->get_start_address() && addr <= func->get_end_address() ;
-    int language = func->symbol->die->get_language() ;
+    int language = func->symbol->get_die()->get_language() ;
     if (!infunc) {
         std::string symname = "" ;
         elffile->find_symbol_at_address (addr, symname, offset) ;
@@ -465,12 +1167,12 @@ Location SymbolTable::find_address(Address addr, bool guess) {
             symname = find_alias (symname) ;
         }
         Location loc;
-        loc.set_lineinfo(info);
+        loc.set_unit(cu);
         loc.set_addr(addr);
         //loc.set_dirlist(&dirlist);
         loc.set_symtab(this);
         loc.set_funcloc(func);
-        loc.set_file(files[info->file]);
+        loc.set_file(file);
         loc.set_symname(symname);
         loc.set_offset(offset);
         return loc;
@@ -482,37 +1184,20 @@ Location SymbolTable::find_address(Address addr, bool guess) {
     }
 
     Location loc;
-    loc.set_lineinfo(info);
+    loc.set_unit(cu);
     loc.set_symtab(this);
     loc.set_addr(addr);
-    loc.set_file(files[info->file]);
+    loc.set_file(file);
     //loc.set_dirlist(&dirlist);
-    loc.set_line(guess ? info->lineno : -1);
+    loc.set_line(guess ? lineno : -1);
     loc.set_symname(funcname);
     loc.set_funcloc(func);
     loc.set_offset(offset);
     return loc;
 }
 
-LineInfo* SymbolTable::get_line_info(Address address) {
-    int start = 0 ;
-    int end = lineaddresses.size() - 1 ;
-
-    while (start <= end) {
-        int mid = (end + start) / 2 ;
-        if (address == lineaddresses[mid]->address) {
-            return lineaddresses[mid] ;
-        }
-        if (address < lineaddresses[mid]->address) {
-            end = mid - 1 ;
-        } else {
-            start = mid + 1 ;
-        }
-    }
-    return NULL ;
-}
-
 void SymbolTable::list_functions(EvalContext &context) {
+    wait() ;
     for (uint i = 0 ; i < compilation_units.size() ; i++) {
         DwCUnit *cu = compilation_units[i] ;
         std::string filename = cu->get_cu_die()->getAttribute (DW_AT_name) ;
@@ -532,6 +1217,7 @@ void SymbolTable::list_functions(EvalContext &context) {
 }
 
 void SymbolTable::list_variables(EvalContext &context) {
+    wait() ;
     for (uint i = 0 ; i < compilation_units.size() ; i++) {
         DwCUnit *cu = compilation_units[i] ;
         std::string filename = cu->get_cu_die()->getAttribute (DW_AT_name) ;
@@ -551,77 +1237,98 @@ void SymbolTable::list_variables(EvalContext &context) {
 }
 
 void SymbolTable::delete_temp_dies() {
+    wait() ;
     debugger_cu->delete_temp_dies() ;
 }
 
 void SymbolTable::keep_temp_dies(std::vector<DIE*> &buffer) {
+    wait() ;
     debugger_cu->keep_temp_dies(buffer) ;
 }
 
 void SymbolTable::keep_temp_die(DIE *die) {
+    wait() ;
     debugger_cu->keep_temp_die(die) ;
 }
 
 DIE * SymbolTable::new_int() {
+    wait() ;
     return new_scalar_type ("int", DW_ATE_signed, 4) ;
 }
 
 DIE * SymbolTable::new_boolean() {
+    wait() ;
     return new_scalar_type ("boolean", DW_ATE_boolean, 1) ;
 }
 
 DIE * SymbolTable::new_scalar_type(std::string name, int encoding, int size) {
+    wait() ;
     return debugger_cu->new_scalar_type (name, encoding, size) ;
 }
 
 DIE *SymbolTable::new_pointer_type(DIE * to) {
+    wait() ;
     return debugger_cu->new_pointer_type (to) ;
 }
 
 DIE *SymbolTable::new_const_type(DIE * to) {
+    wait() ;
     return debugger_cu->new_const_type (to) ;
 }
 
 DIE *SymbolTable::new_volatile_type(DIE * to) {
+    wait() ;
     return debugger_cu->new_volatile_type (to) ;
 }
 
 DIE *SymbolTable::new_array_type(DIE * to) {
+    wait() ;
     return debugger_cu->new_array_type (to) ;
 }
 
 DIE *SymbolTable::new_subrange_type(int lb, int ub) {
+    wait() ;
     return debugger_cu->new_subrange_type (lb, ub) ;
 }
 
 DIE *SymbolTable::new_subrange_type() {
+    wait() ;
     return debugger_cu->new_subrange_type () ;
 }
 
 DIE *SymbolTable::new_string_type(int len) {
+    wait() ;
     return debugger_cu->new_string_type (len) ;
 }
 
 DIE *SymbolTable::new_subroutine_type() {
+    wait() ;
     return debugger_cu->new_subroutine_type () ;
 }
 
 DIE *SymbolTable::new_formal_parameter(DIE *type) {
+    wait() ;
     return debugger_cu->new_formal_parameter (type) ;
 }
 
 DIE * SymbolTable::find_symbol(std::string name, bool search_alias) {
-    SymbolMap::iterator s = functions.find (name) ;
-    if (s != functions.end()) {
-        return s->second->die ;
+    if (!may_define (name)) {
+        return NULL ;
     }
-    s = variables.find(name) ;
-    if (s != variables.end()) {
-        return s->second->die ;
+    wait() ;
+    expand_units (name) ;
+    const char *key = string_pool.find (name) ;         // NULL if no symbol has the name
+    Symbol **s = functions.find (key) ;
+    if (s != NULL) {
+        return (*s)->get_die() ;
     }
-    s = structs.find(name) ;
-    if (s != structs.end()) {
-        return s->second->die ;
+    s = variables.find (key) ;
+    if (s != NULL) {
+        return (*s)->get_die() ;
+    }
+    s = structs.find (key) ;
+    if (s != NULL) {
+        return (*s)->get_die() ;
     }
     if (search_alias) {
         std::string alias = find_alias (name) ;
@@ -632,6 +1339,10 @@ DIE * SymbolTable::find_symbol(std::string name, bool search_alias) {
 
 // find a scope by looking at all the compilation units
 DIE *SymbolTable::find_scope (std::string name) {
+    if (!may_define (name)) {
+        return NULL ;
+    }
+    wait() ;
     for (uint i = 0 ; i < compilation_units.size() ; i++) {
         DwCUnit *cu = compilation_units[i] ;
         DIE *die = cu->get_cu_die() ;
@@ -645,100 +1356,58 @@ DIE *SymbolTable::find_scope (std::string name) {
 
 
 DIE * SymbolTable::find_struct(std::string name) {
-    SymbolMap::iterator s = structs.find (name) ;
-    if (s != structs.end()) {
-        return s->second->die ;
+    if (!may_define (name)) {
+        return NULL ;
+    }
+    wait() ;
+    expand_units (name) ;
+    Symbol **s = structs.find (string_pool.find (name)) ;
+    if (s != NULL) {
+        return (*s)->get_die() ;
     }
     return NULL ;
 }
 
 // skip the preamble for a function at the given address
 Address SymbolTable::skip_preamble (Address addr) {
-    int start = 0 ;
-    int end = lineaddresses.size() - 1 ;
-    int foundindex = -1 ;
-
+    wait() ;
+    expand_unit_at (addr - get_base()) ;
     FunctionLocation *func = find_function_by_address (addr) ;
 
-    while (start <= end) {
-        int mid = (end + start) / 2 ;
-        if (addr == lineaddresses[mid]->address) {
-            foundindex = mid ;
-            break ;
-        }
-        if (addr < lineaddresses[mid]->address) {
-            end = mid - 1 ;
-        } else {
-            start = mid + 1 ;
-        }
-    }
-    if (foundindex == -1) {             // not found?
+    int row = line_table.find_next_address (addr) ;
+    if (row == -1) {                    // not found?
         return 0 ;
     }
-    int size = lineaddresses.size() ;
-    while (foundindex < size) {
-        if (lineaddresses[foundindex]->address != addr) {
-            break ;
-        }
-        foundindex++ ;
-    }
-    if (foundindex < size) {
-        Address newaddr = lineaddresses[foundindex]->address ;
-        FunctionLocation *newfunc = find_function_by_address (newaddr) ;                // must be in same function
-        if (newfunc != func) {
-            return 0 ;
-        }
-        return lineaddresses[foundindex]->address ;
+    Address newaddr = line_table.get_address (row) ;
+    FunctionLocation *newfunc = find_function_by_address (newaddr) ;            // must be in same function
+    if (newfunc != func) {
+        return 0 ;
     }
-    return 0 ;
+    return newaddr ;
 }
 
 // we don't want to print an address if the pc is at the first line of a function.  The first
 // line is actually the second line held in the line table.
 bool SymbolTable::at_first_line (FunctionLocation *func, Address addr) {
-    int start = 0 ;
-    int end = lineaddresses.size() - 1 ;
-    int foundindex = -1 ;
+    wait() ;
     Address saddr = func->get_start_address() ;                 // start address of function
 
-    while (start <= end) {
-        int mid = (end + start) / 2 ;
-        if (saddr == lineaddresses[mid]->address) {
-            foundindex = mid ;
-            break ;
-        }
-        if (saddr < lineaddresses[mid]->address) {
-            end = mid - 1 ;
-        } else {
-            start = mid + 1 ;
-        }
-    }
-    if (foundindex == -1) {             // not found?
+    // find the line after the one at the start
+    int row = line_table.find_next_address (saddr) ;
+    if (row == -1) {                    // not found?
         return false ;
     }
-
-    // now find the next line
-    int size = lineaddresses.size() ;
-    while (foundindex < size) {
-        if (lineaddresses[foundindex]->address != saddr) {
-            break ;
-        }
-        foundindex++ ;
-    }
-
-    if (foundindex < size) {
-        Address newaddr = lineaddresses[foundindex]->address ;
-        FunctionLocation *newfunc = find_function_by_address (newaddr) ;                // must be in same function
-        if (newfunc != func) {
-            return false ;
-        }
-        return lineaddresses[foundindex]->address == addr ;
+    Address newaddr = line_table.get_address (row) ;
+    FunctionLocation *newfunc = find_function_by_address (newaddr) ;            // must be in same function
+    if (newfunc != func) {
+        return false ;
     }
-    return 0 ;
+    return newaddr == addr ;
 }
 
 // is the address at the start of a function?
 bool SymbolTable::is_at_function_start (Address addr) {
+    wait() ;
     int start = 0 ;
     int end = function_start_addresses.size() - 1 ;
 
@@ -757,18 +1426,23 @@ bool SymbolTable::is_at_function_start (Address addr) {
 }
 
 bool SymbolTable::find_function (std::string name, int offset, std::string &filename, int &lineno) {
-    SymbolMap::iterator i = functions.find (name) ;
-    if (i == functions.end()) {
+    if (!may_define (name)) {
+        return false ;
+    }
+    wait() ;
+    expand_units (name) ;
+    Symbol **i = functions.find (string_pool.find (name)) ;
+    if (i == NULL) {
         //printf ("function not found\n") ;
         return false ;
     }
-    DIE *func = i->second->die ;
+    DIE *func = (*i)->get_die() ;
     Address lowpc = (Address)func->getAttribute (DW_AT_low_pc) + get_base() ;         // get start address for function
     Address addr = lowpc + offset ;
     Location loc = find_address (addr, true) ;
     if (loc.get_file() != NULL) {
         char buf[1024] ;
-        DirectoryTable &dirtab = loc.get_lineinfo()->cu->get_directory_table() ;
+        DirectoryTable &dirtab = loc.get_unit()->get_directory_table() ;
         std::string dirname = dirtab[loc.get_file()->dir] ;
         if (dirname != "") {
            dirname += '/' ;
@@ -783,47 +1457,42 @@ bool SymbolTable::find_function (std::string name, int offset, std::string &file
 }
 
 // given a file and line, return the address at the start of the line
-// look up the mapping of filename vs vector of LineInfo and then
-// use a binary search to find the address held in the LineInfo
-// object
 
 Address SymbolTable::find_line (std::string filename, int lineno) {
+    wait() ;
     std::string::size_type slash = filename.rfind ('/') ;
     if (slash != std::string::npos) {
         filename = filename.substr (slash+1) ;
     }
-    FileMap::iterator fi = files.find (filename) ;
-    if (fi == files.end()) {
-       return 0 ;
-    }
-    int start = 0 ;
-    LineInfoVec &lines = *fi->second ;
-    int end = lines.size() - 1 ;
-
-    while (start <= end) {
-        int mid = (end + start) / 2 ;
-        if (lineno == lines[mid]->lineno) {
-            return lines[mid]->address ;
-        }
-        if (lineno < lines[mid]->lineno) {
-            end = mid - 1 ;
-        } else {
-            start = mid + 1 ;
-        }
+    expand_file_lines (filename) ;
+    int row = line_table.find_line (filename, lineno) ;
+    if (row == -1) {
+        return 0 ;
     }
-    return 0 ;
+    return line_table.get_address (row) ;
 }
 
 void SymbolTable::enumerate_functions (std::string name, std::vector<std::string> &results) {
-    std::pair<BaseMap::iterator,BaseMap::iterator> p = cpp_basenames.equal_range (name) ;
+    if (!may_define (name)) {
+        return ;
+    }
+    wait() ;
+    expand_units (name) ;
+    // only the last component of some names is indexed, so a qualified
+    // name is looked for among the demangled names with its last component
+    int n = 1 ;
+    std::string base = name.find ("::") == std::string::npos ? name : get_cpp_basename (name.c_str(), n) ;
+    std::pair<BaseMap::iterator,BaseMap::iterator> p = cpp_basenames.equal_range (base) ;
     while (p.first != p.second) {
-        results.push_back ((*p.first).second) ;
+        const char *demangled = aliases->demangle ((*p.first).second) ;
+        if (demangled != NULL && (base == name || has_cpp_basename (demangled, name))) {
+            results.push_back (demangled) ;
+        }
         p.first++ ;
     }
 
     // there might be regular function with the same name.  If so, add it
-    SymbolMap::iterator i = functions.find (name) ;
-    if (i != functions.end()) {
+    if (functions.find (string_pool.find (name)) != NULL) {
         results.push_back (name) ;
     }
 
@@ -834,10 +1503,10 @@ void SymbolTable::enumerate_functions (std::string name, std::vector<std::string
 }
 
 DwCUnit *SymbolTable::find_compilation_unit (std::string name) {
+    wait() ;
     for (uint i = 0 ; i < compilation_units.size() ; i++) {
         DwCUnit *cu = compilation_units[i] ;
-        DIE *die = cu->get_cu_die() ;
-        std::string cu_name = die->get_name() ;
+        std::string cu_name = cu->get_name() ;
         std::string::size_type slash = cu_name.rfind ('/') ;
         if (slash != std::string::npos) {
             cu_name = cu_name.substr (slash+1) ;
@@ -851,6 +1520,7 @@ DwCUnit *SymbolTable::find_compilation_unit (std::string name) {
 
 
 void SymbolTable::list_source_files (PStream &os, uint width) {
+    wait() ;
     uint x = 0 ;
     bool comma = false ;
     std::set<std::string> done ;
@@ -875,30 +1545,24 @@ void SymbolTable::list_source_files (PStream &os, uint width) {
     os.print ("\n") ;
 }
 
-// complete the name of a function.  The name comes from the aliases table and
-// the cpp_basenames table
-void SymbolTable::complete_function (std::string name, std::vector<std::string> &result) {
-
-    // look in aliases
-    aliases->complete (name, result) ;
-
-    // look in C++ basenames
-    for (BaseMap::iterator i = cpp_basenames.begin() ; i != cpp_basenames.end() ; i++) {
-        if (strncmp (i->first.c_str(), name.c_str(), name.size()) == 0) {
-            result.push_back (i->first.substr (name.size())) ;
-        }
+// the functions, C++ basenames and demangled names, and Fortran names
+// starting with name.  The completions are kept sorted, so this costs a
+// binary search and the names it returns.  A deferred table isn't read
+// for this.
+void SymbolTable::complete_function (std::string name, std::vector<std::string> &result, int limit) {
+    if (!deferred) {
+        wait() ;
+        expand_units_with_prefix (name) ;
     }
-
-    // look in the function map
-    for (SymbolMap::iterator i = functions.begin() ; i != functions.end() ; i++) {
-        if (strncmp (i->first.c_str(), name.c_str(), name.size()) == 0) {
-            result.push_back (i->first.substr (name.size())) ;
-        }
+    if (cxx_aliases) {
+        complete_demangled (name) ;
     }
 
+    completions.complete (name.c_str(), result, limit) ;
 }
 
 File *SymbolTable::find_file (std::string name) {
+    wait() ;
     for (uint i = 0 ; i < compilation_units.size() ; i++) {
         DwCUnit *cu = compilation_units[i] ;
         FileTable &files = cu->get_file_table() ;
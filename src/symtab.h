@@ -36,6 +36,11 @@ author: David Allison <dallison@pathscale.com>
 #include "file_info.h"
 #include "pstream.h"
 #include "gen_loc.h"
+#include "map_intern.h"
+#include "map_range.h"
+#include "map_string.h"
+
+#include <pthread.h>
 
 // imported classes
 class Process ;
@@ -43,14 +48,14 @@ class Frame ;
 class Architecture ;
 class EvalContext ;
 
+class SymbolTable ;
+
 //
-// alias object (holds aliases of symbol names)
+// alias object (holds aliases of symbol names).  The names are in the
+// string pool.  Aliases are made when they are first asked for: a C++
+// name is demangled when it is looked up, and the symbol tables (the
+// sources) are asked for other names.
 //
-struct cstring_less {
-    bool operator() (const char *s1, const char *s2) {
-        return strcmp (s1,s2) < 0 ;
-    }
-} ;
 
 class AliasManager {
 public:
@@ -60,22 +65,32 @@ public:
     void unlock() ;
     void add_alias (const char *name, const char *alias) ;
     const char *find_alias(const char *alias) ;
+    const char *demangle (const char *mangled) ;       // pooled, or NULL if it can't be demangled
+    void set_demangled (const char *mangled, const char *demangled) ;   // what the demangler made of it
+    void add_source (SymbolTable *symtab) ;
+    void remove_source (SymbolTable *symtab) ;
     void list_aliases() ;
-    void complete (std::string name, std::vector<std::string> &result) ;
 private:
-    //typedef __gnu_cxx::hash_map<const char *, const char *, cstring_equal_to> AliasMap ;
-    typedef std::map<const char *, const char *, cstring_less> AliasMap ;
+    const char *demangle_locked (const char *mangled) ;
+    const char *set_demangled_locked (const char *key, const char *demangled) ;
+
+    pthread_mutex_t mutex ;             // symbol tables add aliases while loading in the background
+    typedef Map_Intern<const char *> AliasMap ;
     AliasMap aliases ;
+    Map_Intern<bool> undemangled ;      // names the demangler failed on
+    std::vector<SymbolTable *> sources ;
 } ;
 
-class SymbolTable ;
-
 class Symbol {
 public:
-    Symbol(std::string name, DIE * die) ;
+    Symbol(const char *name, DIE * die) ;                      // name is in the string pool
+    Symbol(const char *name, DwCUnit *cu, Offset offset) ;     // DIE not read yet
     ~Symbol() ; 
-    std::string name ; 
+    DIE *get_die() ;
+    const char *name ; 
     DIE * die ; 
+    DwCUnit *cu ;                       // where to find the DIE if it hasn't been read
+    Offset offset ;
 } ;
 
 
@@ -84,13 +99,37 @@ public:
 // the symbol table provides a number of indexes to allow quick searches
 // of the data.
 // XXX: describe the indexes here
+//
+// A symbol table can be read on a background thread.  Every query waits
+// for the read to finish, so the caller only blocks on the table it needs.
+//
+// The debug information of a stripped object is read from a separate
+// debug file, found by its build-id or .gnu_debuglink under the debug
+// file directory.
+//
+// The debug information of a shared library can be deferred until it is
+// needed: by a query by address, file or line, or by a query by name that
+// the library's ELF symbols say it may define.  Until then only its ELF
+// symbols are used, and its frames are read when they are first searched.
+//
+// Only the root DIE and the line table header of each compilation unit is
+// read up front, so the symbol maps and the line table only hold what is in
+// the units expanded so far.  A query by address first expands the unit
+// holding the address, and a query by file:line reads the line tables of
+// the units using the file.  A query by name expands the units a
+// .gdb_index says define it, or all the units if there is no index.
 
 class SymbolTable: public DwInfo  {
 public:
-    SymbolTable(Architecture *arch, ELF * elf, std::istream & stream, AliasManager *aliases, PStream *os = NULL, bool reporterror = false) ;
+    SymbolTable(Architecture *arch, ELF * elf, std::istream & stream, AliasManager *aliases, PStream *os = NULL, bool reporterror = false,
+                bool parallel = false, bool background = false, bool usecache = false, bool deferred = false,
+                std::string debugdir = "") ;
     ~SymbolTable() ; 
+    bool is_ready() ;                   // has the background read finished?
+    bool is_deferred() { return deferred ; }            // debug information not read yet
+    int get_progress() ;                // percentage of the debug info read so far
+    FDE *find_fde (Address addr) ;
     Location  find_address (Address addr, bool guess) ;
-    LineInfo * get_line_info (Address address) ;
     void list_functions (EvalContext &context) ;
     void list_variables (EvalContext &context) ;
     void list_source_files (PStream &os, uint width) ;
@@ -119,31 +158,42 @@ public:
     bool find_function (std::string name, int offset, std::string &filename, int &lineno) ;          // find filename:lineno for function+offset
     Address find_line (std::string filename, int line) ;
     std::string find_alias (std::string name) ;
+    const char *make_alias (const char *name) ;         // for the AliasManager; NULL if none
     void enumerate_functions (std::string name, std::vector<std::string> &result) ;
     DwCUnit *find_compilation_unit (std::string name) ;
-    void complete_function (std::string name, std::vector<std::string> &result) ;
+    void complete_function (std::string name, std::vector<std::string> &result, int limit = 0) ;   // at most limit per source if > 0
     Architecture *arch ;
 
     File *find_file (std::string name) ;
 protected:
 private:
-    void read(PStream *os, bool reporterror) ;
+    friend class SymbolCache ;
+
+    void read(PStream *os, bool reporterror, bool parallel) ;
     void wait() ;                       // wait for symbol table to become ready
+    static void *read_thread (void *arg) ;
+    void read_quietly() ;
+    void open_debug_file (std::string debugdir) ;
+    bool try_debug_file (std::string path, std::string id, bool checkcrc, uint32_t crc) ;
+    void discard() ;
+    bool may_define (const std::string &name) ;        // false if deferred and not in the ELF symbols
+
+    PStream *os ;
+    bool parallel ;
+    bool usecache ;                     // read and write the symbol cache
+    bool loading ;                      // background thread not yet joined
+    bool deferred ;                     // debug information to be read when needed
+    bool failed ;                       // background read threw an exception
+    int done ;                          // set by the background thread when it finishes
+    pthread_t loader ;
 
     FunctionLocation * find_function_by_address (Address addr) ;
 
-    typedef std::map<std::string, Symbol *> SymbolMap ;
-    typedef std::vector<LineInfo*> LineInfoVec ;
-
-    // for looking up file:line we need a mapping of filename vs array of lines, sorted by linenum
-    typedef std::map<std::string, LineInfoVec*> FileMap ;
+    typedef Map_Intern<Symbol *> SymbolMap ;             // keyed on the pooled name
 
     SymbolMap functions ; 
     SymbolMap variables ; 
     SymbolMap structs ; 
-    FileMap files ;
-
-    LineInfoVec lineaddresses ; // vector of LineInfo, sorted on address
 
     Map_Range<Address,FunctionLocation*> funcmap;
 
@@ -153,13 +203,27 @@ private:
 
     void do_cxx_alias();
     void do_f90_alias();
+    const char *find_cxx_alias (const char *name) ;
+    const char *find_f90_alias (const char *name) ;
+    bool cxx_aliases ;                  // are there C++ or Fortran names to make aliases for?
+    bool f90_aliases ;
+    Map_Intern<bool> no_alias ;         // names make_alias found nothing for
+    typedef std::multimap<std::string, const char*> BaseMap ;
+    void complete_demangled (const std::string &prefix) ;
+    BaseMap partial_names ;             // C++ symbols indexed only by their last component,
+                                        // by the start of their demangled names
+    Map_Intern<bool> demangled_completions ;    // demangled names already in completions
 
     void register_subprogram (std::string name, DIE *die) ;
     void register_symbol (std::string name, DIE *die) ;
     void register_struct (std::string name, DIE *die) ;
+    void all_units_read() ;
+    void find_symbol_addresses (std::string name, std::vector<Address> &addrs) ;
+    void find_prefix_addresses (std::string prefix, std::vector<Address> &addrs) ;
+    bool replaces (SymbolMap &map, const char *name, DIE *die) ;
 
-    typedef std::multimap<std::string, const char*> BaseMap ;
-    BaseMap cpp_basenames ;
+    BaseMap cpp_basenames ;             // vs the mangled name, in the ELF string table
+    Map_String<bool> completions ;      // function, C++ and Fortran names, sorted for completion
 public:
     //DirectoryTable &dirlist ;
 
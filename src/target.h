@@ -77,6 +77,7 @@ public:
     virtual void write (int pid, Address addr, Address data, int size=4) = 0 ;   // write a word
     virtual Address read (int pid, Address addr, int size=4) = 0 ;           // read a number of words
     virtual Address readptr (int pid, Address addr) = 0 ;
+    virtual bool read_block (int pid, Address addr, char *buf, int len) { return false ; }     // read len bytes at once if the target can
     virtual void get_regs(int pid, RegisterSet *regs) = 0 ;               // get register set
     virtual void set_regs(int pid, RegisterSet *regs) = 0 ;
     virtual void get_fpregs(int pid, RegisterSet *regs) = 0 ;               // get floating point register set
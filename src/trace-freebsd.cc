@@ -59,6 +59,21 @@ unsigned long Trace::read_data (pid_t pid, void *addr) {
     return read_word ;
 }
 
+int Trace::read_block (pid_t pid, void *addr, void *buf, size_t len) {
+    struct ptrace_io_desc io ;
+    io.piod_op = PIOD_READ_D ;
+    io.piod_offs = addr ;
+    io.piod_addr = buf ;
+    io.piod_len = len ;
+    if (ptrace (PT_IO, pid, (caddr_t)&io, 0) < 0 || io.piod_len != len) {
+        return -1 ;
+    }
+    return 0 ;
+}
+
+void Trace::release (pid_t pid) {
+}
+
 int Trace::write_data (pid_t pid, void *addr, unsigned long data) {
     int ret_val = 0 ;
     int n_writes = int(sizeof (long) / sizeof (int)) ;
@@ -3,6 +3,9 @@
 #include "trace.h"
 #include <endian.h>
 #include <sys/user.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
 
 /* find the offset of X into struct user (from sys/user.h) */
 #define STRUCT_USER_OFFSET(X) (&(((struct user*)0)->X))
@@ -47,6 +50,34 @@ unsigned long Trace::read_data (pid_t pid, void *addr) {
     return ptrace (PTRACE_PEEKDATA, pid, addr, 0) ;
 }
 
+/* /proc/<pid>/mem of the process last read, kept open until it is resumed */
+static pid_t mem_pid = -1 ;
+static int mem_fd = -1 ;
+
+void Trace::release (pid_t pid) {
+    if (mem_fd >= 0) {
+        close (mem_fd) ;
+        mem_fd = -1 ;
+        mem_pid = -1 ;
+    }
+}
+
+/* read a block of memory in one go through /proc, which a tracer can read */
+int Trace::read_block (pid_t pid, void *addr, void *buf, size_t len) {
+    if (mem_fd < 0 || mem_pid != pid) {
+        release (mem_pid) ;
+        char path[32] ;
+        snprintf (path, sizeof (path), "/proc/%d/mem", (int)pid) ;
+        mem_fd = open (path, O_RDONLY | O_CLOEXEC) ;
+        if (mem_fd < 0) {
+            return -1 ;
+        }
+        mem_pid = pid ;
+    }
+    ssize_t n = pread (mem_fd, buf, len, (off_t)(unsigned long)addr) ;
+    return n == (ssize_t)len ? 0 : -1 ;
+}
+
 int Trace::write_data (pid_t pid, void *addr, unsigned long data) {
     return ptrace (PTRACE_POKEDATA, pid, addr, (void *)data) ;
 }
@@ -39,18 +39,22 @@ int Trace::attach (pid_t pid) {
 }
 
 int Trace::detach (pid_t pid) {
+    release (pid) ;
     return (int)ptrace (PT_DETACH, pid, 0, 0) ;
 }
 
 int Trace::kill (pid_t pid) {
+    release (pid) ;
     return (int)ptrace (PT_KILL, pid, 0, 0) ;
 }
 
 int Trace::cont (pid_t pid, int signal) {
+    release (pid) ;
     return (int)ptrace (PT_CONTINUE, pid, (caddr_t)1, signal) ;
 }
 
 int Trace::single_step (pid_t pid) {
+    release (pid) ;
     return (int)ptrace (PT_STEP, pid, caddr_t (1), 0) ;
 }
 
@@ -52,6 +52,8 @@ public:
     static int set_dbgreg (pid_t pid, int idx, unsigned long val) ;
     static unsigned long read_data (pid_t pid, void *addr) ;
     static unsigned long read_text (pid_t pid, void *addr) ;
+    static int read_block (pid_t pid, void *addr, void *buf, size_t len) ;
+    static void release (pid_t pid) ;           // the process is resumed or let go
     static int write_data (pid_t pid, void *addr, unsigned long data) ;
     static int write_text (pid_t pid, void *addr, unsigned long data) ;
     static int set_options (pid_t pid, long opts) ;
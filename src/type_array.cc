@@ -33,6 +33,96 @@ author: David Allison <dallison@pathscale.com>
 #include "type_array.h"
 #include "dwf_cunit.h"
 
+#include <string.h>
+
+/*
+ * The elements of the last dimension of an array, read from the process a
+ * block at a time rather than one by one.  A block holds as many elements
+ * as can be printed, or more if they repeat.  If a block can't be read
+ * whole its elements are read one at a time, so that the elements before
+ * an unreadable one are still printed.
+ */
+class ElementBlock {
+ public:
+   ElementBlock(EvalContext & context, DIE * type, Address addr, int stride,
+		int count, int limit);
+   Address get(int i);		// throws Exception
+   int run(int i, int end);	// elements after i with the same bytes
+
+ private:
+   enum { MAX_BYTES = 65536 };
+   bool fill(int i);		// false if i isn't in a block read whole
+
+   EvalContext & context;
+   Address addr;
+   int size;
+   int stride;
+   int count;
+   int limit;			// elements in a block
+   std::vector<char> data;
+   int first;			// first element in data
+   int n;
+   bool whole;
+};
+
+ElementBlock::ElementBlock(EvalContext & context, DIE * type, Address addr,
+			   int stride, int count, int limit)
+:  context(context), addr(addr), size(type->get_size()), stride(stride),
+count(count), limit(limit < 64 ? 64 : limit), first(0), n(0), whole(false)
+{
+}
+
+bool
+ElementBlock::fill(int i)
+{
+   if (i >= first && i < first + n) {
+      return whole;
+   }
+   first = i;
+   n = 1;
+   whole = false;
+   if (size <= 0 || size > (int) sizeof(Address) || stride < size) {
+      return false;
+   }
+   n = count - i;
+   if (n > limit) {
+      n = limit;
+   }
+   if (n > (MAX_BYTES - size) / stride + 1) {
+      n = (MAX_BYTES - size) / stride + 1;
+   }
+   data.resize((n - 1) * stride + size);
+   whole = context.process->read_block(addr + (Address) i * stride, &data[0], data.size());
+   return whole;
+}
+
+Address
+ElementBlock::get(int i)
+{
+   if (!fill(i)) {
+      return context.process->read(addr + (Address) i * stride, size);
+   }
+   Address v = 0;
+   memcpy(&v, &data[(i - first) * stride], size);
+   return v;
+}
+
+int
+ElementBlock::run(int i, int end)
+{
+   char elem[sizeof(Address)];
+   if (!fill(i)) {
+      return 0;
+   }
+   memcpy(elem, &data[(i - first) * stride], size);
+   int r = 0;
+   while (i + r + 1 < end && fill(i + r + 1)
+	  && memcmp(&data[(i + r + 1 - first) * stride], elem, size) == 0) {
+      r++;
+   }
+   return r;
+}
+
 TypeArray::TypeArray(DwCUnit * cu, DIE * parent,
 		     Abbreviation * abbrev)
 :  DIE(cu, parent, abbrev), dimsok(false)
@@ -218,7 +308,7 @@ std::vector < Dimension > &TypeArray::get_dims(EvalContext & ctx)
 	 if ((ctx.language & 0xff) ==  DW_LANG_Fortran77 || (ctx.language & 0xff) ==  DW_LANG_Fortran90 || (ctx.language & 0xff) ==  DW_LANG_Fortran95) {
 		lb = 1;
 	 }
-	 AttributeValue & lowerbound =
+	 AttributeValue lowerbound =
 	     child->getAttribute(DW_AT_lower_bound);
 	 if (lowerbound.type != AV_NONE) {	// lower bound present?
 	    if (lowerbound.type == AV_DIE) {
@@ -239,7 +329,7 @@ std::vector < Dimension > &TypeArray::get_dims(EvalContext & ctx)
 	 }
 	else
 		notset = true;
-	 AttributeValue & upperbound =
+	 AttributeValue upperbound =
 	     child->getAttribute(DW_AT_upper_bound);
 	 if (upperbound.type != AV_NONE) {	// upper bound present?
 	    if (upperbound.type == AV_DIE) {
@@ -428,6 +518,8 @@ TypeArray::print_dim_c(EvalContext & context, TypeArray * array,
    Value last_value;
    bool lv_valid = false;
    int nrepeats = 0;
+   ElementBlock block(context, type, addr, phi, array->dims[dim].size(),
+		      maxelem + 1);
 
    // for each element in the dimension
    bool comma = false;
@@ -440,10 +532,7 @@ TypeArray::print_dim_c(EvalContext & context, TypeArray * array,
 	    val = dimaddr;
 	 } else {
 	    try {
-	       val = context.process->read(dimaddr, type->get_size());	// get 
-									// value 
-									// of 
-									// variable
+	       val = block.get(i);	// get value of variable
 	    }
 	    catch(Exception e) {
 	       context.os.print("<%s>}", e.get().c_str());
@@ -456,9 +545,12 @@ TypeArray::print_dim_c(EvalContext & context, TypeArray * array,
 	       val.type = VALUE_REAL;
 	    }
 	 }
-	 // if value is repeat, inc count and don't print
+	 // if value is repeat, inc count and don't print.  The elements
+	 // after it with the same bytes are the same value too
 	 if (lv_valid && val == last_value) {
-	    nrepeats++;
+	    int r = block.run(i, array->dims[dim].size());
+	    nrepeats += r + 1;
+	    i += r;
 	 } else {
 	    // value is different from previous, flush accumulated repeats
 	    if (nrepeats > 0) {
@@ -575,6 +667,8 @@ TypeArray::print_dim_fortran(EvalContext & context, TypeArray * array,
 
 	if (array->dims[dim].notset)
 		addr = context.process->read(addr, sizeof(char *));
+   ElementBlock block(context, type, addr, phi, array->dims[dim].size(),
+		      maxelem + 1);
 
    // for each element in the dimension
    bool comma = false;
@@ -592,10 +686,8 @@ TypeArray::print_dim_fortran(EvalContext & context, TypeArray * array,
 	    val = dimaddr;
 	 } else {
 	    try {
-	       val = context.process->read(dimaddr, type->get_size());	// get 
-									// value 
-									// of 
-									// variable
+	       val = block.get(i - array->dims[dim].low);	// get value of
+								// variable
 	    }
 	    catch(Exception e) {
 	       context.os.print("<%s>)", e.get().c_str());
@@ -612,7 +704,16 @@ TypeArray::print_dim_fortran(EvalContext & context, TypeArray * array,
 	 }
 	 if (lv_valid && val == last_value) {	// if value is repeat, inc 
 						// count and don't print
-	    nrepeats++;
+	    // the elements after it with the same bytes are repeats too,
+	    // as far as the number of elements to print
+	    int r = block.run(i - array->dims[dim].low,
+			      array->dims[dim].size());
+	    if (r > maxelem) {
+	       r = maxelem;
+	    }
+	    maxelem -= r;
+	    nrepeats += r + 1;
+	    i += r;
 	 } else {
 	    // value is different from previous, flush accumulated repeats
 	    if (nrepeats > 0) {
@@ -39,30 +39,31 @@ author: David Allison <dallison@pathscale.com>
 #include "dwf_cunit.h"
 
 
-// given an attribute value that should contain a pointer to a DIE, make it that
-// it does.  The DIE may or may not be loaded already.  If it is, the ptr
-// will contain the actual DIE pointer.  If it isn't loaded, the ptr will contain
-// the offset into the dwarf_info section that contains the die.  This offset should
-// be in the range of a 'lazy DIE' (one that has not been loaded yet).  That lazy
-// DIE should be loaded.  The act of loading it will cause the attribute's value to
-// be fixed up with the DIE pointer.
+// given an attribute value that refers to a DIE, find the DIE.  The value
+// is the offset of the DIE in the unit.  The DIE may or may not be loaded
+// already.  If it isn't loaded, the offset should be in the range of a 'lazy
+// DIE' (one whose children have not been loaded yet).  That lazy DIE is
+// loaded, which reads the DIE we want.
 
 static DIE *
-dereference_die_reference(DwCUnit * cu, Attribute * attr)
+dereference_die_reference(DwCUnit * cu, const AttributeValue & ptr)
 {
    //printf ("dereferencing DIE reference\n") ;
-   AttributeValue & ptr = attr->value;
    if (ptr.type == AV_DIE) {
-      if ((DIE *) ptr == NULL) {
+      if (ptr.die == NULL) {
 	 printf("DIE *attribute has not been fixed up\n");
       }
-      return ptr;
+      return ptr.die;
    }
    if (ptr.type != AV_INTEGER) {	// this must be an offset
       printf("DIE *attribute has an illegal type");
       throw Exception("bad DIE reference");
    }
-   Offset offset = ptr;
+   Offset offset = ptr.integer;
+   DIE *die = cu->lookup_die(offset);
+   if (die != NULL) {
+      return die;
+   }
    DIE *lazy = cu->find_lazy_die(offset);
    if (lazy == NULL) {
       return NULL;
@@ -71,56 +72,36 @@ dereference_die_reference(DwCUnit * cu, Attribute * attr)
       //throw Exception("bad DIE reference");
    }
    lazy->check_loaded();	// load it if necessary
-   if (attr->value.type != AV_DIE) {
-      DIE *v = cu->get_die(attr, offset);
-      if (v == NULL) {
-	 printf
-	     ("Lazy DIE did not set attribute value (ptr=%llx)\n",
-	      (unsigned long long) ptr.integer);
-	 throw Exception("bad DIE reference");
-      } else {
-	 return v;
-      }
-   }
-   return attr->value;
-}
-
-// a DIE is being referenced.  If it exists, return a pointer to it.  If it doesn't
-// return the offset to it (a fixup will have been added in get_die)
-
-static AttributeValue
-get_die_reference(DwCUnit * cu, Attribute * attr, Offset offset)
-{
-   DIE *die = cu->get_die(attr, offset);
+   die = cu->lookup_die(offset);
    if (die == NULL) {
-      return offset;
+      printf
+	  ("Lazy DIE did not read referenced DIE (ptr=%llx)\n",
+	   (unsigned long long) ptr.integer);
+      throw Exception("bad DIE reference");
    }
    return die;
 }
 
 DIE::DIE(DwCUnit * cu, DIE * parent, Abbreviation * abbrev)
-:  cu(cu),
+:  added(NULL),
+cu(cu),
 parent(parent),
-abbrev(abbrev),
-id(0), tag(0), children_offset(0), more_info(NULL), definition(NULL)
+abbrev(abbrev), id(0), tag(0), children_offset(0), more_info(NULL), definition(NULL)
 {
 }
 
 DIE::DIE(DwCUnit * cu, DIE * parent, int tag)
-:  cu(cu),
+:  added(NULL),
+cu(cu),
 parent(parent),
-abbrev(NULL),
-id(0), tag(tag), children_offset(0), more_info(NULL), definition(NULL)
+abbrev(NULL), id(0), tag(tag), children_offset(0), more_info(NULL), definition(NULL)
 {
 }
 
 DIE::~DIE()
 {
    // don't delete the children as these are done by the DwCUnit
-   for (AttributeMap::iterator i = attributes.begin();
-	i != attributes.end(); ++i) {
-      delete i->second;
-   }
+   delete added;
 }
 
 int
@@ -155,40 +136,6 @@ bool DIE::is_case_blind()
    return lang == DW_LANG_Fortran77 || lang == DW_LANG_Fortran90 || lang == DW_LANG_Fortran95;
 }
 
-// this is like reading a normal Attribute, except we need to know what the offset is
-Offset
-DIE::read_sibling(DwCUnit * cu, AttributeAbbreviation * attrabbrev,
-		      Attribute * attr, BStream & stream)
-{
-   int form = attrabbrev->getForm();
-   Offset offset;
-   switch (form) {
-   case DW_FORM_ref1:{
-	 offset = stream.read1u();
-	 attr->value = get_die_reference(cu, attr, offset);
-	 break;
-      }
-   case DW_FORM_ref2:{
-	 offset = stream.read2u();
-	 attr->value = get_die_reference(cu, attr, offset);
-	 break;
-      }
-   case DW_FORM_ref4:{
-	 offset = stream.read4u();
-	 attr->value = get_die_reference(cu, attr, offset);
-	 break;
-      }
-   case DW_FORM_ref8:{
-	 offset = stream.read8u();
-	 attr->value = get_die_reference(cu, attr, offset);
-	 break;
-      }
-   default:
-      throw Exception("unexpected form for sibling attribute");
-   }
-   return offset;
-}
-
 // I want to be able to skip structures as they speed up C++ loading a lot
 // but if I do this there is no way to load the subprograms inside them
 
@@ -223,42 +170,8 @@ bool DIE::is_skippable()
 void
  DIE::read(DwCUnit * cu, BStream & stream, bool readall)
 {
-   id = stream.offset();
-   // read the attribute values
-   int nattrs = abbrev->getNumAttributes();
-   bool sibling_present = false;
    Offset sibling = 0;
-   for (int i = 0; i < nattrs; i++) {;
-      AttributeAbbreviation * attrabbrev = abbrev->getAttribute(i);
-      Attribute * attr;
-      
-      if (attrabbrev->getTag() == DW_AT_specification ||
-          attrabbrev->getTag() == DW_AT_abstract_origin) {
-         attr = new FixupAttribute(attrabbrev->getForm(), this);
-      } else {
-         attr = new Attribute (attrabbrev->getForm());
-      }
-
-      int attrtag = attrabbrev->getTag();
-      if (attrtag == DW_AT_sibling) {
-	 sibling_present = true;
-	 sibling = read_sibling(cu, attrabbrev, attr, stream) + cu->start_offset;
-      } else if (attrtag == DW_AT_specification
-		 || attrtag == DW_AT_abstract_origin) {
-	 attr->value = attrabbrev->read(cu, attr, stream);
-	 // if the referenced DIE hasn't been read yet, a fixup is added for it.
-	 if (attr->value.type == AV_DIE) {
-	    DIE * d = attr->value;
-	    if (d != NULL) {
-	       d->set_more_info(this);
-	    }
-	 }
-      } else {
-	 attr->value = attrabbrev->read(cu, attr, stream);
-      }
-      //std::cout << "attribute value (type:" << attr->value.type << ", value: " << attr->value << ")\n" ;
-      attributes[attrtag] = attr;
-   }
+   bool sibling_present = read_attributes(cu, stream, sibling);
 
    // read the children
    if (abbrev->has_children()) {
@@ -268,14 +181,67 @@ void
 
       if (!readall && sibling_present && is_skippable()) {
 	 children_offset = stream.offset();
-	 cu->add_lazy_die(this, children_offset - cu->start_offset,
-			  sibling - cu->start_offset);
+	 cu->add_lazy_die(this, children_offset - cu->stream_offset,
+			  sibling - cu->stream_offset);
 
 	 //printf ("%x skipping to sibling at offset %x\n", id, sibling) ;
 	 stream.seek(sibling);	// move to the sibling
 	 return;
       }
+   }
+   read_children(cu, stream);
+}
+
+// move past the attribute values.  They are decoded when they are asked
+// for, so only the links to other DIEs are looked at here.  Returns true if
+// there is a DW_AT_sibling, whose section offset is put in sibling
+
+bool
+ DIE::read_attributes(DwCUnit * cu, BStream & stream, Offset & sibling)
+{
+   id = stream.offset();
+   int size = abbrev->get_size(cu->getAddrSize());
+   if (size >= 0 && !abbrev->has_links()) {
+      stream.seek(size, BSTREAM_CUR);
+      return false;
+   }
 
+   int nattrs = abbrev->getNumAttributes();
+   bool sibling_present = false;
+   for (int i = 0; i < nattrs; i++) {
+      AttributeAbbreviation * attrabbrev = abbrev->getAttribute(i);
+      int attrtag = attrabbrev->getTag();
+      if (attrtag == DW_AT_sibling) {
+	 if (!attrabbrev->is_reference()) {
+	    throw Exception("unexpected form for sibling attribute");
+	 }
+	 sibling_present = true;
+	 sibling = attrabbrev->read(cu, stream).integer + cu->stream_offset;
+      } else if ((attrtag == DW_AT_specification
+		  || attrtag == DW_AT_abstract_origin)
+		 && attrabbrev->is_reference()) {
+	 // the referenced DIE gets a pointer back to this one.  If it
+	 // hasn't been read yet, a fixup is added for it.
+	 Offset offset = attrabbrev->read(cu, stream).integer;
+	 DIE * d = cu->lookup_die(offset);
+	 if (d != NULL) {
+	    d->set_more_info(this);
+	 } else {
+	    cu->add_fixup(offset, this);
+	 }
+      } else {
+	 attrabbrev->skip(cu, stream);
+      }
+   }
+   return sibling_present;
+}
+
+// read the children that follow the attributes in the stream
+
+void
+ DIE::read_children(DwCUnit * cu, BStream & stream)
+{
+   if (abbrev->has_children()) {
       for (;;) {
 	 int offset = stream.offset();
 	 int64_t childabbrevnum = stream.read_uleb();
@@ -286,7 +252,7 @@ void
 	 DIE * child = cu->make_die(cu, this, childabbrev);
 	 if (child != NULL) {
 	    child->read(cu, stream);
-	    cu->add_die(offset - cu->start_offset, child);
+	    cu->add_die(offset - cu->stream_offset, child);
 	    children.push_back(child);
 	 }
       }
@@ -298,6 +264,7 @@ void
 {
    if (children_offset > 0) {
       BStream & stream = cu->get_stream();
+      cu->remove_lazy_die(children_offset - cu->stream_offset);
       read(stream);
       children_offset = 0;
    }
@@ -328,7 +295,7 @@ void
 	  child = cu->make_die(cu, this, childabbrev);
       if (child != NULL) {
 	 child->read(cu, stream, true);	// read the whole tree
-	 cu->add_die(offset - cu->start_offset, child);
+	 cu->add_die(offset - cu->stream_offset, child);
 	 children.push_back(child);
       }
    }
@@ -356,39 +323,99 @@ void
    children.push_back(child);
 }
 
-Attribute *
-DIE::find_attribute(int tag)
+// find the value of an attribute of this DIE.  References to other DIEs
+// are left as offsets
+
+bool
+DIE::find_attribute(int tag, AttributeValue & value)
 {
-   AttributeMap::iterator attr = attributes.find(tag);
-   if (attr == attributes.end()) {
-      return NULL;
+   if (added != NULL) {
+      AttributeMap::iterator attr = added->find(tag);
+      if (attr != added->end()) {
+	 value = attr->second.value;
+	 return true;
+      }
+   }
+   if (abbrev == NULL) {
+      return false;
+   }
+   AttributeAbbreviation * attrabbrev = abbrev->findAttribute(tag);
+   if (attrabbrev == NULL) {
+      return false;
+   }
+
+   BStream stream = cu->get_stream();
+   if (attrabbrev->get_offset() >= 0) {
+      // all the values before it are of a fixed size
+      stream.seek(id + attrabbrev->get_offset() +
+		  attrabbrev->get_addresses() * cu->getAddrSize());
+   } else {
+      stream.seek(id);
+      for (int i = 0; abbrev->getAttribute(i) != attrabbrev; i++) {
+	 abbrev->getAttribute(i)->skip(cu, stream);
+      }
+   }
+   value = attrabbrev->read(cu, stream);
+   if (attrabbrev->is_reference()) {
+      DIE *die = cu->lookup_die(value.integer);
+      if (die != NULL) {
+	 value = die;
+      }
    }
-   return attr->second;
+   // DWARF 4 may give the high pc as the size of the code
+   if (tag == DW_AT_high_pc && attrabbrev->is_constant()) {
+      AttributeValue low;
+      if (find_attribute(DW_AT_low_pc, low)) {
+	 value.integer += low.integer;
+      }
+   }
+   return true;
 }
 
-AttributeValue no_value;
+// copy the attributes of another DIE that this one doesn't have.  The
+// values are decoded now, so the stream that DIE was read from must still
+// be the unit's
+
+void
+DIE::copy_attributes(DIE * from)
+{
+   if (from->abbrev == NULL) {
+      return;
+   }
+   for (int i = 0; i < from->abbrev->getNumAttributes(); i++) {
+      int attrtag = from->abbrev->getAttribute(i)->getTag();
+      AttributeValue value;
+      if ((abbrev != NULL && abbrev->findAttribute(attrtag) != NULL)
+	  || (added != NULL && added->count(attrtag) != 0)
+	  || !from->find_attribute(attrtag, value)) {
+	 continue;
+      }
+      if (value.type == AV_STRING) {
+	 addAttribute(attrtag, std::string(value.str));
+      } else {
+	 addAttribute(attrtag, value);
+      }
+   }
+}
 
-AttributeValue & DIE::getAttribute(int tag, bool fullsearch, bool stophere)
+AttributeValue DIE::getAttribute(int tag, bool fullsearch, bool stophere)
 {
-   Attribute * attr = find_attribute(tag);
-   if (attr == NULL) {
+   AttributeValue value;
+   if (!find_attribute(tag, value)) {
 
       // if the attribute is not found, look for it using the DW_AT_specification or
       // DW_AT_abstract_origin
 
       if (fullsearch && !stophere) {
-	 Attribute * more = find_attribute(DW_AT_abstract_origin);
-	 if (more == NULL) {
-	    more = find_attribute(DW_AT_specification);
-	 }
-
-	 if (more != NULL) {
+	 AttributeValue more;
+	 if (find_attribute(DW_AT_abstract_origin, more) ||
+	     find_attribute(DW_AT_specification, more)) {
 	    //printf ("dereferencing die %llx\n", id) ;
 	    DIE * origin = dereference_die_reference(cu, more);
 	    if (origin != NULL) {
 	       return origin->getAttribute(tag, fullsearch);
 	    } else {
-               return no_value;
+               return AttributeValue();
             }
 	 }
       }
@@ -396,36 +423,42 @@ AttributeValue & DIE::getAttribute(int tag, bool fullsearch, bool stophere)
       if (fullsearch && more_info != NULL) {
 	 return more_info->getAttribute(tag, fullsearch, true);
       } else {
-	 return no_value;
+	 return AttributeValue();
       }
 
    }
    // if the attribute references another die, make sure it is loaded
-   switch (attr->form) {
-   case DW_FORM_ref1:
-   case DW_FORM_ref2:
-   case DW_FORM_ref4:
-   case DW_FORM_ref8:
-      dereference_die_reference(cu, attr);
-      break;
+   if (value.type == AV_INTEGER && abbrev != NULL) {
+      AttributeAbbreviation * attrabbrev = abbrev->findAttribute(tag);
+      if (attrabbrev != NULL && attrabbrev->is_reference()) {
+	 DIE *die = dereference_die_reference(cu, value);
+	 if (die != NULL) {
+	    value = die;
+	 }
+      }
    }
-   return attr->value;
+   return value;
 }
 
 void
 DIE::addAttribute(int tag, const AttributeValue & value)
 {
-   Attribute* attr;
-
-   if (tag == DW_AT_specification ||
-       tag == DW_AT_abstract_origin) {
-       attr = new FixupAttribute(0, this);
-   } else {
-       attr = new Attribute (0);
+   if (added == NULL) {
+      added = new AttributeMap;
    }
+   (*added)[tag].value = value;
+}
 
-   attributes[tag] = attr;
-   attr->value = value;
+// add a string attribute.  The DIE keeps a copy of the string
+void
+DIE::addAttribute(int tag, std::string value)
+{
+   if (added == NULL) {
+      added = new AttributeMap;
+   }
+   AddedAttribute & attr = (*added)[tag];
+   attr.str = value;
+   attr.value = attr.str.c_str();
 }
 
 bool DIE::is_printable()
@@ -459,11 +492,14 @@ bool DIE::is_printable()
 std::string DIE::get_name()
 {
    // the linkage name overrides the simple name
-   AttributeValue & name = getAttribute(DW_AT_MIPS_linkage_name);
+   AttributeValue name = getAttribute(DW_AT_MIPS_linkage_name);
+   if (name.type == AV_NONE) {
+      name = getAttribute(DW_AT_linkage_name);
+   }
    if (name.type != AV_NONE) {
       return name.str;
    }
-   AttributeValue & name1 = getAttribute(DW_AT_name);
+   AttributeValue name1 = getAttribute(DW_AT_name);
    if (name1.type != AV_NONE) {
       return name1.str;
    }
@@ -564,7 +600,7 @@ bool DIE::compare(EvalContext & context, DIE * die, int flags)
 void
  DIE::print_name(EvalContext & ctx, DIE * die)
 {
-   AttributeValue & name = die->getAttribute(DW_AT_name);
+   AttributeValue name = die->getAttribute(DW_AT_name);
    if (name.type != AV_NONE) {
       ctx.os.print("%s", Utils::simplify_type(name.str).c_str());
    }
@@ -573,7 +609,7 @@ void
 void
  DIE::print_name_or_id(EvalContext & ctx, DIE * die)
 {
-   AttributeValue & name = die->getAttribute(DW_AT_name);
+   AttributeValue name = die->getAttribute(DW_AT_name);
    if (name.type != AV_NONE) {
       ctx.os.print("%s", Utils::simplify_type(name.str).c_str());
    } else if (!ctx.show_contents) {
@@ -709,7 +745,7 @@ void
 	 for (uint i = 0; i < type->getChildren().size(); i++) {
 	    DIE *
 		subrange = type->getChildren()[i];
-	    AttributeValue & upperbound =
+	    AttributeValue upperbound =
 		subrange->getAttribute(DW_AT_upper_bound);
 	    if (upperbound.type != AV_NONE) {
 	       ctx.os.print("[%d]", ((int) upperbound + 1));
@@ -861,7 +897,7 @@ void
 DIE *
 DIE::get_type()
 {
-   AttributeValue & type = getAttribute(DW_AT_type);
+   AttributeValue type = getAttribute(DW_AT_type);
    DIE *t = NULL;
 
    if (type.type != AV_NONE) {
@@ -61,6 +61,8 @@ class DIE {
    void check_loaded(); /* PORT: not needed */
    void read(DwCUnit * cu, BStream & stream, bool readall = false); /* PORT: not needed */
    void read(BStream & stream); /* PORT: not needed */
+   bool read_attributes(DwCUnit * cu, BStream & stream, Offset & sibling);
+   void read_children(DwCUnit * cu, BStream & stream);
    DwCUnit *get_cunit() { return cu; } /* PORT: impl. */
    virtual int get_language() { return 0; } /* PORT: impl. */
    virtual bool is_inheritance() { return false; } /* PORT: impl. */
@@ -81,8 +83,10 @@ class DIE {
 
    void addChild(DIE * child);
 
-   AttributeValue & getAttribute(int tag, bool fullsearch =true, bool stophere = false);
+   AttributeValue getAttribute(int tag, bool fullsearch =true, bool stophere = false);
    void addAttribute(int tag, const AttributeValue & value);
+   void addAttribute(int tag, std::string value);
+   void copy_attributes(DIE * from);	// those this DIE doesn't have
 
    bool is_printable();
    bool is_virtual() {
@@ -135,8 +139,6 @@ class DIE {
    virtual bool compare(EvalContext & context, DIE * die, int flags);	// compare two type dies
 
  protected:
-   Offset read_sibling(DwCUnit * cu, AttributeAbbreviation * attrabbrev,
-		       Attribute * attr, BStream & stream); /*PORT: not needed */
    bool is_skippable();/* PORT: not needed */
 
    typedef std::vector <DIE*>TypeStack; 
@@ -149,10 +151,17 @@ class DIE {
    void doindent(EvalContext & ctx, int indent);
    void dumpAttributes(DwCUnit * cu, int indent = 0);
    void dumpChildren(int indent);
-   typedef std::map < int, Attribute * >AttributeMap;
-   Attribute *find_attribute(int tag);
-
-   AttributeMap attributes;	// map of Attr vs Attribute
+   // attributes added by the debugger to the DIEs it makes up.  The
+   // attributes of a DIE read from the file are decoded from the file when
+   // they are asked for
+   struct AddedAttribute {
+      AttributeValue value;
+      std::string str;		// copy of a string value
+   };
+   typedef std::map < int, AddedAttribute > AttributeMap;
+   bool find_attribute(int tag, AttributeValue & value);
+
+   AttributeMap *added;		// map of Attr vs AddedAttribute, NULL if none
    std::vector < DIE * >children;
    DwCUnit *cu;
    DIE *parent;
@@ -62,7 +62,7 @@ TypeEnum::print (EvalContext & ctx, int indent, int level)
 		       ctx.os.print (", ");
 		    }
 		  print_name (ctx, child);
-		  AttributeValue & value =
+		  AttributeValue value =
 		     child->getAttribute (DW_AT_const_value);
 		  if (value.type != AV_NONE)
 		    {
@@ -597,6 +597,27 @@ TypeStruct::set_value(EvalContext & context, Value & addr,
 }
 
 
+// The whole of a structure is read from the process before it is printed,
+// and the members are read from the copy.  Only memory outside it, such
+// as that a member points to, is read from the process.
+class StructSnapshot
+{
+ public:
+   StructSnapshot(Process * process, Address addr, int size)
+   :  process(process), pushed(process->push_snapshot(addr, size))
+   {
+   }
+   ~StructSnapshot()
+   {
+      if (pushed) {
+	 process->pop_snapshot();
+      }
+   }
+ private:
+   Process * process;
+   bool pushed;
+};
+
 // if the structure is small and in a register then we need to push it
 // onto the runtime stack of the process.  This is because there is no way
 // to extract bits of a register in the routines that expect things to be
@@ -627,6 +648,9 @@ TypeStruct::print_value(EvalContext & context, Value & value,
    }
    EvalContext childcontext = context;
    bool pretty = context.process->get_int_opt(PRM_P_PRETTY) && context.pretty;
+   StructSnapshot snapshot(context.process,
+			   value.type == VALUE_INTEGER ? (Address) value.integer : 0,
+			   value.type == VALUE_INTEGER ? get_real_size(context) : 0);
 
    switch (context.language & 0xff) {
    case DW_LANG_C89:
@@ -37,6 +37,7 @@ author: David Allison <dallison@pathscale.com>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <pwd.h>
+#include <pthread.h>
 
 namespace Utils {
 
@@ -282,4 +283,62 @@ bool is_completion (const char* a, const char* b) {
    return (*a == '\0');
 }
 
+int num_cpus() {
+    long n = sysconf (_SC_NPROCESSORS_ONLN) ;
+    return n < 1 ? 1 : (int)n ;
+}
+
+struct ParallelJobs {
+    void (*fn)(void *, int) ;
+    void *arg ;
+    int njobs ;
+    int next ;                  // next job to hand out
+    pthread_mutex_t lock ;
+} ;
+
+static void *parallel_worker (void *p) {
+    ParallelJobs *jobs = (ParallelJobs *)p ;
+    for (;;) {
+        pthread_mutex_lock (&jobs->lock) ;
+        int job = jobs->next++ ;
+        pthread_mutex_unlock (&jobs->lock) ;
+        if (job >= jobs->njobs) {
+            break ;
+        }
+        jobs->fn (jobs->arg, job) ;
+    }
+    return NULL ;
+}
+
+void parallel_for (int njobs, void (*fn)(void *arg, int job), void *arg, int nthreads) {
+    if (nthreads <= 0) {
+        nthreads = num_cpus() ;
+    }
+    if (nthreads > njobs) {
+        nthreads = njobs ;
+    }
+
+    ParallelJobs jobs ;
+    jobs.fn = fn ;
+    jobs.arg = arg ;
+    jobs.njobs = njobs ;
+    jobs.next = 0 ;
+    pthread_mutex_init (&jobs.lock, NULL) ;
+
+    // the calling thread is one of the workers
+    std::vector<pthread_t> workers ;
+    for (int i = 1 ; i < nthreads ; i++) {
+        pthread_t tid ;
+        if (pthread_create (&tid, NULL, parallel_worker, &jobs) != 0) {
+            break ;                     // carry on with what we have
+        }
+        workers.push_back (tid) ;
+    }
+    parallel_worker (&jobs) ;
+    for (uint i = 0 ; i < workers.size() ; i++) {
+        pthread_join (workers[i], NULL) ;
+    }
+    pthread_mutex_destroy (&jobs.lock) ;
+}
+
 }
@@ -66,6 +66,15 @@ std::string toUpper (std::string s) ;
 void expand_path(std::string& path);
 bool is_completion(const char*, const char*);
 
+// number of processors available to run worker threads on
+int num_cpus() ;
+
+// call fn(arg, job) for every job in [0, njobs) using a pool of up to
+// nthreads worker threads (0 means one per processor).  Jobs are handed
+// out in order but may complete in any order, so fn must only touch
+// state private to its job.  fn must not throw.
+void parallel_for (int njobs, void (*fn)(void *arg, int job), void *arg, int nthreads = 0) ;
+
 }
 
 #endif